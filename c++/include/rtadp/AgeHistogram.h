@@ -0,0 +1,92 @@
+#ifndef AGEHISTOGRAM_H
+#define AGEHISTOGRAM_H
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <rtadp/json.hpp>
+
+// Lock-free histogram of message ages with power-of-two microsecond buckets:
+// bucket 0 counts ages below 1 us, bucket i ages in [2^(i-1), 2^i) us, the last bucket everything above.
+class AgeHistogram {
+public:
+    static constexpr size_t NUM_BUCKETS = 36;   // Up to about 9.5 hours
+
+private:
+    std::array<std::atomic<uint64_t>, NUM_BUCKETS> buckets{};
+    std::atomic<uint64_t> count{0};
+    std::atomic<uint64_t> max_us{0};
+    std::atomic<uint64_t> total_us{0};
+
+    static size_t bucket_index(uint64_t age_us) {
+        size_t index = 0;
+        while (age_us > 0 && index < NUM_BUCKETS - 1) {
+            age_us >>= 1;
+            index++;
+        }
+        return index;
+    }
+
+    // Upper bound of the bucket in microseconds
+    static uint64_t bucket_limit(size_t index) {
+        return static_cast<uint64_t>(1) << index;
+    }
+
+public:
+    void record(std::chrono::nanoseconds age) {
+        uint64_t age_us = age.count() > 0 ? static_cast<uint64_t>(age.count()) / 1000 : 0;
+        buckets[bucket_index(age_us)].fetch_add(1, std::memory_order_relaxed);
+        count.fetch_add(1, std::memory_order_relaxed);
+        total_us.fetch_add(age_us, std::memory_order_relaxed);
+
+        uint64_t current = max_us.load(std::memory_order_relaxed);
+        while (age_us > current && !max_us.compare_exchange_weak(current, age_us, std::memory_order_relaxed)) {
+        }
+    }
+
+    uint64_t get_count() const { return count; }
+
+    // Sum of the recorded ages: the mean age over a period is the difference of two readings
+    // divided by the difference of the counts
+    uint64_t get_total_us() const { return total_us; }
+
+    // Upper bound of the bucket containing the given quantile (0..1), in microseconds
+    uint64_t quantile_us(double quantile) const {
+        uint64_t total = count;
+        if (total == 0) {
+            return 0;
+        }
+        uint64_t target = static_cast<uint64_t>(quantile * total);
+        uint64_t cumulative = 0;
+        for (size_t i = 0; i < NUM_BUCKETS; i++) {
+            cumulative += buckets[i].load(std::memory_order_relaxed);
+            if (cumulative > target) {
+                return bucket_limit(i);
+            }
+        }
+        return max_us;
+    }
+
+    // Count, max, p50/p90/p99 upper bounds and the non-empty buckets by upper bound ("le_us")
+    nlohmann::json to_json() const {
+        nlohmann::json data;
+        data["count"] = get_count();
+        data["max_us"] = max_us.load();
+        data["p50_us"] = quantile_us(0.50);
+        data["p90_us"] = quantile_us(0.90);
+        data["p99_us"] = quantile_us(0.99);
+
+        nlohmann::json histogram = nlohmann::json::object();
+        for (size_t i = 0; i < NUM_BUCKETS; i++) {
+            uint64_t value = buckets[i].load(std::memory_order_relaxed);
+            if (value > 0) {
+                histogram[std::to_string(bucket_limit(i))] = value;
+            }
+        }
+        data["le_us"] = histogram;
+        return data;
+    }
+};
+
+#endif // AGEHISTOGRAM_H
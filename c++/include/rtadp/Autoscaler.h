@@ -0,0 +1,78 @@
+#ifndef AUTOSCALER_H
+#define AUTOSCALER_H
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <rtadp/json.hpp>
+
+class WorkerManager;
+
+// Parameters of the autoscaling of the worker threads of a manager ("autoscale" in the manager configuration)
+struct AutoscaleConfig {
+    int min_workers = 1;
+    int max_workers = 16;
+    std::chrono::milliseconds interval{1000};   // Evaluation period
+    size_t queue_per_worker = 100;  // Queued messages per worker above which a growing backlog is a pressure
+    double max_age_ms = 0;          // Mean queue age above which a rising age is a pressure, 0 = not used
+    double up_utilization = 0.85;   // Busy fraction of the workers above which (with queued data) they are saturated
+    double down_utilization = 0.3;  // Busy fraction below which (with an empty queue) a worker can be retired
+    int up_periods = 2;             // Consecutive periods under pressure before adding workers
+    int down_periods = 10;          // Consecutive idle periods before retiring a worker
+    int step = 1;                   // Workers added per scale up (one is retired per scale down)
+
+    static AutoscaleConfig from_json(const nlohmann::json& configuration, int max_workers);
+};
+
+// Adds and retires worker threads of a manager at runtime, from the queue depth, the trend of the
+// queue age and the utilization of the workers, measured every interval. Separate up and down
+// thresholds and the consecutive periods required act as hysteresis. An operator can override it with
+// the "scale" command, which disables the autoscaling until re-enabled.
+class Autoscaler {
+    WorkerManager* manager;
+    AutoscaleConfig autoscale_config;
+    std::string globalname;
+
+    std::atomic<bool> enabled{true};
+    std::atomic<bool> stop_event{false};
+    std::mutex mtx;
+    std::condition_variable cv;
+    std::thread thread;
+
+    // Readings of the previous period
+    uint64_t last_busy_ns = 0;
+    uint64_t last_age_count = 0;
+    uint64_t last_age_total_us = 0;
+    size_t last_depth = 0;
+    double last_mean_age_ms = 0;
+    int up_count = 0;
+    int down_count = 0;
+
+    std::atomic<double> utilization{0.0};
+    std::atomic<double> mean_age_ms{0.0};
+
+    void run();
+    void evaluate(std::chrono::nanoseconds elapsed);
+
+public:
+    Autoscaler(WorkerManager* manager, const AutoscaleConfig& config);
+    ~Autoscaler();
+
+    void start();
+    void stop();
+
+    void set_enabled(bool value);
+    bool is_enabled() const;
+
+    const AutoscaleConfig& getConfig() const;
+
+    // Measurements of the last period
+    double getUtilization() const;
+    double getMeanAgeMs() const;
+};
+
+#endif // AUTOSCALER_H
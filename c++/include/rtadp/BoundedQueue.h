@@ -0,0 +1,309 @@
+#ifndef BOUNDEDQUEUE_H
+#define BOUNDEDQUEUE_H
+
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <condition_variable>
+#include <stdexcept>
+#include <string>
+#include <vector>
+#include <rtadp/MessageQueue.h>
+
+// What a BoundedQueue does with a push when it is full
+enum class OverflowPolicy {
+    Block,          // Wait until the consumers make room (backpressure on the producer)
+    DropOldest,     // Discard the oldest messages in the queue to make room
+    DropNewest,     // Discard the message being pushed
+    Reject          // Discard the message being pushed and raise an alarm
+};
+
+// Parse "block", "drop_oldest", "drop_newest" or "reject"
+inline OverflowPolicy parse_overflow_policy(const std::string& name) {
+    if (name == "block") return OverflowPolicy::Block;
+    if (name == "drop_oldest") return OverflowPolicy::DropOldest;
+    if (name == "drop_newest") return OverflowPolicy::DropNewest;
+    if (name == "reject") return OverflowPolicy::Reject;
+    throw std::invalid_argument("Unknown overflow policy " + name);
+}
+
+// Queue decorator that limits the number of messages and the number of payload bytes
+// (T::size()) held by the wrapped queue. A limit of 0 means no limit.
+// The decorator only keeps the accounting, the messages are stored in the wrapped queue.
+template <typename T>
+class BoundedQueue : public MessageQueue<T> {
+public:
+    // Called with a description when a push is rejected; called again only after the queue accepted a push
+    using AlarmCallback = std::function<void(const std::string&)>;
+
+    // Called with each message discarded by drop_oldest, drop_newest or reject (e.g. to skip its sequence)
+    using DropCallback = std::function<void(const T&)>;
+
+private:
+    std::shared_ptr<MessageQueue<T>> queue;
+    const size_t max_messages;
+    const size_t max_bytes;
+    const OverflowPolicy policy;
+    AlarmCallback alarm;
+    DropCallback on_drop;
+
+    mutable std::mutex mtx;
+    std::condition_variable not_full;
+    size_t messages = 0;
+    size_t bytes = 0;
+    bool stopped = false;
+    bool alarm_raised = false;
+
+    std::atomic<uint64_t> dropped{0};
+    std::atomic<uint64_t> rejected{0};
+    std::atomic<uint64_t> blocked{0};
+
+    bool fits(size_t size) const {
+        if (max_messages > 0 && messages + 1 > max_messages) {
+            return false;
+        }
+        // A message bigger than max_bytes is accepted in an empty queue, otherwise it could never pass
+        if (max_bytes > 0 && bytes + size > max_bytes && messages > 0) {
+            return false;
+        }
+        return true;
+    }
+
+    // Account a message taken out of the wrapped queue
+    void release(const T& value) {
+        {
+            std::lock_guard<std::mutex> lock(mtx);
+            messages = messages > 0 ? messages - 1 : 0;
+            bytes = bytes > value.size() ? bytes - value.size() : 0;
+        }
+        not_full.notify_one();
+    }
+
+    // Make room for a message of the given size according to the policy, the messages discarded
+    // by drop_oldest are moved to evicted. Returns false if the message must be discarded.
+    // Called with the lock held.
+    bool admit(std::unique_lock<std::mutex>& lock, size_t size, std::vector<T>& evicted) {
+        if (fits(size)) {
+            alarm_raised = false;
+            return true;
+        }
+
+        switch (policy) {
+        case OverflowPolicy::Block:
+            blocked++;
+            not_full.wait(lock, [&] { return stopped || fits(size); });
+            return !stopped;
+
+        case OverflowPolicy::DropOldest: {
+            T oldest;
+            while (!fits(size) && queue->try_pop(oldest)) {
+                messages = messages > 0 ? messages - 1 : 0;
+                bytes = bytes > oldest.size() ? bytes - oldest.size() : 0;
+                dropped++;
+                evicted.push_back(std::move(oldest));
+            }
+            return true;
+        }
+
+        case OverflowPolicy::DropNewest:
+            dropped++;
+            return false;
+
+        case OverflowPolicy::Reject:
+            rejected++;
+            if (!alarm_raised) {
+                alarm_raised = true;
+                if (alarm) {
+                    // Called without the lock, the callback may be slow (e.g. sending a message)
+                    std::string message = "Queue full: " + std::to_string(messages) + " messages, " + std::to_string(bytes) + " bytes";
+                    lock.unlock();
+                    alarm(message);
+                    lock.lock();
+                }
+            }
+            return false;
+        }
+        return false;
+    }
+
+    template <typename U>
+    bool bounded_push(U&& value) {
+        size_t size = value.size();
+        std::vector<T> evicted;
+        bool admitted;
+        {
+            std::unique_lock<std::mutex> lock(mtx);
+            admitted = admit(lock, size, evicted);
+            if (admitted) {
+                messages++;
+                bytes += size;
+            }
+        }
+
+        // Called without the lock, as the alarm
+        if (on_drop) {
+            for (const auto& oldest : evicted) {
+                on_drop(oldest);
+            }
+            // With the block policy a push is refused only when the queue is stopped
+            if (!admitted && policy != OverflowPolicy::Block) {
+                on_drop(value);
+            }
+        }
+
+        if (!admitted) {
+            return false;
+        }
+        queue->push(std::forward<U>(value));
+        return true;
+    }
+
+public:
+    BoundedQueue(std::shared_ptr<MessageQueue<T>> queue, size_t max_messages, size_t max_bytes,
+                 OverflowPolicy policy, AlarmCallback alarm = nullptr, DropCallback on_drop = nullptr)
+        : queue(std::move(queue)), max_messages(max_messages), max_bytes(max_bytes),
+          policy(policy), alarm(std::move(alarm)), on_drop(std::move(on_drop)) {}
+
+    void push(const T& value) override {
+        bounded_push(value);
+    }
+
+    void push(T&& value) override {
+        bounded_push(std::move(value));
+    }
+
+    void push_batch(const std::vector<T>& values) override {
+        for (const auto& value : values) {
+            bounded_push(value);
+        }
+    }
+
+    // Never blocks: with the block policy a full queue returns false. The other policies apply as in push()
+    // and always take the message, a discarded message is already counted and passed to on_drop.
+    bool try_push(const T& value) override {
+        T copy = value;
+        return try_push(std::move(copy));
+    }
+
+    bool try_push(T&& value) override {
+        if (policy == OverflowPolicy::Block) {
+            std::lock_guard<std::mutex> lock(mtx);
+            if (!fits(value.size())) {
+                return false;
+            }
+            messages++;
+            bytes += value.size();
+        }
+        else {
+            bounded_push(std::move(value));
+            return true;
+        }
+        queue->push(std::move(value));
+        return true;
+    }
+
+    // Accounts the whole batch under one lock. With the block policy stops at the first message that does
+    // not fit; the other policies take every message, as try_push().
+    size_t try_push_batch(const std::vector<T>& values) override {
+        std::vector<T> admitted;
+        std::vector<T> discarded;
+        size_t count = 0;
+        {
+            std::unique_lock<std::mutex> lock(mtx);
+            for (const auto& value : values) {
+                size_t size = value.size();
+                if (policy == OverflowPolicy::Block) {
+                    if (!fits(size)) {
+                        break;
+                    }
+                }
+                else if (!admit(lock, size, discarded)) {
+                    discarded.push_back(value);
+                    count++;
+                    continue;
+                }
+                else if (policy == OverflowPolicy::DropOldest) {
+                    // The wrapped queue is empty: the oldest messages are the ones admitted by this batch
+                    size_t evicted = 0;
+                    while (!fits(size) && evicted < admitted.size()) {
+                        messages--;
+                        bytes = bytes > admitted[evicted].size() ? bytes - admitted[evicted].size() : 0;
+                        dropped++;
+                        discarded.push_back(std::move(admitted[evicted]));
+                        evicted++;
+                    }
+                    admitted.erase(admitted.begin(), admitted.begin() + evicted);
+                }
+                messages++;
+                bytes += size;
+                admitted.push_back(value);
+                count++;
+            }
+        }
+
+        if (!admitted.empty()) {
+            queue->push_batch(admitted);
+        }
+        // Called without the lock, as in bounded_push
+        if (on_drop) {
+            for (const auto& message : discarded) {
+                on_drop(message);
+            }
+        }
+        return count;
+    }
+
+    T get() override {
+        T value = queue->get();
+        release(value);
+        return value;
+    }
+
+    bool try_pop(T& value) override {
+        if (!queue->try_pop(value)) {
+            return false;
+        }
+        release(value);
+        return true;
+    }
+
+    void pop() override {
+        T value = queue->get();
+        release(value);
+    }
+
+    bool empty() const override { return queue->empty(); }
+    size_t size() const override { return queue->size(); }
+
+    void notify_all() override {
+        {
+            std::lock_guard<std::mutex> lock(mtx);
+            stopped = true;
+        }
+        not_full.notify_all();
+        queue->notify_all();
+    }
+
+    // Payload bytes currently held
+    size_t get_bytes() const {
+        std::lock_guard<std::mutex> lock(mtx);
+        return bytes;
+    }
+
+    // Messages discarded by the drop_oldest and drop_newest policies
+    uint64_t get_dropped_count() const { return dropped; }
+
+    // Messages discarded by the reject policy
+    uint64_t get_rejected_count() const { return rejected; }
+
+    // Pushes that had to wait with the block policy
+    uint64_t get_blocked_count() const { return blocked; }
+
+    size_t get_max_messages() const { return max_messages; }
+    size_t get_max_bytes() const { return max_bytes; }
+    OverflowPolicy get_policy() const { return policy; }
+};
+
+#endif // BOUNDEDQUEUE_H
@@ -0,0 +1,131 @@
+#ifndef BUFFERPOOL_H
+#define BUFFERPOOL_H
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <vector>
+#include <rtadp/json.hpp>
+
+// Recycling allocator for the per-message storage of the data path: the shared holders of the
+// received frames and of the results, the payload copies and the zmq send references.
+// A block is taken by one thread (e.g. ingest) and returned by another (the worker or the result
+// sender releasing the last DataMessage), so every thread keeps a cache of free blocks per size class
+// and exchanges half of it with the shared free list when it is empty or full. The blocks are carved
+// from slabs that are never unmapped while the pool exists: in steady state no block is allocated.
+//
+// Configured by the "buffer_pool" block of the Supervisor configuration:
+//     "buffer_pool": { "enabled": true, "min_block_bytes": 64, "max_block_bytes": 1048576,
+//                      "thread_cache_blocks": 64, "thread_cache_bytes": 4194304,
+//                      "slab_bytes": 2097152, "huge_pages": false }
+// Size classes are the powers of two from min_block_bytes to max_block_bytes; larger blocks use
+// operator new. With huge_pages the slabs are mapped with MAP_HUGETLB (falling back to transparent
+// huge pages if no huge page is reserved), which reduces the TLB misses on large payloads.
+class BufferPool {
+public:
+    explicit BufferPool(const nlohmann::json& configuration = nlohmann::json::object());
+    ~BufferPool();
+
+    BufferPool(const BufferPool&) = delete;
+    BufferPool& operator=(const BufferPool&) = delete;
+
+    // Block of at least size bytes, aligned to 64 bytes (to 16 for the blocks larger than max_block_bytes)
+    void* allocate(size_t size);
+
+    // Return a block, with the size passed to allocate(); can be called by any thread
+    void deallocate(void* block, size_t size) noexcept;
+
+    // Unique among the pools created by the process, never reused
+    uint64_t getId() const { return id; }
+
+    size_t getMaxBlockSize() const { return max_block_size; }
+
+    // Allocations served by a recycled block, by a new block carved from a slab, by operator new
+    uint64_t getHitCount() const;
+    uint64_t getMissCount() const { return misses; }
+    uint64_t getOversizeCount() const { return oversize; }
+    double getHitRate() const;
+
+    // Bytes mapped for the slabs, bytes of the blocks in the shared free lists
+    size_t getReservedBytes() const { return reserved_bytes; }
+    size_t getFreeBytes();
+
+    // True if at least one slab is backed by huge pages (MAP_HUGETLB)
+    bool isHugePages() const { return huge_pages_mapped; }
+
+private:
+    friend struct BufferPoolThreadCache;
+
+    struct SizeClass {
+        size_t block_size = 0;
+        size_t cache_limit = 0;         // Max blocks in a thread cache
+        std::mutex mtx;
+        std::vector<void*> free_blocks; // Shared free list
+        uint8_t* slab_next = nullptr;   // Not yet carved part of the last slab
+        uint8_t* slab_end = nullptr;
+    };
+
+    struct Slab {
+        void* memory;
+        size_t size;
+    };
+
+    uint64_t id;
+    size_t min_block_size;
+    size_t max_block_size;
+    int min_shift;
+    size_t slab_size;
+    bool huge_pages;
+
+    std::vector<std::unique_ptr<SizeClass>> classes;
+
+    std::mutex slabs_mutex;
+    std::vector<Slab> slabs;
+
+    std::atomic<uint64_t> allocations{0};  // Up to max_block_size
+    std::atomic<uint64_t> misses{0};        // Blocks carved from the slabs
+    std::atomic<uint64_t> oversize{0};
+    std::atomic<size_t> reserved_bytes{0};
+    std::atomic<bool> huge_pages_mapped{false};
+
+    size_t class_index(size_t size) const;
+
+    // Move up to count blocks of a class from the shared free list (or from new slab memory) to blocks
+    void refill(size_t index, std::vector<void*>& blocks, size_t count);
+
+    // Move count blocks from the back of blocks to the shared free list
+    void release(size_t index, std::vector<void*>& blocks, size_t count) noexcept;
+    void release(size_t index, void* block) noexcept;
+
+    void* map_slab(size_t size);
+};
+
+// Standard allocator on a BufferPool, e.g. for std::allocate_shared.
+// The allocator keeps the pool alive, so the blocks can outlive the owner of the pool.
+template <typename T>
+class PoolAllocator {
+    std::shared_ptr<BufferPool> pool;
+
+    template <typename U>
+    friend class PoolAllocator;
+
+public:
+    using value_type = T;
+
+    explicit PoolAllocator(std::shared_ptr<BufferPool> pool) : pool(std::move(pool)) {}
+
+    template <typename U>
+    PoolAllocator(const PoolAllocator<U>& other) : pool(other.pool) {}
+
+    T* allocate(size_t count) { return static_cast<T*>(pool->allocate(count * sizeof(T))); }
+    void deallocate(T* block, size_t count) noexcept { pool->deallocate(block, count * sizeof(T)); }
+
+    template <typename U>
+    bool operator==(const PoolAllocator<U>& other) const { return pool == other.pool; }
+    template <typename U>
+    bool operator!=(const PoolAllocator<U>& other) const { return pool != other.pool; }
+};
+
+#endif // BUFFERPOOL_H
@@ -0,0 +1,21 @@
+#ifndef CPURELAX_H
+#define CPURELAX_H
+
+#include <cstddef>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#endif
+
+constexpr size_t CACHE_LINE_SIZE = 64;
+
+// Hint to the CPU that the thread is spinning
+inline void cpu_relax() {
+#if defined(__x86_64__) || defined(__i386__)
+    _mm_pause();
+#elif defined(__aarch64__)
+    asm volatile("yield");
+#endif
+}
+
+#endif // CPURELAX_H
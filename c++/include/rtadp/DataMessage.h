@@ -0,0 +1,240 @@
+#ifndef DATAMESSAGE_H
+#define DATAMESSAGE_H
+
+#include <cstdint>
+#include <chrono>
+#include <cstddef>
+#include <cstring>
+#include <memory>
+#include <vector>
+#include <zmq.hpp>
+#include <rtadp/BufferPool.h>
+
+// Reference-counted, read-only handle to a message payload.
+// The payload stays in the buffer it was received into (a zmq frame or a vector) and is shared
+// by all the managers and workers: copying a DataMessage copies the reference, not the data.
+// A result can have more parts (e.g. header and payload, see OutputBuffer), sent as a multipart
+// zmq message: data() and size() refer to the first part, the others follow with next_part().
+class DataMessage {
+    std::shared_ptr<const void> owner;  // Keeps the payload storage alive
+    const uint8_t* payload = nullptr;
+    size_t length = 0;
+    std::shared_ptr<const DataMessage> next;    // Next part of a multipart message
+    uint64_t seq = 0;   // Sequence number assigned at ingest, per priority channel
+    std::chrono::steady_clock::time_point ingest;   // Reception time (monotonic)
+
+public:
+    DataMessage() = default;
+
+    // Take ownership of a received zmq frame without copying the payload
+    static DataMessage from_frame(zmq::message_t&& frame) {
+        // The frame is moved once into the shared storage and never relocated afterwards,
+        // so the payload pointer is valid also for small messages stored inside zmq_msg_t
+        auto stored = std::make_shared<zmq::message_t>(std::move(frame));
+        DataMessage message;
+        message.payload = static_cast<const uint8_t*>(stored->data());
+        message.length = stored->size();
+        message.owner = std::move(stored);
+        return message;
+    }
+
+    // As from_frame(zmq::message_t&&), with the shared storage of the frame taken from the pool (nullptr: from the heap)
+    static DataMessage from_frame(zmq::message_t&& frame, const std::shared_ptr<BufferPool>& pool) {
+        if (!pool) {
+            return from_frame(std::move(frame));
+        }
+        auto stored = std::allocate_shared<zmq::message_t>(PoolAllocator<zmq::message_t>(pool), std::move(frame));
+        DataMessage message;
+        message.payload = static_cast<const uint8_t*>(stored->data());
+        message.length = stored->size();
+        message.owner = std::move(stored);
+        return message;
+    }
+
+    // Take ownership of a vector without copying the payload
+    static DataMessage from_vector(std::vector<uint8_t>&& data) {
+        auto stored = std::make_shared<std::vector<uint8_t>>(std::move(data));
+        DataMessage message;
+        message.payload = stored->data();
+        message.length = stored->size();
+        message.owner = std::move(stored);
+        return message;
+    }
+
+    // As from_vector(std::vector<uint8_t>&&), with the shared storage of the vector taken from the pool (nullptr: from the heap)
+    static DataMessage from_vector(std::vector<uint8_t>&& data, const std::shared_ptr<BufferPool>& pool) {
+        if (!pool) {
+            return from_vector(std::move(data));
+        }
+        auto stored = std::allocate_shared<std::vector<uint8_t>>(PoolAllocator<std::vector<uint8_t>>(pool), std::move(data));
+        DataMessage message;
+        message.payload = stored->data();
+        message.length = stored->size();
+        message.owner = std::move(stored);
+        return message;
+    }
+
+    // Copy of a payload into a block of the pool (nullptr: of the heap), returned to the pool by the last handle
+    static DataMessage copy_from(const uint8_t* data, size_t size, const std::shared_ptr<BufferPool>& pool) {
+        void* block = allocate_block(size, pool);
+        if (size > 0) {
+            std::memcpy(block, data, size);
+        }
+        return adopt_block(block, size, size, pool);
+    }
+
+    // Block of capacity bytes for adopt_block(), from the pool (nullptr: from the heap)
+    static void* allocate_block(size_t capacity, const std::shared_ptr<BufferPool>& pool) {
+        return pool ? pool->allocate(capacity) : ::operator new(capacity);
+    }
+
+    // Take ownership of a block returned by allocate_block(capacity, pool), holding size bytes of payload
+    static DataMessage adopt_block(void* block, size_t size, size_t capacity, const std::shared_ptr<BufferPool>& pool) {
+        DataMessage message;
+        message.payload = static_cast<const uint8_t*>(block);
+        message.length = size;
+        if (pool) {
+            BufferPool* blocks = pool.get();    // Kept alive by the allocator of the control block
+            message.owner = std::shared_ptr<const void>(block,
+                [blocks, capacity](const void* p) { blocks->deallocate(const_cast<void*>(p), capacity); },
+                PoolAllocator<uint8_t>(pool));
+        }
+        else {
+            message.owner = std::shared_ptr<const void>(block, [](const void* p) { ::operator delete(const_cast<void*>(p)); });
+        }
+        return message;
+    }
+
+    // Multipart message made of the parts, in order; the metadata are the ones of the first part
+    static DataMessage from_parts(std::vector<DataMessage>&& parts, const std::shared_ptr<BufferPool>& pool) {
+        if (parts.empty()) {
+            return DataMessage();
+        }
+        for (size_t i = parts.size() - 1; i > 0; i--) {
+            parts[i - 1].next = pool ? std::allocate_shared<DataMessage>(PoolAllocator<DataMessage>(pool), std::move(parts[i]))
+                                     : std::make_shared<DataMessage>(std::move(parts[i]));
+        }
+        return std::move(parts[0]);
+    }
+
+    // Payload stored in a buffer kept alive by owner (e.g. a memory-mapped file)
+    static DataMessage from_shared(std::shared_ptr<const void> owner, const uint8_t* data, size_t size) {
+        DataMessage message;
+        message.payload = data;
+        message.length = size;
+        message.owner = std::move(owner);
+        return message;
+    }
+
+    const uint8_t* data() const { return payload; }
+    size_t size() const { return length; }
+    bool empty() const { return length == 0; }
+
+    const uint8_t* begin() const { return payload; }
+    const uint8_t* end() const { return payload + length; }
+
+    // Next part of a multipart message, nullptr for the last (or only) part
+    const DataMessage* next_part() const { return next.get(); }
+    bool is_multipart() const { return next != nullptr; }
+
+    // This part alone, without the following parts
+    DataMessage part_only() const {
+        DataMessage message = *this;
+        message.next.reset();
+        return message;
+    }
+
+    // Bytes of all the parts
+    size_t total_size() const {
+        size_t total = 0;
+        for (const DataMessage* part = this; part; part = part->next_part()) {
+            total += part->length;
+        }
+        return total;
+    }
+
+    // Single-part message with the parts concatenated (copied into a block of the pool), itself if not multipart.
+    // For the consumers of the whole payload through data() and size(), e.g. the downstream managers.
+    DataMessage flatten(const std::shared_ptr<BufferPool>& pool) const {
+        if (!next) {
+            return *this;
+        }
+        size_t total = total_size();
+        uint8_t* block = static_cast<uint8_t*>(allocate_block(total, pool));
+        size_t offset = 0;
+        for (const DataMessage* part = this; part; part = part->next_part()) {
+            if (part->length > 0) {
+                std::memcpy(block + offset, part->payload, part->length);
+                offset += part->length;
+            }
+        }
+        DataMessage message = adopt_block(block, total, total, pool);
+        message.seq = seq;
+        message.ingest = ingest;
+        return message;
+    }
+
+    uint64_t sequence() const { return seq; }
+    void set_sequence(uint64_t value) { seq = value; }
+
+    std::chrono::steady_clock::time_point ingest_time() const { return ingest; }
+    void set_ingest_time(std::chrono::steady_clock::time_point value) { ingest = value; }
+
+    // Time elapsed since the message was received
+    std::chrono::nanoseconds age() const { return std::chrono::steady_clock::now() - ingest; }
+
+    // zmq message pointing at the payload, without copying it (zmq_msg_init_data).
+    // The message holds a reference to the storage, released by the free callback when zmq has sent it.
+    zmq::message_t to_message() const {
+        if (length == 0) {
+            return zmq::message_t();
+        }
+        auto* reference = new std::shared_ptr<const void>(owner);
+        return zmq::message_t(const_cast<uint8_t*>(payload), length, &release_reference, reference);
+    }
+
+    // As to_message(), with the reference held by zmq taken from the pool (nullptr: from the heap)
+    zmq::message_t to_message(const std::shared_ptr<BufferPool>& pool) const {
+        if (!pool || length == 0) {
+            return to_message();
+        }
+        auto* reference = new (pool->allocate(sizeof(PooledReference))) PooledReference{owner, pool};
+        return zmq::message_t(const_cast<uint8_t*>(payload), length, &release_pooled_reference, reference);
+    }
+
+    // Owning copy of the payload (of all the parts), for code that needs a std::vector
+    std::vector<uint8_t> to_vector() const {
+        if (!next) {
+            return std::vector<uint8_t>(begin(), end());
+        }
+        std::vector<uint8_t> data;
+        data.reserve(total_size());
+        for (const DataMessage* part = this; part; part = part->next_part()) {
+            data.insert(data.end(), part->begin(), part->end());
+        }
+        return data;
+    }
+
+    // Number of handles sharing the payload
+    long use_count() const { return owner.use_count(); }
+
+private:
+    struct PooledReference {
+        std::shared_ptr<const void> owner;
+        std::shared_ptr<BufferPool> pool;
+    };
+
+    static void release_reference(void* /*data*/, void* hint) {
+        delete static_cast<std::shared_ptr<const void>*>(hint);
+    }
+
+    // Called by a zmq I/O thread, the block goes to the cache of that thread
+    static void release_pooled_reference(void* /*data*/, void* hint) {
+        auto* reference = static_cast<PooledReference*>(hint);
+        std::shared_ptr<BufferPool> pool = std::move(reference->pool);
+        reference->~PooledReference();
+        pool->deallocate(reference, sizeof(PooledReference));
+    }
+};
+
+#endif // DATAMESSAGE_H
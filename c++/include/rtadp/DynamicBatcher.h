@@ -0,0 +1,105 @@
+#ifndef DYNAMICBATCHER_H
+#define DYNAMICBATCHER_H
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include <rtadp/json.hpp>
+#include <rtadp/DataMessage.h>
+#include <rtadp/InferenceBackend.h>
+
+class WorkerManager;
+
+// Batching stage shared by the workers of a manager ("batcher" block of the manager configuration).
+// The workers submit single events; the batcher groups them by size class and runs one model
+// invocation (InferenceBackend::infer) per batch, then hands each output back to its submitter.
+// A size class is dispatched when it holds max_batch_size events or when its earliest deadline
+// (submit time + max_delay_us, hp_max_delay_us for hp events) is reached.
+//
+//     "batcher": { "backend": "cpu_mock", "max_batch_size": 64, "max_delay_us": 1000,
+//                  "hp_max_delay_us": 0, "size_classes": [4096, 65536], "threads": 1 }
+class DynamicBatcher {
+public:
+    // Receives the output of an event, empty if the invocation failed or the batcher is stopped
+    using Completion = std::function<void(std::vector<uint8_t>&&)>;
+
+private:
+    struct Request {
+        DataMessage data;
+        std::chrono::steady_clock::time_point deadline;
+        Completion completion;
+    };
+
+    // Events of similar size, batched together (e.g. for a model with a fixed input shape)
+    struct SizeClass {
+        size_t max_bytes;
+        std::deque<Request> requests;
+        std::chrono::steady_clock::time_point earliest_deadline;
+    };
+
+    WorkerManager* manager;
+    std::shared_ptr<InferenceBackend> backend;
+    std::string globalname;
+
+    size_t max_batch_size;
+    std::chrono::microseconds max_delay;
+    std::chrono::microseconds hp_max_delay;
+
+    std::mutex mtx;
+    std::condition_variable cv;
+    std::vector<SizeClass> size_classes;    // By increasing max_bytes, the last one has no limit
+    bool stopped = false;
+    std::vector<std::thread> threads;
+
+    std::atomic<uint64_t> batches{0};
+    std::atomic<uint64_t> events{0};
+    std::atomic<uint64_t> failed_batches{0};
+    std::atomic<uint64_t> queued{0};
+
+    void run();
+    void run_batch(std::vector<Request>& batch);
+
+    // Class that must be dispatched now (full or past its deadline), nullptr if none.
+    // next_deadline is set to the earliest deadline of the other classes. Called with the lock held.
+    SizeClass* ready_class(std::chrono::steady_clock::time_point now, std::chrono::steady_clock::time_point& next_deadline);
+
+public:
+    DynamicBatcher(WorkerManager* manager, std::shared_ptr<InferenceBackend> backend, const nlohmann::json& configuration);
+    ~DynamicBatcher();
+
+    DynamicBatcher(const DynamicBatcher&) = delete;
+    DynamicBatcher& operator=(const DynamicBatcher&) = delete;
+
+    // Submit an event, the completion is called by a batcher thread with its output
+    void submit(const DataMessage& data, int priority, Completion completion);
+
+    // Submit an event and wait for its output through the future
+    std::future<std::vector<uint8_t>> submit(const DataMessage& data, int priority);
+
+    // Submit an event whose output goes directly to the result queue of the manager (skipped if empty).
+    // The worker must call WorkerBase::defer_result() so that the framework does not handle its result.
+    void submit_result(const DataMessage& data, int priority);
+
+    void start(int num_threads);
+
+    // Complete the pending events with an empty output and stop the threads
+    void stop();
+
+    std::string getBackendName() const;
+    uint64_t getBatchCount() const { return batches; }
+    uint64_t getEventCount() const { return events; }
+    uint64_t getFailedBatchCount() const { return failed_batches; }
+    uint64_t getQueuedCount() const { return queued; }
+    double getMeanBatchSize() const;
+};
+
+#endif // DYNAMICBATCHER_H
@@ -0,0 +1,60 @@
+#ifndef INFERENCEBACKEND_H
+#define INFERENCEBACKEND_H
+
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+#include <rtadp/json.hpp>
+#include <rtadp/DataMessage.h>
+
+// Model invoked by the DynamicBatcher on a batch of events.
+// A backend is selected by name with "backend" in the "batcher" block of the manager configuration,
+// which is passed to the factory. infer() is called by the batcher threads: a backend used with
+// more than one batcher thread must be thread safe.
+class InferenceBackend {
+public:
+    using Factory = std::function<std::shared_ptr<InferenceBackend>(const nlohmann::json&)>;
+
+    virtual ~InferenceBackend() = default;
+
+    // Run the model once on the whole batch: outputs[i] is the output of inputs[i]
+    virtual void infer(const std::vector<DataMessage>& inputs, std::vector<std::vector<uint8_t>>& outputs) = 0;
+
+    // Largest batch accepted by the model, 0 for no limit
+    virtual size_t max_batch_size() const { return 0; }
+
+    virtual std::string getName() const = 0;
+
+    // Returns true so that it can be used in a static initializer
+    static bool register_backend(const std::string& name, Factory factory);
+
+    // New backend of a registered name, nullptr if the name is not registered
+    static std::shared_ptr<InferenceBackend> create(const std::string& name, const nlohmann::json& configuration);
+
+private:
+    static std::map<std::string, Factory>& factories();
+    static std::mutex& registry_mutex();
+};
+
+// CPU mock of a model, for tests and benchmarks: the output is a copy of the input, every invocation
+// costs "mock_setup_us" plus "mock_item_us" per event of busy CPU time (as the fixed and per-event
+// cost of a real model invocation). Registered as "cpu_mock".
+class CpuMockBackend : public InferenceBackend {
+    std::chrono::microseconds setup_time;
+    std::chrono::microseconds item_time;
+    size_t max_batch;
+
+public:
+    explicit CpuMockBackend(const nlohmann::json& configuration);
+
+    void infer(const std::vector<DataMessage>& inputs, std::vector<std::vector<uint8_t>>& outputs) override;
+    size_t max_batch_size() const override { return max_batch; }
+    std::string getName() const override { return "cpu_mock"; }
+};
+
+#endif // INFERENCEBACKEND_H
@@ -0,0 +1,267 @@
+#ifndef LOCKFREERINGBUFFER_H
+#define LOCKFREERINGBUFFER_H
+
+#include <atomic>
+#include <cstdint>
+#include <vector>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <condition_variable>
+#include <stdexcept>
+#include <rtadp/MessageQueue.h>
+#include <rtadp/CpuRelax.h>
+
+// Bounded multi-producer multi-consumer lock-free queue (D. Vyukov's algorithm).
+// Each cell carries a sequence number that tells producers and consumers whether it is free or full,
+// so push and pop only need one CAS on the shared position. The enqueue and dequeue positions
+// are kept on separate cache lines to avoid false sharing between producers and consumers.
+// The non-blocking operations are try_push/try_pop; push/get spin for a while and then park
+// on a condition variable, which is only touched when a thread is actually waiting.
+template <typename T>
+class LockFreeRingBuffer : public MessageQueue<T> {
+private:
+    struct Cell {
+        std::atomic<size_t> sequence;
+        T data;
+    };
+
+    static constexpr int SPIN_LIMIT = 256;  // Spins before parking a blocked thread
+
+    std::unique_ptr<Cell[]> buffer;
+    const size_t capacity;
+    const size_t mask;
+
+    alignas(CACHE_LINE_SIZE) std::atomic<size_t> enqueue_pos{0};
+    alignas(CACHE_LINE_SIZE) std::atomic<size_t> dequeue_pos{0};
+    alignas(CACHE_LINE_SIZE) std::atomic<bool> _stop{false};
+
+    // Parking of blocked producers and consumers
+    std::atomic<int> waiting_consumers{0};
+    std::atomic<int> waiting_producers{0};
+    std::mutex wait_mtx;
+    std::condition_variable not_empty;
+    std::condition_variable not_full;
+
+    static size_t round_up_pow2(size_t value) {
+        size_t result = 2;
+        while (result < value) {
+            result <<= 1;
+        }
+        return result;
+    }
+
+    template <typename U>
+    bool enqueue(U&& value) {
+        if (!claim_and_store(std::forward<U>(value))) {
+            return false;
+        }
+        wake(waiting_consumers, not_empty);
+        return true;
+    }
+
+    // enqueue() without waking the consumers
+    template <typename U>
+    bool claim_and_store(U&& value) {
+        Cell* cell;
+        size_t pos = enqueue_pos.load(std::memory_order_relaxed);
+
+        for (;;) {
+            cell = &buffer[pos & mask];
+            size_t seq = cell->sequence.load(std::memory_order_acquire);
+            intptr_t diff = static_cast<intptr_t>(seq) - static_cast<intptr_t>(pos);
+
+            if (diff == 0) {
+                if (enqueue_pos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+                    break;
+                }
+            }
+            else if (diff < 0) {
+                return false;   // Full
+            }
+            else {
+                pos = enqueue_pos.load(std::memory_order_relaxed);
+            }
+        }
+
+        cell->data = std::forward<U>(value);
+        cell->sequence.store(pos + 1, std::memory_order_release);
+        return true;
+    }
+
+    bool dequeue(T& value) {
+        Cell* cell;
+        size_t pos = dequeue_pos.load(std::memory_order_relaxed);
+
+        for (;;) {
+            cell = &buffer[pos & mask];
+            size_t seq = cell->sequence.load(std::memory_order_acquire);
+            intptr_t diff = static_cast<intptr_t>(seq) - static_cast<intptr_t>(pos + 1);
+
+            if (diff == 0) {
+                if (dequeue_pos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+                    break;
+                }
+            }
+            else if (diff < 0) {
+                return false;   // Empty
+            }
+            else {
+                pos = dequeue_pos.load(std::memory_order_relaxed);
+            }
+        }
+
+        value = std::move(cell->data);
+        cell->data = T();   // Release resources held by the moved-from value (e.g. shared payloads)
+        cell->sequence.store(pos + mask + 1, std::memory_order_release);
+        wake(waiting_producers, not_full);
+        return true;
+    }
+
+    // Wake a parked thread, if any. The fence pairs with the one in park() so that either the waiter
+    // sees the new state or the waker sees the waiter.
+    void wake(std::atomic<int>& waiters, std::condition_variable& condvar) {
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        if (waiters.load(std::memory_order_relaxed) > 0) {
+            std::lock_guard<std::mutex> lock(wait_mtx);
+            condvar.notify_all();
+        }
+    }
+
+    template <typename Predicate>
+    void park(std::atomic<int>& waiters, std::condition_variable& condvar, Predicate ready) {
+        waiters.fetch_add(1, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        {
+            std::unique_lock<std::mutex> lock(wait_mtx);
+            condvar.wait(lock, [&] { return _stop.load() || ready(); });
+        }
+        waiters.fetch_sub(1, std::memory_order_relaxed);
+    }
+
+public:
+    // The capacity is rounded up to the next power of two
+    explicit LockFreeRingBuffer(size_t requested_capacity = 65536)
+        : capacity(round_up_pow2(requested_capacity)), mask(capacity - 1) {
+        buffer.reset(new Cell[capacity]);
+        for (size_t i = 0; i < capacity; i++) {
+            buffer[i].sequence.store(i, std::memory_order_relaxed);
+        }
+    }
+
+    ~LockFreeRingBuffer() override = default;
+
+    LockFreeRingBuffer(const LockFreeRingBuffer&) = delete;
+    LockFreeRingBuffer& operator=(const LockFreeRingBuffer&) = delete;
+
+    bool try_push(const T& value) override {
+        return enqueue(value);
+    }
+
+    bool try_push(T&& value) override {
+        return enqueue(std::move(value));
+    }
+
+    // The consumers are woken once for the whole batch
+    size_t try_push_batch(const std::vector<T>& values) override {
+        size_t count = 0;
+        while (count < values.size() && claim_and_store(values[count])) {
+            count++;
+        }
+        if (count > 0) {
+            wake(waiting_consumers, not_empty);
+        }
+        return count;
+    }
+
+    bool try_pop(T& value) override {
+        return dequeue(value);
+    }
+
+    // Blocking push: waits while the ring is full. The value is dropped if the queue is stopped.
+    void push(const T& value) override {
+        for (int spin = 0; !enqueue(value); spin++) {
+            if (_stop) {
+                return;
+            }
+            if (spin < SPIN_LIMIT) {
+                cpu_relax();
+            }
+            else {
+                park(waiting_producers, not_full, [this] { return size() < capacity; });
+            }
+        }
+    }
+
+    void push(T&& value) override {
+        // enqueue() moves from value only when it succeeds
+        for (int spin = 0; !enqueue(std::move(value)); spin++) {
+            if (_stop) {
+                return;
+            }
+            if (spin < SPIN_LIMIT) {
+                cpu_relax();
+            }
+            else {
+                park(waiting_producers, not_full, [this] { return size() < capacity; });
+            }
+        }
+    }
+
+    void push_batch(const std::vector<T>& values) override {
+        for (const auto& value : values) {
+            push(value);
+        }
+    }
+
+    // Blocking get: waits while the ring is empty, throws when the queue is stopped
+    T get() override {
+        T value;
+
+        for (int spin = 0; ; spin++) {
+            if (_stop) {
+                throw std::runtime_error("LockFreeRingBuffer stopped");
+            }
+            if (dequeue(value)) {
+                return value;
+            }
+            if (spin < SPIN_LIMIT) {
+                cpu_relax();
+            }
+            else {
+                park(waiting_consumers, not_empty, [this] { return !empty(); });
+            }
+        }
+    }
+
+    void pop() override {
+        T value;
+        while (!_stop && !dequeue(value)) {
+            park(waiting_consumers, not_empty, [this] { return !empty(); });
+        }
+    }
+
+    // Approximate while producers and consumers are active
+    size_t size() const override {
+        size_t enq = enqueue_pos.load(std::memory_order_acquire);
+        size_t deq = dequeue_pos.load(std::memory_order_acquire);
+        return enq > deq ? enq - deq : 0;
+    }
+
+    bool empty() const override {
+        return size() == 0;
+    }
+
+    size_t get_capacity() const {
+        return capacity;
+    }
+
+    void notify_all() override {
+        std::lock_guard<std::mutex> lock(wait_mtx);
+        _stop = true;
+        not_empty.notify_all();
+        not_full.notify_all();
+    }
+};
+
+#endif // LOCKFREERINGBUFFER_H
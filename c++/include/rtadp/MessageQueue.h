@@ -0,0 +1,46 @@
+#ifndef MESSAGEQUEUE_H
+#define MESSAGEQUEUE_H
+
+#include <cstddef>
+#include <vector>
+
+// Common interface of the queues used between the Supervisor, the WorkerManager and the workers,
+// so that the queue implementation can be selected at runtime (see WorkerManager::create_queue)
+template <typename T>
+class MessageQueue {
+public:
+    virtual ~MessageQueue() = default;
+
+    // Blocking push (blocks only if the queue is bounded and full)
+    virtual void push(const T& value) = 0;
+    virtual void push(T&& value) = 0;
+
+    // Push of a whole batch
+    virtual void push_batch(const std::vector<T>& values) = 0;
+
+    // Non-blocking push, returns false if the queue is full and the value was not taken: the caller keeps it
+    // and can push it again later. A value discarded by an overflow policy (see BoundedQueue) is taken.
+    virtual bool try_push(const T& value) = 0;
+    virtual bool try_push(T&& value) = 0;
+
+    // Non-blocking push of a batch in order, stops at the first value not taken.
+    // Returns the number of values taken, the caller keeps the others (values[count..]).
+    virtual size_t try_push_batch(const std::vector<T>& values) = 0;
+
+    // Blocking pop, throws std::runtime_error when the queue is stopped
+    virtual T get() = 0;
+
+    // Non-blocking pop, returns false if the queue is empty
+    virtual bool try_pop(T& value) = 0;
+
+    // Blocking pop discarding the value
+    virtual void pop() = 0;
+
+    virtual bool empty() const = 0;
+    virtual size_t size() const = 0;
+
+    // Used to wake up all threads waiting on the queue in order to have a clean shutdown
+    virtual void notify_all() = 0;
+};
+
+#endif // MESSAGEQUEUE_H
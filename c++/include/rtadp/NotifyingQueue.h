@@ -0,0 +1,71 @@
+#ifndef NOTIFYINGQUEUE_H
+#define NOTIFYINGQUEUE_H
+
+#include <memory>
+#include <vector>
+#include <rtadp/MessageQueue.h>
+#include <rtadp/WorkSignal.h>
+
+// Queue decorator that signals a WorkSignal after every push, so that the consumers can sleep
+// on several queues at once (e.g. the workers waiting on both the hp and the lp queue)
+template <typename T>
+class NotifyingQueue : public MessageQueue<T> {
+    std::shared_ptr<MessageQueue<T>> queue;
+    std::shared_ptr<WorkSignal> signal;
+
+public:
+    NotifyingQueue(std::shared_ptr<MessageQueue<T>> queue, std::shared_ptr<WorkSignal> signal)
+        : queue(std::move(queue)), signal(std::move(signal)) {}
+
+    void push(const T& value) override {
+        queue->push(value);
+        signal->notify();
+    }
+
+    void push(T&& value) override {
+        queue->push(std::move(value));
+        signal->notify();
+    }
+
+    void push_batch(const std::vector<T>& values) override {
+        queue->push_batch(values);
+        signal->notify(values.size());
+    }
+
+    bool try_push(const T& value) override {
+        if (!queue->try_push(value)) {
+            return false;
+        }
+        signal->notify();
+        return true;
+    }
+
+    bool try_push(T&& value) override {
+        if (!queue->try_push(std::move(value))) {
+            return false;
+        }
+        signal->notify();
+        return true;
+    }
+
+    size_t try_push_batch(const std::vector<T>& values) override {
+        size_t count = queue->try_push_batch(values);
+        if (count > 0) {
+            signal->notify(count);
+        }
+        return count;
+    }
+
+    T get() override { return queue->get(); }
+    bool try_pop(T& value) override { return queue->try_pop(value); }
+    void pop() override { queue->pop(); }
+    bool empty() const override { return queue->empty(); }
+    size_t size() const override { return queue->size(); }
+
+    void notify_all() override {
+        queue->notify_all();
+        signal->notify_all();
+    }
+};
+
+#endif // NOTIFYINGQUEUE_H
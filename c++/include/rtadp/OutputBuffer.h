@@ -0,0 +1,71 @@
+#ifndef OUTPUTBUFFER_H
+#define OUTPUTBUFFER_H
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <vector>
+#include <rtadp/DataMessage.h>
+#include <rtadp/BufferPool.h>
+
+// Result of a worker, written in place by WorkerBase::processData(const DataMessage&, int, OutputBuffer&, WorkerContext&).
+// The bytes are written into blocks of the buffer pool of the Supervisor, which become the result without a copy.
+// A result can have more parts (e.g. a header and a payload, or a part referencing the input payload),
+// sent by the Supervisor as a multipart zmq message without concatenating them.
+//
+//     auto* header = output.reserve(sizeof(Header));     // Write in place, then commit
+//     ...
+//     output.commit(sizeof(Header));
+//     output.next_part();
+//     output.append_part(data);                          // The input payload as second part, not copied
+//
+// Owned by the WorkerContext of the thread: the framework takes the result after each message.
+class OutputBuffer {
+    std::shared_ptr<BufferPool> pool;
+    std::vector<DataMessage> parts;     // Completed parts
+
+    // Part being written
+    uint8_t* block = nullptr;
+    size_t used = 0;
+    size_t capacity = 0;
+
+    void close_part();
+    void release_block();
+
+public:
+    explicit OutputBuffer(std::shared_ptr<BufferPool> pool = nullptr);
+    ~OutputBuffer();
+
+    OutputBuffer(const OutputBuffer&) = delete;
+    OutputBuffer& operator=(const OutputBuffer&) = delete;
+
+    // Room for at least bytes more in the current part; the returned pointer is valid until the next call
+    // of a method of the buffer. The written bytes become part of the result with commit().
+    uint8_t* reserve(size_t bytes);
+    void commit(size_t bytes);
+
+    // Copy the bytes at the end of the current part
+    void append(const void* data, size_t size);
+
+    // Add a vector as a new part, without copying it
+    void append_part(std::vector<uint8_t>&& data);
+
+    // Add a payload shared with other messages (e.g. the input) as a new part, without copying it
+    void append_part(const DataMessage& data);
+
+    // End the current part, the next bytes start a new part
+    void next_part();
+
+    // Bytes of all the parts
+    size_t size() const;
+    size_t part_count() const;
+    bool empty() const { return size() == 0; }
+
+    // Take the result (a multipart message if there is more than one non-empty part), leaving the buffer empty
+    DataMessage take();
+
+    // Discard the content
+    void clear();
+};
+
+#endif // OUTPUTBUFFER_H
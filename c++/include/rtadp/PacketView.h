@@ -0,0 +1,167 @@
+#ifndef PACKETVIEW_H
+#define PACKETVIEW_H
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+#include <type_traits>
+#include <rtadp/DataMessage.h>
+#include <rtadp/OutputBuffer.h>
+
+namespace packet_detail {
+// Bounds checks of the packet views: on in debug builds, and in release builds with RTADP_PACKET_BOUNDS_CHECK
+#if !defined(NDEBUG) || defined(RTADP_PACKET_BOUNDS_CHECK)
+constexpr bool bounds_check = true;
+#else
+constexpr bool bounds_check = false;
+#endif
+}
+
+// Typed, read-only view of a packet serialized by serializePacket<T> (utils2.hh): an int32 size prefix
+// followed by the bytes of the struct T. The packet is read in place from the receive buffer, without
+// copying the struct out of it:
+//
+//     if (PacketView<HeaderWF>::matches(data.data(), data.size())) {
+//         auto packet = PacketView<HeaderWF>::from(data.data(), data.size());
+//         auto samples = RTADP_PACKET_FIELD(packet, nsamples);    // Reads only the field
+//     }
+//
+// The struct starts 4 bytes after the payload, usually not at the alignment of T: the fields are read
+// with memcpy (a plain load once compiled), and in_place() gives a const T* only when it is aligned.
+// T must be trivially copyable, as for serializePacket.
+template <typename T>
+class PacketView {
+    static_assert(std::is_trivially_copyable<T>::value, "PacketView requires a trivially copyable packet struct");
+
+    const uint8_t* body = nullptr;
+
+    explicit PacketView(const uint8_t* body) : body(body) {}
+
+public:
+    using packet_type = T;
+
+    static constexpr size_t PREFIX_SIZE = sizeof(int32_t);
+    static constexpr size_t WIRE_SIZE = PREFIX_SIZE + sizeof(T);
+
+    // True if the payload is a serialized T: long enough and with the size prefix of T
+    static bool matches(const uint8_t* data, size_t size) {
+        if (size < WIRE_SIZE) {
+            return false;
+        }
+        int32_t prefix;
+        std::memcpy(&prefix, data, PREFIX_SIZE);
+        return prefix == static_cast<int32_t>(sizeof(T));
+    }
+
+    // View of a payload known to be a serialized T (e.g. after matches()), checked only in debug builds
+    static PacketView from(const uint8_t* data, size_t size) {
+        if (packet_detail::bounds_check && !matches(data, size)) {
+            throw std::out_of_range("Payload of " + std::to_string(size) + " bytes is not a packet of " +
+                                    std::to_string(sizeof(T)) + " bytes");
+        }
+        return PacketView(data + PREFIX_SIZE);
+    }
+
+    static PacketView from(const DataMessage& data) {
+        return from(data.data(), data.size());
+    }
+
+    // Bytes of the struct, in the receive buffer
+    const uint8_t* bytes() const { return body; }
+
+    bool is_aligned() const {
+        return reinterpret_cast<uintptr_t>(body) % alignof(T) == 0;
+    }
+
+    // The struct in place, nullptr if the receive buffer does not have the alignment of T
+    const T* in_place() const {
+        return is_aligned() ? reinterpret_cast<const T*>(body) : nullptr;
+    }
+
+    // Field of type F at offset in the struct (see RTADP_PACKET_FIELD)
+    template <typename F>
+    F read(size_t offset) const {
+        static_assert(std::is_trivially_copyable<F>::value, "Packet fields must be trivially copyable");
+        if (packet_detail::bounds_check && offset + sizeof(F) > sizeof(T)) {
+            throw std::out_of_range("Field at offset " + std::to_string(offset) + " outside a packet of " +
+                                    std::to_string(sizeof(T)) + " bytes");
+        }
+        F value;
+        std::memcpy(&value, body + offset, sizeof(F));
+        return value;
+    }
+
+    // Copy of the whole struct, for the code that needs a T
+    T load() const {
+        T packet;
+        std::memcpy(&packet, body, sizeof(T));
+        return packet;
+    }
+
+    // Call function with a const T&: in place if aligned, otherwise with a copy on the stack
+    template <typename Function>
+    decltype(auto) visit(Function&& function) const {
+        if (const T* packet = in_place()) {
+            return function(*packet);
+        }
+        T packet = load();
+        return function(static_cast<const T&>(packet));
+    }
+};
+
+// Field of a packet view, read in place: RTADP_PACKET_FIELD(view, field)
+#define RTADP_PACKET_FIELD(view, field) \
+    (view).template read<decltype(std::remove_reference_t<decltype(view)>::packet_type::field)>( \
+        offsetof(typename std::remove_reference_t<decltype(view)>::packet_type, field))
+
+namespace packet_detail {
+
+template <typename... Packets>
+struct DistinctSizes;
+
+template <>
+struct DistinctSizes<> : std::true_type {};
+
+template <typename First, typename... Rest>
+struct DistinctSizes<First, Rest...>
+    : std::integral_constant<bool, ((sizeof(First) != sizeof(Rest)) && ... && true) && DistinctSizes<Rest...>::value> {};
+
+}
+
+// Call handler with the PacketView of the first type in Packets matching the payload; returns false if none matches.
+// The candidates are unrolled at compile time, the packet types are told apart by their size prefix:
+//
+//     dispatch_packet<HeaderWF, HeaderHK>(data.data(), data.size(), [&](auto packet) {
+//         using Packet = typename decltype(packet)::packet_type;
+//         if constexpr (std::is_same<Packet, HeaderWF>::value) { ... } else { ... }
+//     });
+template <typename... Packets, typename Handler>
+bool dispatch_packet(const uint8_t* data, size_t size, Handler&& handler) {
+    static_assert(sizeof...(Packets) > 0, "dispatch_packet requires at least one packet type");
+    static_assert(packet_detail::DistinctSizes<Packets...>::value, "The packet types must have different sizes to be told apart");
+
+    bool handled = false;
+    // Left to right, stops at the first match
+    (void)((PacketView<Packets>::matches(data, size) ? (handler(PacketView<Packets>::from(data, size)), handled = true) : false) || ...);
+    return handled;
+}
+
+template <typename... Packets, typename Handler>
+bool dispatch_packet(const DataMessage& data, Handler&& handler) {
+    return dispatch_packet<Packets...>(data.data(), data.size(), std::forward<Handler>(handler));
+}
+
+// Serialize a packet as serializePacket<T> does, directly into the result of a worker
+template <typename T>
+void write_packet(OutputBuffer& output, const T& packet) {
+    static_assert(std::is_trivially_copyable<T>::value, "write_packet requires a trivially copyable packet struct");
+    int32_t size = sizeof(T);
+    uint8_t* buffer = output.reserve(PacketView<T>::WIRE_SIZE);
+    std::memcpy(buffer, &size, PacketView<T>::PREFIX_SIZE);
+    std::memcpy(buffer + PacketView<T>::PREFIX_SIZE, &packet, sizeof(T));
+    output.commit(PacketView<T>::WIRE_SIZE);
+}
+
+#endif // PACKETVIEW_H
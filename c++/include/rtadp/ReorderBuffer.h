@@ -0,0 +1,72 @@
+#ifndef REORDERBUFFER_H
+#define REORDERBUFFER_H
+
+#include <map>
+#include <deque>
+#include <mutex>
+#include <chrono>
+#include <vector>
+#include <cstdint>
+#include <memory>
+#include <rtadp/DataMessage.h>
+#include <rtadp/MessageQueue.h>
+
+// Puts the results of the workers back in the ingest order using the sequence number of the messages,
+// in front of a result queue. Each processed sequence is inserted once, with or without a result; the
+// results are pushed to the output queue as soon as all the previous sequences have been completed.
+// The buffer is bounded: when more than max_window sequences are waiting, or when the missing
+// sequence has been waited for longer than timeout, the missing sequences are declared lost and skipped.
+class ReorderBuffer {
+    struct Entry {
+        DataMessage message;
+        bool has_result;
+    };
+
+    std::shared_ptr<MessageQueue<DataMessage>> output;
+    mutable std::mutex mtx;
+    std::map<uint64_t, Entry> pending;  // Completed sequences waiting for a previous one
+    std::deque<DataMessage> ready;      // Released results, in order, not yet pushed to the output queue
+    bool draining = false;              // A thread is pushing the ready results (one at a time, to keep the order)
+    uint64_t next_sequence = 0;         // Next sequence to be released
+    size_t max_window;
+    std::chrono::milliseconds timeout;
+    std::chrono::steady_clock::time_point waiting_since;   // Since when next_sequence is missing
+
+    uint64_t lost_count = 0;    // Sequences skipped by timeout or window overflow
+    uint64_t late_count = 0;    // Results arrived after their sequence was skipped (dropped)
+
+    // Move the contiguous completed sequences to the ready results
+    void release();
+
+    // Push the ready results to the output queue without holding the lock, so that a full bounded
+    // output queue does not block the other callers (e.g. the sender draining it in flush_expired).
+    // Only the draining thread pushes; with blocking false a full queue stops the drain.
+    void drain(std::unique_lock<std::mutex>& lock, bool blocking);
+
+    // Skip the missing sequences up to the first pending one
+    void skip_to_first_pending();
+
+    void complete(uint64_t sequence, Entry&& entry);
+
+public:
+    ReorderBuffer(std::shared_ptr<MessageQueue<DataMessage>> output, size_t max_window = 4096,
+                  std::chrono::milliseconds timeout = std::chrono::milliseconds(1000));
+
+    // Insert a completed sequence with its result
+    void insert(uint64_t sequence, DataMessage&& message);
+
+    // Insert a completed sequence that produced no result
+    void skip(uint64_t sequence);
+
+    // Release the results blocked by a sequence missing since longer than the timeout
+    void flush_expired();
+
+    // Drop all the pending results and restart from the given sequence
+    void reset(uint64_t sequence = 0);
+
+    size_t size() const;
+    uint64_t get_lost_count() const;
+    uint64_t get_late_count() const;
+};
+
+#endif // REORDERBUFFER_H
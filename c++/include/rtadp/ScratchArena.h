@@ -0,0 +1,89 @@
+#ifndef SCRATCHARENA_H
+#define SCRATCHARENA_H
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+// Bump allocator for the temporaries of a worker, reset by the framework after each message (or batch).
+// An allocation is a pointer increment in the current chunk; nothing is freed until reset().
+// When a message needs more than the current capacity, new chunks are added, and the next reset()
+// replaces all of them with a single chunk of the total size: after the first messages the arena
+// reaches the peak need of the worker and no longer calls malloc.
+// Not thread safe: an arena belongs to one worker thread; only the statistics can be read by other threads.
+class ScratchArena {
+    struct Chunk {
+        std::unique_ptr<uint8_t[]> data;
+        size_t size;
+    };
+
+    std::vector<Chunk> chunks;
+    size_t current = 0;         // Chunk in use
+    size_t offset = 0;          // First free byte in the current chunk
+    size_t used_bytes = 0;      // Allocated since the last reset, including the alignment padding
+    size_t min_chunk_size;
+
+    std::atomic<size_t> high_water{0};
+    std::atomic<size_t> capacity_bytes{0};
+    std::atomic<uint64_t> chunk_allocations{0};
+
+    void add_chunk(size_t size);
+
+public:
+    explicit ScratchArena(size_t initial_bytes);
+
+    ScratchArena(const ScratchArena&) = delete;
+    ScratchArena& operator=(const ScratchArena&) = delete;
+
+    // Uninitialized memory valid until the next reset(); alignment must be a power of two
+    void* allocate(size_t size, size_t alignment = alignof(std::max_align_t));
+
+    template <typename T>
+    T* allocate_array(size_t count) {
+        return static_cast<T*>(allocate(count * sizeof(T), alignof(T)));
+    }
+
+    // Release all the allocations
+    void reset();
+
+    size_t getUsed() const { return used_bytes; }
+    size_t getCapacity() const { return capacity_bytes; }
+    // Largest usage between two resets
+    size_t getHighWater() const { return high_water; }
+    // Chunks allocated with malloc, growing while the arena warms up
+    uint64_t getChunkAllocations() const { return chunk_allocations; }
+};
+
+// Standard allocator on a ScratchArena, for containers of temporaries:
+//     ScratchVector<float> pixels(ScratchAllocator<float>(context.scratch()));
+// deallocate() is a no-op, the memory is released by the reset of the arena.
+template <typename T>
+class ScratchAllocator {
+    ScratchArena* arena;
+
+    template <typename U>
+    friend class ScratchAllocator;
+
+public:
+    using value_type = T;
+
+    explicit ScratchAllocator(ScratchArena& arena) : arena(&arena) {}
+
+    template <typename U>
+    ScratchAllocator(const ScratchAllocator<U>& other) : arena(other.arena) {}
+
+    T* allocate(size_t count) { return arena->allocate_array<T>(count); }
+    void deallocate(T*, size_t) {}
+
+    template <typename U>
+    bool operator==(const ScratchAllocator<U>& other) const { return arena == other.arena; }
+    template <typename U>
+    bool operator!=(const ScratchAllocator<U>& other) const { return arena != other.arena; }
+};
+
+template <typename T>
+using ScratchVector = std::vector<T, ScratchAllocator<T>>;
+
+#endif // SCRATCHARENA_H
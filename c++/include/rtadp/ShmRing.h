@@ -0,0 +1,106 @@
+#ifndef SHMRING_H
+#define SHMRING_H
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <semaphore.h>
+#include <rtadp/CpuRelax.h>
+
+// Single-producer single-consumer ring of variable-size records in a memory region shared between
+// processes (POSIX shared memory mapped by both). The ring does not own the memory: the creator
+// initializes the region with create(), the other process uses attach() on its own mapping.
+// Producer and consumer positions are on separate cache lines. A blocked side sleeps on a
+// process-shared semaphore, which is posted only when the other side is actually waiting.
+class ShmRing {
+public:
+    // Record types
+    static constexpr uint32_t RECORD_DATA = 0;
+    static constexpr uint32_t RECORD_CONFIG = 1;   // Payload is a json configuration
+    static constexpr uint32_t RECORD_WRAP = 2;     // Internal: the next record is at the start of the ring
+
+    struct Record {
+        uint32_t type;
+        uint32_t priority;
+        uint64_t size;
+        uint64_t sequence;
+        int64_t ingest_ns;      // steady_clock time since epoch (the clock is shared by the processes)
+        const uint8_t* data;    // Valid until consume()
+    };
+
+private:
+    struct RecordHeader {
+        uint32_t type;
+        uint32_t priority;
+        uint64_t size;
+        uint64_t sequence;
+        int64_t ingest_ns;
+    };
+
+    struct Header {
+        alignas(CACHE_LINE_SIZE) std::atomic<uint64_t> head;   // Bytes written, producer only
+        alignas(CACHE_LINE_SIZE) std::atomic<uint64_t> tail;   // Bytes consumed, consumer only
+        alignas(CACHE_LINE_SIZE) std::atomic<int> consumer_waiting;
+        std::atomic<int> producer_waiting;
+        std::atomic<int> stopped;
+        uint64_t capacity;
+        sem_t items;
+        sem_t space;
+    };
+
+    Header* header = nullptr;
+    uint8_t* buffer = nullptr;
+
+    static size_t record_size(size_t payload) {
+        return sizeof(RecordHeader) + ((payload + 7) & ~static_cast<size_t>(7));
+    }
+
+    static size_t header_size() {
+        return (sizeof(Header) + CACHE_LINE_SIZE - 1) & ~(CACHE_LINE_SIZE - 1);
+    }
+
+    // Sleep on a semaphore until posted, stopped or timeout, using the waiting flag protocol
+    template <typename Ready>
+    bool wait(std::atomic<int>& waiting, sem_t& semaphore, std::chrono::microseconds timeout, Ready ready);
+
+    void wake(std::atomic<int>& waiting, sem_t& semaphore);
+
+public:
+    ShmRing() = default;
+
+    // Bytes of shared memory needed for a ring of the given capacity (rounded up to 8 bytes)
+    static size_t required_size(size_t capacity);
+
+    // Initialize a ring in memory, capacity as passed to required_size()
+    static ShmRing create(void* memory, size_t capacity);
+
+    // Use a ring initialized by create() in another mapping of the same memory
+    static ShmRing attach(void* memory);
+
+    bool valid() const { return header != nullptr; }
+
+    // Largest payload that can be written
+    size_t max_payload() const;
+
+    // Producer: write a record, waiting up to timeout while the ring is full.
+    // Returns false on timeout, when the ring is stopped or if the payload is larger than max_payload().
+    bool write(uint32_t type, uint32_t priority, uint64_t sequence, int64_t ingest_ns,
+               const uint8_t* data, size_t size, std::chrono::microseconds timeout);
+
+    // Consumer: wait up to timeout for a record. The record stays in the ring until consume()
+    bool peek(Record& record, std::chrono::microseconds timeout);
+    void consume(const Record& record);
+
+    bool empty() const;
+    size_t used_bytes() const;
+
+    // Wake both sides and make the blocking calls return false
+    void stop();
+    bool is_stopped() const;
+
+    // Destroy the semaphores, by the creator when both processes are done
+    void destroy();
+};
+
+#endif // SHMRING_H
@@ -0,0 +1,105 @@
+#ifndef SPILLQUEUE_H
+#define SPILLQUEUE_H
+
+#include <atomic>
+#include <functional>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+#include <rtadp/MessageQueue.h>
+#include <rtadp/DataMessage.h>
+
+// Parameters of the spill to disk of a queue
+struct SpillConfig {
+    std::string directory = "/tmp";     // Local disk directory of the segment files
+    size_t high_water = 100000;         // Messages in memory above which the new messages are spilled
+    size_t low_water = 50000;           // Messages in memory below which the spilled messages are read back
+    size_t segment_bytes = 64 << 20;    // Size of a segment file
+    bool try_push = false;              // Never wait on the wrapped queue: spill when it is full, refill until it is full
+};
+
+// Queue decorator that moves the overflow of a queue to disk.
+// When the wrapped (in memory) queue holds high_water messages, the new messages are appended to
+// memory-mapped segment files instead. Once the consumers bring the queue below low_water, the
+// spilled messages are read back into the queue in order. While anything is spilled, every new
+// message is spilled too, so the order of the messages is preserved.
+// The messages read back reference the mapped segment, which is unmapped and deleted once all its
+// messages have been read and released. The segments are a temporary buffer and are not recovered after a restart.
+class SpillQueue : public MessageQueue<DataMessage> {
+public:
+    // Called with the number of messages read back from disk, to wake the consumers
+    using RefillCallback = std::function<void(size_t)>;
+
+private:
+    struct Segment;
+
+    std::shared_ptr<MessageQueue<DataMessage>> queue;
+    SpillConfig spill_config;
+    std::string file_prefix;
+    RefillCallback on_refill;
+
+    mutable std::mutex mtx;
+    std::deque<std::shared_ptr<Segment>> segments;  // Oldest first, the last one is being written
+    uint64_t segment_counter = 0;
+    std::atomic<size_t> spilled_messages{0};    // Messages currently on disk
+    std::atomic<size_t> spilled_bytes{0};       // Bytes of the segment files on disk
+
+    std::atomic<uint64_t> spilled_total{0};     // Messages spilled since the start
+    std::atomic<uint64_t> spill_errors{0};      // Messages not spilled because the spill failed
+
+    // Append a message to the last segment, opening a new one if needed. Called with the lock held.
+    bool append(const DataMessage& value);
+
+    // Move spilled messages back to the queue up to high_water, returns the number of messages moved.
+    // Called with the lock held.
+    size_t refill_locked();
+
+    // Move spilled messages back if the queue is below low_water
+    void refill();
+
+    std::shared_ptr<Segment> open_segment(size_t min_bytes);
+
+    // Spill or push a message, returns false if the spill failed and the queue (try_push mode) is full
+    template <typename U>
+    bool spill_push(U&& value);
+
+    // Called with the lock held
+    template <typename U>
+    bool spill_locked(U&& value);
+
+public:
+    // name is used in the segment file names: <directory>/rtadp-spill-<name>-<pid>-<n>.seg
+    SpillQueue(std::shared_ptr<MessageQueue<DataMessage>> queue, const SpillConfig& config, const std::string& name,
+               RefillCallback on_refill = nullptr);
+    ~SpillQueue() override;
+
+    SpillQueue(const SpillQueue&) = delete;
+    SpillQueue& operator=(const SpillQueue&) = delete;
+
+    void push(const DataMessage& value) override;
+    void push(DataMessage&& value) override;
+    void push_batch(const std::vector<DataMessage>& values) override;
+    bool try_push(const DataMessage& value) override;
+    bool try_push(DataMessage&& value) override;
+    size_t try_push_batch(const std::vector<DataMessage>& values) override;
+
+    DataMessage get() override;
+    bool try_pop(DataMessage& value) override;
+    void pop() override;
+
+    bool empty() const override;
+    size_t size() const override;   // Messages in memory and on disk
+
+    void notify_all() override;
+
+    size_t get_spilled_messages() const { return spilled_messages; }
+    size_t get_spilled_bytes() const { return spilled_bytes; }
+    size_t get_segment_count() const;
+    uint64_t get_spilled_total() const { return spilled_total; }
+    uint64_t get_spill_errors() const { return spill_errors; }
+};
+
+#endif // SPILLQUEUE_H
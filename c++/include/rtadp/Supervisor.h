@@ -8,6 +8,12 @@
 #include "json.hpp"
 #include <thread>
 #include <queue>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <map>
+#include <functional>
 #include <csignal>
 #include <unistd.h>
 #include <sys/types.h>
@@ -17,6 +23,9 @@
 #include <rtadp/WorkerLogger.h>
 #include <rtadp/ConfigurationManager.h>
 #include <rtadp/WorkerManager.h>
+#include <rtadp/WorkerPool.h>
+#include <rtadp/DataMessage.h>
+#include <rtadp/BufferPool.h>
 
 
 #include "avro/ValidSchema.hh"
@@ -26,6 +35,12 @@ using json = nlohmann::json;
 
 void setup_signal_handlers(Supervisor* supervisor);
 
+// Batch-drain parameters of a data channel
+struct IngestChannelConfig {
+    size_t batch_size = 128;    // Max messages received after a wake-up
+    std::chrono::microseconds drain_budget{1000};   // Max time spent draining the socket after a wake-up
+};
+
 class Supervisor {
 
     // Static pointer to the current instance
@@ -38,6 +53,23 @@ class Supervisor {
     void receive_and_process_string(zmq::socket_t* socket, bool is_low_priority, const std::string& log_context);
     void receive_and_process_file(zmq::socket_t* socket, bool is_low_priority, const std::string& log_context);
 
+    // Helper functions used by the poller-based ingest engine
+    void receive_data(zmq::socket_t* socket, bool is_low_priority, const std::string& log_context);
+    void receive_and_process_command(zmq::socket_t* socket);
+    void update_ingest_rate(std::chrono::steady_clock::time_point& last_time, uint64_t& last_lp_count, uint64_t& last_hp_count);
+
+    // Push ingested messages to the input queues of the managers without blocking: the messages refused
+    // by a full queue are held in the ingest backlog of the manager, behind them the next ones
+    void push_ingest(const std::vector<DataMessage>& messages, bool is_low_priority);
+
+    // Retry the messages held back in the backlog of a channel, returns true when it is empty
+    bool flush_ingest_backlog(bool is_low_priority);
+
+    // Helper functions used by the result thread
+    void send_result_channel(WorkerManager* manager, int indexmanager, const DataMessage& data, int channel);
+    bool send_result_data(zmq::socket_t* socket, const DataMessage& data, const std::string& dataflow_type);
+    void update_result_stats();
+
     std::shared_ptr<std::mutex> sendresultslock;
 
     std::condition_variable cv;
@@ -65,9 +97,15 @@ public:
     // Set up result channel for a given WorkerManager
     void setup_result_channel(WorkerManager *manager, int indexmanager);
 
-    // Start managers
+    // Start managers: one WorkerManager for each entry of the "manager" array
     virtual void start_managers();
 
+    // Create the WorkerManager of an entry of the "manager" array, override to use a derived manager
+    virtual WorkerManager* create_manager(int indexmanager, const std::string& manager_name);
+
+    // Connect the results of each manager to the input queues of its "downstream" managers
+    void connect_managers();
+
     // Start workers
     void start_workers();
 
@@ -77,11 +115,29 @@ public:
     // Static function to handle signals
     void handle_signals(int signum);
 
-    // Listen for result data
-    void listen_for_result();
+    // Result sender of a manager, runs in its own thread
+    void listen_for_result(WorkerManager *manager, int indexmanager);
 
-    // Send result data
-    void send_result(WorkerManager *manager, int indexmanager);
+    // Send a batch of result data of a manager, returns the number of results sent
+    size_t send_result(WorkerManager *manager, int indexmanager);
+
+    // Poller-based ingest engine: waits on lp, hp and command sockets together
+    void listen_for_data();
+
+    // Ingest rates (messages/s) measured by the ingest engine
+    double get_ingest_lp_rate() const;
+    double get_ingest_hp_rate() const;
+
+    // Result send statistics of the last second: average send time per message and throughput
+    double get_result_send_time_us() const;
+    double get_result_send_rate_mbs() const;
+
+    // Reserve count consecutive sequence numbers on a channel and return the first one.
+    // Every message pushed to the managers is stamped at ingest, the results are put back in this order.
+    uint64_t next_sequence(bool is_low_priority, uint64_t count = 1);
+
+    // Next sequence number that will be assigned on a channel
+    uint64_t get_next_sequence(bool is_low_priority) const;
 
     // Listen for low priority data
     virtual void listen_for_lp_data();
@@ -113,6 +169,9 @@ public:
     // Reset command
     void command_reset();
 
+    // Scale command: set the number of worker threads and/or enable the autoscaling of the managers
+    void command_scale(const json &command);
+
     // Start command
     void command_start();
 
@@ -160,6 +219,12 @@ public:
 
     std::string getName() const { return name; }
 
+    // Worker pool shared by the managers with "executor": "pool", nullptr without a "worker_pool" block
+    WorkerPool* getWorkerPool() const { return worker_pool.get(); }
+
+    // Storage of the messages of the data path, nullptr if disabled ("enabled": false in the "buffer_pool" block)
+    const std::shared_ptr<BufferPool>& getBufferPool() const { return buffer_pool; }
+
 // Member variables
     std::string name;
     std::string fullname;
@@ -170,10 +235,10 @@ public:
     
     int pid;
     zmq::context_t context;
-    zmq::socket_t *socket_lp_data;
-    zmq::socket_t *socket_hp_data;
-    zmq::socket_t *socket_command;
-    zmq::socket_t *socket_monitoring;
+    zmq::socket_t *socket_lp_data = nullptr;
+    zmq::socket_t *socket_hp_data = nullptr;
+    zmq::socket_t *socket_command = nullptr;
+    zmq::socket_t *socket_monitoring = nullptr;
 
     
 
@@ -186,6 +251,14 @@ public:
     int manager_num_workers;
     std::string manager_result_sockets_type;
     std::string manager_result_dataflow_type;
+    // Parameters of each entry of the "manager" array (the scalars above are the ones of the first entry)
+    std::vector<std::string> manager_names;
+    std::vector<int> managers_num_workers;
+    std::vector<std::string> manager_result_sockets_types;
+    std::vector<std::string> manager_result_dataflow_types;
+    std::string result_encoding;    // raw|json, for binary results
+    size_t result_batch_size;       // Max results sent by a result sender per wake-up
+    size_t result_hp_burst;         // Max consecutive hp results while lp results are waiting
     std::vector<std::string> manager_result_lp_sockets;
     std::vector<std::string> manager_result_hp_sockets;
     std::string workername;
@@ -193,13 +266,46 @@ public:
     std::string processingtype;
     std::string dataflowtype;
     std::string datasockettype;
+    std::string ingestmode;     // poller|threads
+    IngestChannelConfig ingest_lp_config;
+    IngestChannelConfig ingest_hp_config;
     std::vector<WorkerManager*> manager_workers;
     int processdata;
-    bool stopdata;
+    std::atomic<bool> stopdata{true};
     std::string status;
     std::thread lp_data_thread;
     std::thread hp_data_thread;
-    std::thread result_thread;
+    std::thread ingest_thread;
+    std::vector<std::thread> result_threads;    // One result sender per manager
+    std::unique_ptr<WorkerPool> worker_pool;
+    std::shared_ptr<BufferPool> buffer_pool;
+    // Ingest batches of the lp and hp channels, reused to keep their capacity
+    std::vector<DataMessage> ingest_lp_batch;
+    std::vector<DataMessage> ingest_hp_batch;
+    // Ingested messages refused by a full input queue (overflow "block"), per manager and channel.
+    // A channel is not read while its backlog is not empty, so the ingest thread never waits on a queue.
+    std::map<WorkerManager*, std::vector<DataMessage>> ingest_lp_backlog;
+    std::map<WorkerManager*, std::vector<DataMessage>> ingest_hp_backlog;
+    std::mutex ingest_backlog_mtx;  // The backlogs are also flushed and cleared by the commands
+
+    // Ingest engine counters
+    std::atomic<uint64_t> ingest_lp_count{0};
+    std::atomic<uint64_t> ingest_hp_count{0};
+    std::atomic<double> ingest_lp_rate{0.0};
+    std::atomic<double> ingest_hp_rate{0.0};
+
+    // Result send counters, reset every second by update_result_stats
+    std::atomic<uint64_t> result_send_count{0};
+    std::atomic<uint64_t> result_send_bytes{0};
+    std::atomic<uint64_t> result_send_time_ns{0};
+    std::atomic<double> result_send_time_us{0.0};
+    std::atomic<double> result_send_rate_mbs{0.0};
+    std::chrono::steady_clock::time_point result_stats_time;
+    std::mutex result_stats_mtx;
+
+    // Ingest sequence numbers, one sequence per channel
+    std::atomic<uint64_t> lp_sequence{0};
+    std::atomic<uint64_t> hp_sequence{0};
 };
 
 #endif // SUPERVISOR_H
\ No newline at end of file
@@ -2,12 +2,15 @@
 #define THREADSAFEQUEUE_H
 
 #include <queue>
+#include <vector>
 #include <mutex>
 #include <condition_variable>
+#include <stdexcept>
+#include <rtadp/MessageQueue.h>
 
 // Class used to redefine the standard C++ queue methods, in order to make them more thread-safe and concurrent-access safe
 template <typename T>   // To work with any data type
-class ThreadSafeQueue {
+class ThreadSafeQueue : public MessageQueue<T> {
 private:
     std::queue<T> queue;
     mutable std::mutex mtx;     // Mutex for thread synchronization
@@ -16,15 +19,51 @@ private:
 
 public:
     ThreadSafeQueue() = default;
-    ~ThreadSafeQueue() = default;
+    ~ThreadSafeQueue() override = default;
 
     // Thread-safe push
-    void push(const T& value) {
+    void push(const T& value) override {
         std::lock_guard<std::mutex> lock(mtx);
         queue.push(value);
         condvar.notify_one();
     }
 
+    // Thread-safe push, moving the value into the queue
+    void push(T&& value) override {
+        std::lock_guard<std::mutex> lock(mtx);
+        queue.push(std::move(value));
+        condvar.notify_one();
+    }
+
+    // Thread-safe push of a whole batch under a single lock
+    void push_batch(const std::vector<T>& values) override {
+        if (values.empty()) {
+            return;
+        }
+
+        std::lock_guard<std::mutex> lock(mtx);
+        for (const auto& value : values) {
+            queue.push(value);
+        }
+        condvar.notify_all();
+    }
+
+    // The queue is unbounded, try_push always succeeds
+    bool try_push(const T& value) override {
+        push(value);
+        return true;
+    }
+
+    bool try_push(T&& value) override {
+        push(std::move(value));
+        return true;
+    }
+
+    size_t try_push_batch(const std::vector<T>& values) override {
+        push_batch(values);
+        return values.size();
+    }
+
     // Thread-safe front
     T front() {
         std::unique_lock<std::mutex> lock(mtx);
@@ -41,7 +80,7 @@ public:
     }
 
     // Combination of atomic front + pop
-    T get() {
+    T get() override {
         std::unique_lock<std::mutex> lock(mtx);
         condvar.wait(lock, [this] { return _stop || !queue.empty(); });
 
@@ -49,13 +88,25 @@ public:
             throw std::runtime_error("ThreadSafeQueue stopped");
         }
 
-        T value = queue.front();
+        T value = std::move(queue.front());
         queue.pop();
         return value;
     }
 
+    // Non-blocking get
+    bool try_pop(T& value) override {
+        std::lock_guard<std::mutex> lock(mtx);
+        if (_stop || queue.empty()) {
+            return false;
+        }
+
+        value = std::move(queue.front());
+        queue.pop();
+        return true;
+    }
+
     // Thread-safe pop
-    void pop() {
+    void pop() override {
         std::unique_lock<std::mutex> lock(mtx);
         condvar.wait(lock, [this] { return _stop || !queue.empty(); });
 
@@ -67,19 +118,19 @@ public:
     }
 
     // Thread-safe empty
-    bool empty() const {
+    bool empty() const override {
         std::lock_guard<std::mutex> lock(mtx);
         return queue.empty();
     }
 
     // Thread-safe size
-    size_t size() const {
+    size_t size() const override {
         std::lock_guard<std::mutex> lock(mtx);
         return queue.size();
     }
 
     // Used to wake up all threads waiting on the queues in order to have a clean shutdown
-    void notify_all() {
+    void notify_all() override {
         std::lock_guard<std::mutex> lock(mtx);
         _stop = true;
         condvar.notify_all();
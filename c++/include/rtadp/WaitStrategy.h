@@ -0,0 +1,51 @@
+#ifndef WAITSTRATEGY_H
+#define WAITSTRATEGY_H
+
+#include <chrono>
+#include <memory>
+#include <string>
+#include <cstdint>
+#include <rtadp/json.hpp>
+#include <rtadp/WorkSignal.h>
+
+// How an idle worker waits for new data on the WorkSignal of its manager.
+// The strategy is selected per manager with "wait_strategy" in the manager configuration.
+class WaitStrategy {
+public:
+    virtual ~WaitStrategy() = default;
+
+    // Return when the signal changed after the ticket was taken, it was stopped or the timeout expired
+    virtual void wait(WorkSignal& signal, uint64_t ticket, std::chrono::microseconds timeout) = 0;
+
+    virtual std::string getName() const = 0;
+
+    // Create the strategy from its name: blocking|spin_then_park|busy_spin.
+    // Parameters: "spin_us" (spin time before parking for spin_then_park)
+    static std::shared_ptr<WaitStrategy> create(const std::string& name, const nlohmann::json& configuration);
+};
+
+// Sleeps on the condition variable (futex) immediately: no CPU used while idle, wake-up latency of the scheduler
+class BlockingWaitStrategy : public WaitStrategy {
+public:
+    void wait(WorkSignal& signal, uint64_t ticket, std::chrono::microseconds timeout) override;
+    std::string getName() const override { return "blocking"; }
+};
+
+// Spins for a short time to catch bursts with minimal latency, then sleeps as the blocking strategy
+class SpinThenParkWaitStrategy : public WaitStrategy {
+    std::chrono::microseconds spin_time;
+
+public:
+    explicit SpinThenParkWaitStrategy(std::chrono::microseconds spin_time);
+    void wait(WorkSignal& signal, uint64_t ticket, std::chrono::microseconds timeout) override;
+    std::string getName() const override { return "spin_then_park"; }
+};
+
+// Never sleeps: lowest latency, one core per idle worker
+class BusySpinWaitStrategy : public WaitStrategy {
+public:
+    void wait(WorkSignal& signal, uint64_t ticket, std::chrono::microseconds timeout) override;
+    std::string getName() const override { return "busy_spin"; }
+};
+
+#endif // WAITSTRATEGY_H
@@ -0,0 +1,47 @@
+#ifndef WORKSIGNAL_H
+#define WORKSIGNAL_H
+
+#include <atomic>
+#include <mutex>
+#include <chrono>
+#include <cstdint>
+#include <condition_variable>
+
+// Event count used by the workers of a WorkerManager to sleep until new data is pushed in any of
+// the manager queues. A waiter takes a ticket with prepare_wait(), checks the queues and then calls
+// wait(ticket): a notify() that happens after prepare_wait() is never lost.
+// The producers only lock the mutex when some worker is actually sleeping.
+// How a worker waits (sleeping, spinning or both) is decided by its WaitStrategy.
+class WorkSignal {
+    std::atomic<uint64_t> epoch{0};
+    std::atomic<int> waiters{0};
+    std::atomic<bool> stopped{false};
+    std::mutex mtx;
+    std::condition_variable condvar;
+    bool broadcast;     // Wake all the sleeping waiters on every notify
+
+public:
+    explicit WorkSignal(bool broadcast = false);
+
+    // Ticket to be passed to wait()
+    uint64_t prepare_wait() const;
+
+    // True if a notify() or a stop() happened after the ticket was taken
+    bool changed(uint64_t ticket) const;
+
+    // Sleep until a notify() after the ticket was taken, a stop() or the timeout
+    void wait(uint64_t ticket, std::chrono::microseconds timeout);
+
+    // Wake one waiter (count == 1) or all the waiters (count > 1)
+    void notify(size_t count = 1);
+
+    // Wake all the waiters
+    void notify_all();
+
+    // Wake all the waiters and make the next waits return immediately
+    void stop();
+
+    bool is_stopped() const;
+};
+
+#endif // WORKSIGNAL_H
@@ -1,11 +1,14 @@
 #ifndef WORKERBASE_H
 #define WORKERBASE_H
 
+#include <atomic>
 #include <string>
 #include <iostream>
 #include <rtadp/json.hpp> 
 #include <zmq.hpp>     
 #include <rtadp/WorkerLogger.h>
+#include <rtadp/DataMessage.h>
+#include <rtadp/WorkerContext.h>
 #include "spdlog/spdlog.h"
 #include "spdlog/sinks/basic_file_sink.h"
 #include "spdlog/fmt/fmt.h"
@@ -13,11 +16,14 @@
 
 class Supervisor;
 class WorkerManager;
+class DynamicBatcher;
 
 class WorkerBase {
     Supervisor* supervisor = nullptr;
     WorkerManager* manager = nullptr;
     std::string fullname;
+    bool result_deferred = false;
+    std::atomic<bool> missing_override_logged{false};
 
 public:
     std::string workersname;
@@ -33,12 +39,62 @@ public:
 
     // virtual std::string 
     // const std::string& data);
-    virtual std::vector<uint8_t> processData(const std::vector<uint8_t>& data, int priority) = 0;
+    // A worker overrides this method or one of the overloads below. The default implementation is reached
+    // only by a worker overriding none of them (e.g. a wrong signature): it logs an error once and
+    // returns no result, so every message is skipped.
+    virtual std::vector<uint8_t> processData(const std::vector<uint8_t>& data, int priority);
+
+    // Process the payload in place, as received from the socket (no copy).
+    // The default implementation copies the payload into a vector and calls processData(const std::vector<uint8_t>&, int),
+    // override this method to avoid the copy.
+    virtual std::vector<uint8_t> processData(const DataMessage& data, int priority);
+
+    // Entry point called by the framework, with the context of the calling thread (scratch arena for the temporaries).
+    // The default implementation calls processData(const DataMessage&, int),
+    // override this method to use the context.
+    virtual std::vector<uint8_t> processData(const DataMessage& data, int priority, WorkerContext& context);
+
+    // Write the result into output instead of returning a vector: in place (reserve/commit), in more parts
+    // sent as a multipart message (next_part), or referencing existing payloads such as the input (append_part).
+    // data is a view of the input payload (data(), size()) shared with the other managers.
+    // This is the method called by the framework for single messages; the default implementation calls
+    // processData(const DataMessage&, int, WorkerContext&) and adds the returned vector as a part, without copying it.
+    // Nothing written means no result.
+    virtual void processData(const DataMessage& data, int priority, OutputBuffer& output, WorkerContext& context);
+
+    // Process a batch of messages of the same priority, with "batch_size" > 1 in the manager configuration.
+    // results[i] is the result of batch[i], an empty result means no result. A result can be taken from
+    // context.output() (then multipart results are kept) or built with DataMessage::from_vector.
+    // The default implementation calls processData(const DataMessage&, int, OutputBuffer&, WorkerContext&) for each message,
+    // override this method to process the whole batch at once (e.g. vectorized kernels).
+    // The scratch arena is reset after the whole batch.
+    virtual void processBatch(const std::vector<DataMessage>& batch, int priority, std::vector<DataMessage>& results,
+                              WorkerContext& context);
 
     Supervisor* get_supervisor() const{{
         return supervisor;
     }}
 
+    WorkerManager* get_manager() const {
+        return manager;
+    }
+
+    // Batcher of the manager ("batcher" in the manager configuration), nullptr if not configured
+    DynamicBatcher* get_batcher() const;
+
+    // Called from processData/processBatch when the results are delivered later by someone else
+    // (e.g. DynamicBatcher::submit_result): the returned results are ignored and not skipped.
+    void defer_result() {
+        result_deferred = true;
+    }
+
+    // Returns and clears the flag set by defer_result(), called by the framework after processing
+    bool take_result_deferred() {
+        bool deferred = result_deferred;
+        result_deferred = false;
+        return deferred;
+    }
+
 
 };
 
@@ -0,0 +1,38 @@
+#ifndef WORKERCONTEXT_H
+#define WORKERCONTEXT_H
+
+#include <cstddef>
+#include <memory>
+#include <rtadp/ScratchArena.h>
+#include <rtadp/OutputBuffer.h>
+#include <rtadp/BufferPool.h>
+
+// State of the thread (or child process) running a worker, passed to WorkerBase::processData.
+// The scratch arena is reset by the framework after each message (or batch): the memory taken
+// from it must not be referenced by the returned result.
+class WorkerContext {
+    int worker_id;
+    ScratchArena scratch_arena;
+    OutputBuffer output_buffer;
+
+public:
+    // "scratch_bytes" in the manager configuration (in the "worker_pool" block for the pool threads)
+    static constexpr size_t DEFAULT_SCRATCH_BYTES = 1 << 20;
+
+    // The results written in the output buffer are stored in blocks of the pool (nullptr: of the heap)
+    WorkerContext(int worker_id, size_t scratch_bytes, std::shared_ptr<BufferPool> pool = nullptr)
+        : worker_id(worker_id), scratch_arena(scratch_bytes), output_buffer(std::move(pool)) {}
+
+    int getWorkerId() const { return worker_id; }
+
+    ScratchArena& scratch() { return scratch_arena; }
+    const ScratchArena& scratch() const { return scratch_arena; }
+
+    // Result of the message being processed, taken by the framework after processData
+    OutputBuffer& output() { return output_buffer; }
+
+    // Called by the framework after each message or batch
+    void reset() { scratch_arena.reset(); }
+};
+
+#endif // WORKERCONTEXT_H
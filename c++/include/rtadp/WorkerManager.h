@@ -11,11 +11,13 @@
 #include <iostream>
 #include <thread>
 #include <vector>
+#include <map>
 #include <queue>
 #include <mutex>
 #include <condition_variable>
 #include <atomic>
 #include <chrono>
+#include <future>
 #include <zmq.hpp>
 #include <rtadp/MonitoringPoint.h>
 #include <rtadp/WorkerThread.h>
@@ -23,13 +25,38 @@
 #include <rtadp/Supervisor.h>
 #include <rtadp/WorkerProcess.h>
 
+#include <rtadp/MessageQueue.h>
 #include <rtadp/ThreadSafeQueue.h>
+#include <rtadp/LockFreeRingBuffer.h>
+#include <rtadp/NotifyingQueue.h>
+#include <rtadp/BoundedQueue.h>
+#include <rtadp/SpillQueue.h>
+#include <rtadp/WorkSignal.h>
+#include <rtadp/WaitStrategy.h>
+#include <rtadp/ReorderBuffer.h>
+#include <rtadp/DataMessage.h>
+#include <rtadp/AgeHistogram.h>
+#include <rtadp/WorkerRegistry.h>
+#include <rtadp/WorkerPool.h>
+#include <rtadp/Autoscaler.h>
+#include <rtadp/DynamicBatcher.h>
 
 
 using json = nlohmann::json;
 // class WorkerProcess;
 class WorkerThread;
 
+// Throughput counters of a result channel
+struct ResultChannelStats {
+    std::atomic<uint64_t> count{0};
+    std::atomic<uint64_t> bytes{0};
+    std::atomic<double> rate{0.0};      // messages/s
+    std::atomic<double> rate_mbs{0.0};  // MB/s
+    uint64_t last_count = 0;
+    uint64_t last_bytes = 0;
+    std::chrono::steady_clock::time_point last_time = std::chrono::steady_clock::now();
+};
+
 class WorkerManager {
 private:
     int manager_id;
@@ -38,6 +65,7 @@ private:
     std::string status;
     std::string workersname;
     std::shared_ptr<json> config;
+    json manager_config;    // Entry of this manager in the "manager" array
     std::string fullname;
     std::string globalname;
     std::string processingtype;
@@ -52,17 +80,67 @@ private:
     zmq::context_t&  context;
     zmq::socket_t* socket_monitoring;
 
-    std::shared_ptr<ThreadSafeQueue<std::vector<uint8_t>>> low_priority_queue;
-    std::shared_ptr<ThreadSafeQueue<std::vector<uint8_t>>> high_priority_queue;
-    std::shared_ptr<ThreadSafeQueue<std::vector<uint8_t>>> result_lp_queue;
-    std::shared_ptr<ThreadSafeQueue<std::vector<uint8_t>>> result_hp_queue;
+    std::shared_ptr<MessageQueue<DataMessage>> low_priority_queue;
+    std::shared_ptr<MessageQueue<DataMessage>> high_priority_queue;
+    std::shared_ptr<MessageQueue<DataMessage>> result_lp_queue;
+    std::shared_ptr<MessageQueue<DataMessage>> result_hp_queue;
+
+    // Scheduling of the workers on the data queues: token|concurrent
+    std::string scheduling;
+    // The data is processed by the shared WorkerPool of the Supervisor ("executor": "pool")
+    WorkerPool* worker_pool;
+    int pool_weight;
+    // Signalled on every push in the data queues, the idle workers wait on it in concurrent scheduling
+    std::shared_ptr<WorkSignal> work_signal;
+    // How the idle workers wait on work_signal ("wait_strategy" in the manager configuration)
+    std::shared_ptr<WaitStrategy> wait_strategy;
+    // Signalled on every push in the result queues, the result sender of the manager waits on it
+    std::shared_ptr<WorkSignal> result_signal;
+
+    // In-process pipeline between managers
+    bool ingest_input;      // Receives the data of the Supervisor data sockets
+    std::vector<WorkerManager*> downstream_managers;
+
+    // Deadline of the lp data and ingest-to-dequeue age of the data taken by the workers
+    std::chrono::milliseconds lp_max_age;
+    std::atomic<uint64_t> expired_lp_count{0};
+    AgeHistogram age_lp;
+    AgeHistogram age_hp;
+
+    // Batches of the worker threads in concurrent scheduling ("batch_size", "batch_wait_us")
+    size_t batch_size;
+    std::chrono::microseconds batch_wait;
+
+    // Initial size of the scratch arena of each worker ("scratch_bytes")
+    size_t scratch_bytes;
+
+    // hp fast lane: workers reserved to the hp queue ("hp_reserved_*" in the manager configuration)
+    int hp_reserved_workers;
+    bool hp_reserved_lp;                // The reserved workers process lp data when hp is idle
+    std::vector<int> hp_reserved_cpus;  // CPU of each reserved worker, empty for no pinning
+    std::shared_ptr<WorkSignal> hp_signal;  // Signalled on every push in the hp queue
+    std::shared_ptr<WaitStrategy> hp_wait_strategy;
+
+    // Results sent on the lp (0) and hp (1) result channels, updated by the result sender
+    ResultChannelStats result_stats[2];
+
+    // Put the results back in the ingest order before the result queues (if ordered_results is set)
+    bool ordered_results;
+    std::shared_ptr<ReorderBuffer> reorder_lp;
+    std::shared_ptr<ReorderBuffer> reorder_hp;
 
     MonitoringPoint* monitoringpoint;
     MonitoringThread* monitoringthread;
     // std::vector<std::shared_ptr<WorkerThread>> workerprocesses;
-    // std::vector<std::shared_ptr<WorkerProcess>> worker_processes;
     std::thread worker_thread;  // Thread object for running the manager
-    int num_workers;
+    std::atomic<int> num_workers;   // Changed at runtime by scale_workers
+    std::mutex workers_mutex;       // Protects worker_threads while scaling
+    std::unique_ptr<Autoscaler> autoscaler;
+    std::unique_ptr<DynamicBatcher> batcher;   // Shared by the workers, "batcher" in the manager configuration
+    uint64_t retired_busy_ns;       // Busy time of the retired worker threads
+    std::vector<std::future<void>> retiring_workers;   // Stops of the retired worker threads still finishing their message
+    json worker_configuration;      // Last configuration of the workers, applied to the added workers
+    std::atomic<uint64_t> worker_configuration_generation{0};  // Incremented by configworkers, 0 if never configured
     int workersstatus;
     int workersstatusinit;
     std::shared_ptr<std::mutex> tokenresultslock;
@@ -76,8 +154,16 @@ private:
     std::vector<std::atomic<double>> processing_rates_shared;
     std::vector<std::atomic<int>> total_processed_data_count_shared;
  
+    // Helper function to create a queue of the type selected in the manager configuration
+    std::shared_ptr<MessageQueue<DataMessage>> create_queue(const std::string& queue_name);
+    std::map<std::string, std::shared_ptr<BoundedQueue<DataMessage>>> bounded_queues;
+
+    // Helper function to add the spill to disk to the lp queue
+    std::shared_ptr<MessageQueue<DataMessage>> create_spill_queue(const std::string& queue_name, std::shared_ptr<MessageQueue<DataMessage>> queue);
+    std::shared_ptr<SpillQueue> spill_lp_queue;
+
     // Helper function to clean a single queue
-    void clean_single_queue(std::shared_ptr<ThreadSafeQueue<std::vector<uint8_t>>>& queue, const std::string& queue_name);
+    void clean_single_queue(std::shared_ptr<MessageQueue<DataMessage>>& queue, const std::string& queue_name);
  
     // Helper function to close a queue
     void close_queue(std::shared_ptr<std::queue<std::string>>& queue, const std::string& queue_name);
@@ -106,11 +192,42 @@ public:
     // Function to start service threads
     void start_service_threads();
  
-    // Function to start worker threads (to be reimplemented)
+    // Function to start worker threads
     virtual void start_worker_threads(int num_threads);
+
+    // Create the worker of a worker thread, by default the "worker_class" of the manager configuration
+    virtual WorkerBase* create_worker();
+
+    int getNumWorkers() const;
+
+    // Add or retire worker threads to reach num_threads (between 1 and max_workers), returns the new number.
+    // Only with concurrent scheduling and without hp reserved workers, otherwise the number is unchanged.
+    // Does not wait for the retired workers, they are stopped in the background.
+    int scale_workers(int num_threads);
+    bool isScalable() const;
+
+    // Busy time of the worker threads, including the retired ones
+    uint64_t getWorkersBusyTime();
+
+    // nullptr if "autoscale" is not in the manager configuration
+    Autoscaler* getAutoscaler() const;
+
+    // nullptr if "batcher" is not in the manager configuration
+    DynamicBatcher* getBatcher() const;
  
-    // Function to start worker processes (to be reimplemented)
-    // virtual void start_worker_processes(int num_processes);
+    // Function to start worker processes (processing_type "process"), with the workers returned by create_worker()
+    virtual void start_worker_processes(int num_processes);
+
+    // Entry of this manager in the "manager" array of the configuration
+    const json& getManagerConfig() const;
+
+    // Shared worker pool processing the data of this manager, nullptr if the manager owns its workers
+    WorkerPool* getWorkerPool() const;
+
+    // Last configuration received by configworkers (null if none) and its generation: the pool threads
+    // apply it to their workers of this manager when the generation changed since they last did
+    json getWorkerConfiguration();
+    uint64_t getWorkerConfigurationGeneration() const;
  
     // Main run function
     void run();
@@ -145,10 +262,73 @@ public:
     
     MonitoringThread* monitoring_thread;
 
-    std::shared_ptr<ThreadSafeQueue<std::vector<uint8_t>>> getLowPriorityQueue() const;
-    std::shared_ptr<ThreadSafeQueue<std::vector<uint8_t>>> getHighPriorityQueue() const;
-    std::shared_ptr<ThreadSafeQueue<std::vector<uint8_t>>> getResultLpQueue() const;
-    std::shared_ptr<ThreadSafeQueue<std::vector<uint8_t>>> getResultHpQueue() const;
+    std::shared_ptr<MessageQueue<DataMessage>> getLowPriorityQueue() const;
+    std::shared_ptr<MessageQueue<DataMessage>> getHighPriorityQueue() const;
+    std::shared_ptr<MessageQueue<DataMessage>> getResultLpQueue() const;
+    std::shared_ptr<MessageQueue<DataMessage>> getResultHpQueue() const;
+
+    std::shared_ptr<WorkSignal> getWorkSignal() const;
+    std::shared_ptr<WaitStrategy> getWaitStrategy() const;
+    std::shared_ptr<WorkSignal> getResultSignal() const;
+
+    // In-process pipeline: the results are forwarded to the input queues of the downstream managers
+    bool isIngestInput() const;
+    std::vector<std::string> getDownstreamNames() const;   // "downstream" of the manager configuration
+    void add_downstream(WorkerManager* downstream);
+    const std::vector<WorkerManager*>& getDownstreamManagers() const;
+    void forward_result(const DataMessage& result, int priority);
+
+    // Called by the workers on every message taken from the queues: records its age and
+    // returns false if it is lp data older than lp_max_age, which must be skipped
+    bool check_data_age(const DataMessage& data, int priority);
+    uint64_t getExpiredLpCount() const;
+    const AgeHistogram& getAgeHistogram(int priority) const;
+
+    // hp fast lane: the reserved workers are the last hp_reserved_workers worker ids
+    bool isHpReservedWorker(int worker_id) const;
+    bool isHpReservedLp() const;
+    int getHpReservedCpu(int worker_id) const;     // -1 if the worker is not pinned
+    std::shared_ptr<WorkSignal> getHpSignal() const;
+    std::shared_ptr<WaitStrategy> getHpWaitStrategy() const;
+
+    // Queues with a capacity limit, by queue name (lp, hp, result_lp, result_hp)
+    const std::map<std::string, std::shared_ptr<BoundedQueue<DataMessage>>>& getBoundedQueues() const;
+
+    // Spill to disk of the lp queue, nullptr if not configured
+    std::shared_ptr<SpillQueue> getSpillQueue() const;
+
+    // Result channel counters (priority 0 lp, 1 hp)
+    void add_result_sent(int priority, size_t bytes);
+    void update_result_rates();     // Recompute the rates once per second
+    uint64_t getResultSentCount(int priority) const;
+    double getResultRate(int priority) const;
+    double getResultRateMbs(int priority) const;
+
+    // Push a result in the result queue of its channel, through the reorder buffer if results are ordered
+    void push_result(DataMessage&& result, int priority);
+
+    // Mark a sequence as completed without result, so that the following results can be released
+    void skip_result(uint64_t sequence, int priority);
+
+    // Release the ordered results blocked by sequences missing since longer than the reorder timeout
+    void flush_expired_results();
+
+    bool isOrderedResults() const;
+    std::shared_ptr<ReorderBuffer> getReorderBuffer(int priority) const;
+
+    // Max messages passed to WorkerBase::processBatch (1: no batches) and max wait for an lp batch to fill
+    size_t getBatchSize() const;
+    std::chrono::microseconds getBatchWait() const;
+
+    // Initial size of the scratch arena of the WorkerContext of each worker
+    size_t getScratchBytes() const;
+
+    // Largest scratch arena usage of the workers of this manager (threads or processes)
+    size_t getScratchHighWater();
+
+    // Getter for scheduling
+    std::string getScheduling() const;
+    bool isConcurrentScheduling() const;
  
     // Getters for result sockets
     std::string get_result_lp_socket() const { return result_lp_socket; }
@@ -162,6 +342,7 @@ public:
     std::string getStatus() const;
 
     std::vector<std::shared_ptr<WorkerThread>> worker_threads;
+    std::vector<std::shared_ptr<WorkerProcess>> worker_processes;
     std::vector<std::thread> worker_threads_run;  // Vettore per i thread (si pu� eliminare visto che non � usato)
 
 
@@ -172,6 +353,8 @@ public:
     
     int getProcessDataSharedValue() const;
 
+    int getProcessData() const;
+
     // Getter for workersstatus
     int getWorkersStatus() const;
 
@@ -184,7 +367,7 @@ public:
     // Getter for worker_processes
     // std::vector<std::shared_ptr<WorkerThread>> getWorkerProcesses();
 
-    // std::vector<std::shared_ptr<WorkerProcess>> getWorker_Processes();
+    std::vector<std::shared_ptr<WorkerProcess>> getWorkerProcesses();
 
     // Getter for processing_rates_shared
     std::vector<std::atomic<double>>& getProcessingRatesShared();
@@ -0,0 +1,129 @@
+#ifndef WORKERPOOL_H
+#define WORKERPOOL_H
+
+#include <atomic>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include <rtadp/json.hpp>
+#include <rtadp/WorkerLogger.h>
+#include <rtadp/WorkSignal.h>
+#include <rtadp/WaitStrategy.h>
+#include <rtadp/DataMessage.h>
+#include <rtadp/WorkerContext.h>
+
+class WorkerManager;
+class WorkerBase;
+
+// Work-stealing worker threads shared by the managers with "executor": "pool" (configured by the
+// "worker_pool" block of the Supervisor configuration). The managers keep their queues but own no threads.
+// Each pool thread has its own deque of taken messages: when it is empty, the thread takes up to
+// "grab_messages" messages (batch_size for a manager with batches) from the queues of a manager
+// into it, and when the queues are empty too it steals half of the deque of another thread.
+// So the idle cores serve the backlogged managers, and the threads seldom meet on the same queue.
+// The managers are served in proportion to their "pool_weight" (stride scheduling, per thread, the
+// threads starting from different managers); hp data of any manager is taken before lp data.
+// A manager with "batch_size" > 1 gets its messages in batches (WorkerBase::processBatch) of the
+// messages already taken: the pool threads never wait for a batch to fill, batch_wait_us is not used.
+// Each pool thread creates its own worker for each manager (WorkerManager::create_worker) the first
+// time it processes data of that manager, and applies to it the last configuration of the manager
+// (configworkers) before processing a message.
+class WorkerPool {
+    struct Member {
+        WorkerManager* manager;
+        int weight;
+        uint64_t stride;    // Pass increment per message, inversely proportional to the weight
+        size_t batch_size;  // Max messages per processBatch call, 1 for processData
+        std::atomic<uint64_t> processed{0};
+    };
+
+    // Message taken from the queues of a member
+    struct Task {
+        size_t member;
+        DataMessage data;
+    };
+
+    // Messages taken by a pool thread: the owner takes from the front, the thieves from the back
+    struct LocalQueue {
+        std::mutex mtx;
+        std::deque<Task> tasks[2];          // By priority: 0 lp, 1 hp
+        std::atomic<size_t> size{0};        // Both priorities, read by the thieves without the lock
+    };
+
+    struct ThreadState;
+
+    std::vector<std::unique_ptr<Member>> members;
+    std::vector<std::unique_ptr<LocalQueue>> local_queues;     // One per pool thread
+    std::shared_ptr<WorkSignal> signal;     // Notified by the data queues of all the members
+    std::shared_ptr<WaitStrategy> wait_strategy;
+    int num_threads;
+    size_t grab_messages;
+    std::vector<std::thread> threads;
+    std::atomic<bool> stop_event{false};
+    std::atomic<int> busy_threads{0};
+    std::atomic<uint64_t> stolen{0};
+    size_t scratch_bytes;
+    std::vector<std::unique_ptr<WorkerContext>> contexts;   // One per pool thread, shared by its workers
+
+    WorkerLogger* logger;
+    std::string globalname;
+
+    void run(int thread_index);
+
+    // Process the first messages of the given priority in the deque of the thread: one message, or a batch
+    // of messages of the same member. Returns false if there is none.
+    bool run_local(ThreadState& state, int priority);
+
+    // Move messages of the given priority to the deque of the thread, returns false if none was found
+    bool grab(ThreadState& state, int priority);
+    bool steal(ThreadState& state, int priority);
+
+    // Worker of the thread for a member, created on first use and configured with the last configuration
+    WorkerBase* prepare_worker(ThreadState& state, size_t index);
+
+    void process_data(Member& member, WorkerBase* worker, WorkerContext& context, const DataMessage& data, int priority);
+    void process_batch(Member& member, WorkerBase* worker, WorkerContext& context, std::vector<DataMessage>& batch,
+                       int priority, std::vector<DataMessage>& results);
+
+public:
+    // "threads": number of pool threads, 0 for one per available core.
+    // "wait_strategy" (and "spin_us"): how the idle pool threads wait, as for the managers.
+    // "scratch_bytes": initial size of the scratch arena of each pool thread.
+    // "grab_messages": messages taken at once from the queues of a manager (default 16).
+    WorkerPool(const nlohmann::json& configuration, WorkerLogger* logger, const std::string& name);
+    ~WorkerPool();
+
+    WorkerPool(const WorkerPool&) = delete;
+    WorkerPool& operator=(const WorkerPool&) = delete;
+
+    // The data queues of the members notify this signal
+    std::shared_ptr<WorkSignal> getSignal() const;
+
+    // Register a manager before start()
+    void add_manager(WorkerManager* manager, int weight);
+
+    void start();
+    void stop();
+
+    int getNumThreads() const;
+    int getBusyThreads() const;
+
+    // Messages stolen from the deque of another pool thread
+    uint64_t getStolenCount() const;
+
+    // Messages taken from the manager queues and not yet processed, in the deques of the pool threads
+    size_t getLocalQueuedCount() const;
+
+    // Largest scratch arena usage of the pool threads
+    size_t getScratchHighWater() const;
+
+    // Messages of a manager processed by the pool, 0 if not a member
+    uint64_t getProcessedCount(const WorkerManager* manager) const;
+    int getWeight(const WorkerManager* manager) const;
+};
+
+#endif // WORKERPOOL_H
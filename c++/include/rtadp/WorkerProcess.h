@@ -1,65 +1,149 @@
 #ifndef WORKERPROCESS_H
 #define WORKERPROCESS_H
 
-#include <queue>
 #include <thread>
 #include <atomic>
 #include <chrono>
 #include <string>
-#include <iostream>
+#include <vector>
+#include <mutex>
 #include <memory>
-#include <unistd.h> // for pid_t and sleep
-// #include <psutil.h> // Assuming you have a similar library for process management
-#include <rtadp/WorkerManager.h> // Include the Manager class
-#include <rtadp/WorkerBase.h> // Include the Worker class
+#include <utility>
+#include <unistd.h> // for pid_t
 #include <rtadp/json.hpp>  // Include nlohmann::json for configuration
+#include <rtadp/WorkerBase.h> // Include the Worker class
 #include <rtadp/WorkerLogger.h>
+#include <rtadp/WorkSignal.h>
+#include <rtadp/WaitStrategy.h>
+#include <rtadp/ShmRing.h>
+#include <rtadp/DataMessage.h>
 
-#include <rtadp/ThreadSafeQueue.h>
+class Supervisor;
+class WorkerManager;
 
+// Worker running in a child process (processing_type "process"), isolating the worker code from the
+// Supervisor: a crash of the worker does not bring down the pipeline.
+// The parent and the child share a memory region holding a control block, an input ring (data and
+// configuration, both priorities) and a result ring (see ShmRing). In the parent a feeder thread moves
+// the data from the manager queues to the input ring, hp first, keeping at most "process_prefetch"
+// messages in flight; a collector thread moves the results to the manager result queues.
+// The child processes the data in place in the ring, without copies.
+// If the child dies its in-flight sequences are skipped and, with "process_restart", a new child is forked.
+//
+// The children are not forked by the Supervisor but by a zygote: a single-threaded process forked once
+// when the WorkerProcess is created, before its threads. The zygote only forks a child on request, reaps
+// it and reports its exit through a pipe, so a restart does not fork the running, multi-threaded
+// Supervisor. The zygote and the child exit when their parent exits.
+// The zygote is a copy of the Supervisor taken while the manager threads were already running: the worker
+// code must not use the zmq sockets, the logger or any other object shared with the threads of the parent.
 class WorkerProcess {
 public:
-    WorkerProcess(int worker_id, std::shared_ptr<WorkerManager> manager, const std::string& name, std::shared_ptr<WorkerBase> worker);
+    WorkerProcess(int worker_id, WorkerManager* manager, const std::string& name, WorkerBase* worker);
     ~WorkerProcess();
 
     void stop();
     void config(const nlohmann::json& configuration);  // Use nlohmann::json for configuration
-    void run();
-    void start_timer(int interval);
-    
+    void set_processdata(int processdata1);
+
+    int getWorkerId() const;
+    pid_t getPid() const;
+    int get_status() const;
+    double getProcessingRate() const;
+    int getTotalProcessedDataCount() const;
+    uint64_t getRestartCount() const;
+    // Largest scratch arena usage of the child processes
+    size_t getScratchHighWater() const;
+
 private:
-    void workerop();
-    void process_data(const nlohmann::json& data, int priority);
+    struct ControlBlock;
+    struct ZygoteEvent;
 
-    int worker_id;
-    std::shared_ptr<WorkerManager> manager;
-    std::shared_ptr<Supervisor> supervisor;
-    std::shared_ptr<WorkerBase> worker;
+    void create_shared_memory();
+    void reset_rings();
+
+    // Fork the zygote, throws std::runtime_error if it cannot be started
+    void start_zygote();
+    // Main loop of the zygote process, never returns
+    [[noreturn]] void zygote_main(pid_t supervisor_pid, int request_fd, int event_fd);
+    // Ask the zygote to exit and reap it
+    void stop_zygote();
+    // Next event sent by the zygote, false if none within timeout_ms (0: do not wait)
+    bool read_event(ZygoteEvent& event, int timeout_ms);
+    // Wait for the exit of the child reported by the zygote
+    bool wait_child_exit(pid_t pid, std::chrono::milliseconds timeout);
+
+    // Fork a new child through the zygote, returns false if it failed
+    bool spawn();
+    // Main loop of the child process, never returns
+    [[noreturn]] void child_main(pid_t zygote_pid);
+
+    // Threads of the parent
+    void feed();
+    void collect();
+    void start_timer(int interval);
+    void workerop(int interval);
 
-    //////////////////////
-    std::shared_ptr<ThreadSafeQueue<std::vector<uint8_t>>> low_priority_queue;
-    std::shared_ptr<ThreadSafeQueue<std::vector<uint8_t>>> high_priority_queue;
-    /////////////////////
+    // Write a record in the input ring, retrying until written, stopped or the child dies
+    bool write_input(uint32_t type, int priority, const DataMessage& data);
+    void send_data(const DataMessage& data, int priority);
+
+    // Move a result from the result ring to the manager result queue of its channel
+    void handle_result(const ShmRing::Record& record);
+
+    // Reap the child if it exited, skip its in-flight sequences and restart it if configured
+    void check_child();
+
+    int worker_id;
+    WorkerManager* manager;
+    Supervisor* supervisor;
+    WorkerBase* worker;
 
     std::string name;
     std::string workersname;
     std::string fullname;
     std::string globalname;
 
-    pid_t pidprocess;
-
     WorkerLogger* logger;
 
-    MonitoringPoint* monitoringpoint;
+    std::shared_ptr<WorkSignal> work_signal;
+    std::shared_ptr<WaitStrategy> wait_strategy;
+    WorkSignal slot_signal;     // Notified by the collector when an in-flight message completes
+
+    // Shared memory: control block, input ring, result ring
+    void* shared_memory;
+    size_t shared_size;
+    size_t ring_bytes;
+    size_t scratch_bytes;   // Initial size of the scratch arena of the child
+    ControlBlock* control;
+    ShmRing input_ring;
+    ShmRing result_ring;
+    std::mutex input_mutex;     // The input ring has a single producer: feeder and config
+    std::string last_configuration;     // Sent again to a restarted child, protected by input_mutex
+
+    // Zygote forking the children: requests from the parent, events (spawned, exited) from the zygote
+    pid_t zygote_pid;
+    int zygote_request_fd;
+    int zygote_event_fd;
+
+    std::atomic<pid_t> pidprocess;
+    std::atomic<bool> child_alive;
+    bool restart;
+    std::atomic<uint64_t> restart_count;
+
+    // Messages written to the input ring without a result yet: (sequence, priority)
+    size_t prefetch;
+    std::mutex inflight_mutex;
+    std::vector<std::pair<uint64_t, int>> inflight;
 
     std::atomic<bool> stop_event;
+    std::atomic<int> processdata;
+    std::atomic<int> status;    // Set when the child is not running (0 init, 16 stop, 32 crashed)
 
-    double start_time;
-    double next_time;
-    int processed_data_count;
-    int total_processed_data_count;
-    double processing_rate;
+    std::atomic<double> processing_rate;
+    std::atomic<int> total_processed_data_count;
 
+    std::unique_ptr<std::thread> feeder_thread;
+    std::unique_ptr<std::thread> collector_thread;
     std::unique_ptr<std::thread> timer_thread;
 };
 
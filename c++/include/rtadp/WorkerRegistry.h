@@ -0,0 +1,38 @@
+#ifndef WORKERREGISTRY_H
+#define WORKERREGISTRY_H
+
+#include <functional>
+#include <map>
+#include <mutex>
+#include <string>
+#include <vector>
+
+class WorkerBase;
+
+// Registry of the worker classes that can be selected by name with "worker_class" in the manager configuration.
+// A worker class is registered once, usually next to its definition:
+//     RTADP_REGISTER_WORKER(RateWorker)
+// or explicitly:
+//     WorkerRegistry::register_worker("RateWorker", [] { return new RateWorker(); });
+class WorkerRegistry {
+public:
+    using Factory = std::function<WorkerBase*()>;
+
+    // Returns true so that it can be used in a static initializer
+    static bool register_worker(const std::string& name, Factory factory);
+
+    // New instance of a registered worker class, nullptr if the name is not registered
+    static WorkerBase* create(const std::string& name);
+
+    static bool contains(const std::string& name);
+    static std::vector<std::string> names();
+
+private:
+    static std::map<std::string, Factory>& factories();
+    static std::mutex& registry_mutex();
+};
+
+#define RTADP_REGISTER_WORKER(WorkerClass) \
+    static const bool WorkerClass##_registered = WorkerRegistry::register_worker(#WorkerClass, [] { return new WorkerClass(); })
+
+#endif // WORKERREGISTRY_H
@@ -19,7 +19,11 @@
 #include <rtadp/WorkerBase.h>
 #include <rtadp/WorkerLogger.h>
 #include <rtadp/MonitoringPoint.h>
-#include <rtadp/ThreadSafeQueue.h>
+#include <rtadp/MessageQueue.h>
+#include <rtadp/WorkSignal.h>
+#include <rtadp/WaitStrategy.h>
+#include <rtadp/DataMessage.h>
+#include <rtadp/WorkerContext.h>
 
 using json = nlohmann::json;
 
@@ -34,8 +38,21 @@ class WorkerThread {
     std::string globalname;
     WorkerLogger* logger;
 
-    std::shared_ptr<ThreadSafeQueue<std::vector<uint8_t>>> low_priority_queue;
-    std::shared_ptr<ThreadSafeQueue<std::vector<uint8_t>>> high_priority_queue;
+    std::shared_ptr<MessageQueue<DataMessage>> low_priority_queue;
+    std::shared_ptr<MessageQueue<DataMessage>> high_priority_queue;
+    std::shared_ptr<WorkSignal> work_signal;
+    std::shared_ptr<WaitStrategy> wait_strategy;
+    bool concurrent_scheduling;
+
+    // hp fast lane
+    bool hp_reserved;
+    bool hp_reserved_lp;
+    std::shared_ptr<WorkSignal> hp_signal;
+    std::shared_ptr<WaitStrategy> hp_wait_strategy;
+
+    // Batches of up to batch_size messages, waiting up to batch_wait for an lp batch to fill
+    size_t batch_size;
+    std::chrono::microseconds batch_wait;
 
     MonitoringPoint* monitoringpoint;
 
@@ -44,11 +61,13 @@ class WorkerThread {
     int processed_data_count;
     int total_processed_data_count;
     double processing_rate;
+    std::atomic<uint64_t> busy_ns{0};  // Time spent in processData
+    std::unique_ptr<WorkerContext> context;    // Passed to processData, reset after each message or batch
     std::atomic<bool> _stop_event;
     std::atomic<int> processdata;
     std::atomic<int> status;
-    int tokenresult;
-    int tokenreading;
+    std::atomic<int> tokenresult;
+    std::atomic<int> tokenreading;
     std::unique_ptr<std::thread> timer;
     // std::thread worker_thread; 
 
@@ -58,7 +77,22 @@ class WorkerThread {
 
     void start_timer(int interval);
     void workerop(int interval);
-    void process_data(const std::vector<uint8_t>& data, int priority);
+    void process_data(const DataMessage& data, int priority);
+    void process_batch(std::vector<DataMessage>& batch, int priority, std::vector<DataMessage>& results);
+
+    // Append the messages available in the queue to the batch, up to batch_size; returns the number appended
+    size_t pop_batch(MessageQueue<DataMessage>& queue, std::vector<DataMessage>& batch);
+
+    // Worker loops for the token and concurrent scheduling of the manager
+    void run_token();
+    void run_concurrent();
+    // Concurrent scheduling with batches (batch_size > 1)
+    void run_batch();
+    // Worker loop of the workers reserved to the hp queue
+    void run_hp_reserved();
+
+    // Pin the worker thread to a CPU
+    void set_cpu_affinity(int cpu);
 
 
 public:
@@ -85,6 +119,12 @@ public:
 
     int getTotalProcessedDataCount() const;
 
+    // Total time spent processing data, for the utilization of the worker
+    uint64_t getBusyTime() const;
+
+    // Largest usage of the scratch arena of the worker
+    size_t getScratchHighWater() const;
+
     bool joinable() const;
     void join();
 
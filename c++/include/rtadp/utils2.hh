@@ -30,7 +30,8 @@ void pushPacketToQueue(std::queue<std::vector<uint8_t>>& queue, const T& packet)
     queue.push(std::move(serializedPacket));    // Move (rather than copying) to avoid unnecessary memory allocations
 }
 
-// Function to serialize packets of type T into a vector and return them
+// Function to serialize packets of type T into a vector and return them.
+// Read them back in place with PacketView<T>, write them into a worker result with write_packet<T> (PacketView.h)
 template <typename T>
 std::vector<uint8_t> serializePacket(const T& packet) {
     int32_t size = sizeof(T);
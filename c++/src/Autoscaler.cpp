@@ -0,0 +1,151 @@
+// Copyright (C) 2024 INAF
+// This software is distributed under the terms of the BSD-3-Clause license
+//
+// Authors:
+//
+//    Andrea Bulgarelli <andrea.bulgarelli@inaf.it>
+//
+
+#include <rtadp/Autoscaler.h>
+#include <rtadp/WorkerManager.h>
+#include <algorithm>
+
+AutoscaleConfig AutoscaleConfig::from_json(const nlohmann::json& configuration, int max_workers) {
+    AutoscaleConfig config;
+    config.min_workers = std::max(1, configuration.value("min_workers", config.min_workers));
+    config.max_workers = std::min(max_workers, configuration.value("max_workers", config.max_workers));
+    config.max_workers = std::max(config.min_workers, config.max_workers);
+    config.interval = std::chrono::milliseconds(std::max(100, configuration.value("interval_ms", 1000)));
+    config.queue_per_worker = configuration.value("queue_per_worker", config.queue_per_worker);
+    config.max_age_ms = configuration.value("max_age_ms", config.max_age_ms);
+    config.up_utilization = configuration.value("up_utilization", config.up_utilization);
+    config.down_utilization = std::min(config.up_utilization, configuration.value("down_utilization", config.down_utilization));
+    config.up_periods = std::max(1, configuration.value("up_periods", config.up_periods));
+    config.down_periods = std::max(1, configuration.value("down_periods", config.down_periods));
+    config.step = std::max(1, configuration.value("step", config.step));
+    return config;
+}
+
+Autoscaler::Autoscaler(WorkerManager* manager, const AutoscaleConfig& config)
+    : manager(manager), autoscale_config(config), globalname("Autoscaler-" + manager->getFullname()) {
+}
+
+Autoscaler::~Autoscaler() {
+    stop();
+}
+
+void Autoscaler::start() {
+    manager->logger->info(fmt::format("Autoscaling between {} and {} workers every {} ms", autoscale_config.min_workers,
+        autoscale_config.max_workers, autoscale_config.interval.count()), globalname);
+    thread = std::thread(&Autoscaler::run, this);
+}
+
+void Autoscaler::stop() {
+    {
+        std::lock_guard<std::mutex> lock(mtx);
+        stop_event = true;
+    }
+    cv.notify_all();
+    if (thread.joinable()) {
+        thread.join();
+    }
+}
+
+void Autoscaler::run() {
+    last_busy_ns = manager->getWorkersBusyTime();
+    auto last_time = std::chrono::steady_clock::now();
+
+    std::unique_lock<std::mutex> lock(mtx);
+    while (!stop_event) {
+        cv.wait_for(lock, autoscale_config.interval, [this] { return stop_event.load(); });
+        if (stop_event) {
+            break;
+        }
+
+        auto now = std::chrono::steady_clock::now();
+        lock.unlock();
+        evaluate(now - last_time);
+        lock.lock();
+        last_time = now;
+    }
+}
+
+void Autoscaler::evaluate(std::chrono::nanoseconds elapsed) {
+    int workers = manager->getNumWorkers();
+
+    // Busy fraction of the workers over the period
+    uint64_t busy_ns = manager->getWorkersBusyTime();
+    double period_ns = static_cast<double>(elapsed.count()) * std::max(1, workers);
+    utilization = period_ns > 0 ? static_cast<double>(busy_ns - last_busy_ns) / period_ns : 0.0;
+    last_busy_ns = busy_ns;
+
+    // Mean age of the data taken from the queues during the period
+    uint64_t age_count = manager->getAgeHistogram(0).get_count() + manager->getAgeHistogram(1).get_count();
+    uint64_t age_total_us = manager->getAgeHistogram(0).get_total_us() + manager->getAgeHistogram(1).get_total_us();
+    if (age_count > last_age_count) {
+        mean_age_ms = static_cast<double>(age_total_us - last_age_total_us) / (age_count - last_age_count) / 1000.0;
+    }
+    last_age_count = age_count;
+    last_age_total_us = age_total_us;
+
+    size_t depth = manager->getLowPriorityQueue()->size() + manager->getHighPriorityQueue()->size();
+
+    // Pressure: a backlog that is not shrinking, a rising queue age above the limit, saturated workers
+    bool backlog = depth > autoscale_config.queue_per_worker * workers && depth >= last_depth;
+    bool aging = autoscale_config.max_age_ms > 0 && mean_age_ms > autoscale_config.max_age_ms && mean_age_ms >= last_mean_age_ms;
+    bool saturated = utilization > autoscale_config.up_utilization && depth > 0;
+    // Idle: low utilization with less than one queued message per worker
+    bool idle = utilization < autoscale_config.down_utilization && depth < static_cast<size_t>(workers);
+
+    last_depth = depth;
+    last_mean_age_ms = mean_age_ms;
+
+    up_count = (backlog || aging || saturated) ? up_count + 1 : 0;
+    down_count = idle ? down_count + 1 : 0;
+
+    if (!enabled) {
+        up_count = 0;
+        down_count = 0;
+        return;
+    }
+
+    int target = workers;
+    if (up_count >= autoscale_config.up_periods && workers < autoscale_config.max_workers) {
+        target = std::min(autoscale_config.max_workers, workers + autoscale_config.step);
+    }
+    else if (down_count >= autoscale_config.down_periods && workers > autoscale_config.min_workers) {
+        target = workers - 1;
+    }
+    if (target == workers) {
+        return;
+    }
+
+    manager->logger->info(fmt::format("Scaling from {} to {} workers: queue {} utilization {:.2f} mean age {:.1f} ms",
+        workers, target, depth, utilization.load(), mean_age_ms.load()), globalname);
+    manager->scale_workers(target);
+
+    // The new configuration is measured from scratch
+    up_count = 0;
+    down_count = 0;
+    last_busy_ns = manager->getWorkersBusyTime();
+}
+
+void Autoscaler::set_enabled(bool value) {
+    enabled = value;
+}
+
+bool Autoscaler::is_enabled() const {
+    return enabled;
+}
+
+const AutoscaleConfig& Autoscaler::getConfig() const {
+    return autoscale_config;
+}
+
+double Autoscaler::getUtilization() const {
+    return utilization;
+}
+
+double Autoscaler::getMeanAgeMs() const {
+    return mean_age_ms;
+}
@@ -0,0 +1,267 @@
+// Copyright (C) 2024 INAF
+// This software is distributed under the terms of the BSD-3-Clause license
+//
+// Authors:
+//
+//    Andrea Bulgarelli <andrea.bulgarelli@inaf.it>
+//
+
+#include <rtadp/BufferPool.h>
+#include <algorithm>
+#include <new>
+#include <unordered_map>
+#include <sys/mman.h>
+
+namespace {
+constexpr size_t HUGE_PAGE_SIZE = 2 << 20;
+
+std::atomic<uint64_t> next_pool_id{1};
+
+// Pools alive, for the thread caches flushed at thread exit
+std::mutex& registry_mutex() {
+    static std::mutex instance;
+    return instance;
+}
+
+std::unordered_map<uint64_t, BufferPool*>& live_pools() {
+    static std::unordered_map<uint64_t, BufferPool*> instance;
+    return instance;
+}
+
+size_t round_up_power_of_two(size_t value) {
+    size_t result = 1;
+    while (result < value) {
+        result <<= 1;
+    }
+    return result;
+}
+}
+
+// Free blocks of the calling thread, per pool and size class.
+// A pool is identified by its id (never reused), so a cache of a destroyed pool is never used again.
+struct BufferPoolThreadCache {
+    struct Entry {
+        uint64_t pool_id;
+        std::vector<std::vector<void*>> lists;
+    };
+
+    std::vector<Entry> entries;
+    size_t last = 0;
+
+    std::vector<std::vector<void*>>& lists(BufferPool* pool) {
+        if (last < entries.size() && entries[last].pool_id == pool->id) {
+            return entries[last].lists;
+        }
+        for (last = 0; last < entries.size(); last++) {
+            if (entries[last].pool_id == pool->id) {
+                return entries[last].lists;
+            }
+        }
+
+        Entry entry;
+        entry.pool_id = pool->id;
+        entry.lists.resize(pool->classes.size());
+        for (size_t index = 0; index < pool->classes.size(); index++) {
+            entry.lists[index].reserve(pool->classes[index]->cache_limit + 1);
+        }
+        entries.push_back(std::move(entry));
+        last = entries.size() - 1;
+        return entries[last].lists;
+    }
+
+    // Give the blocks back to the pools still alive
+    ~BufferPoolThreadCache() {
+        std::lock_guard<std::mutex> lock(registry_mutex());
+        for (auto& entry : entries) {
+            auto it = live_pools().find(entry.pool_id);
+            if (it == live_pools().end()) {
+                continue;
+            }
+            for (size_t index = 0; index < entry.lists.size(); index++) {
+                it->second->release(index, entry.lists[index], entry.lists[index].size());
+            }
+        }
+        destroyed = true;
+    }
+
+    // Blocks released by the destructors of other thread_local objects go directly to the shared lists
+    static thread_local bool destroyed;
+};
+
+thread_local bool BufferPoolThreadCache::destroyed = false;
+
+namespace {
+thread_local BufferPoolThreadCache thread_cache;
+}
+
+BufferPool::BufferPool(const nlohmann::json& configuration) : id(next_pool_id++) {
+    min_block_size = round_up_power_of_two(std::max(configuration.value("min_block_bytes", static_cast<size_t>(64)), static_cast<size_t>(64)));
+    max_block_size = round_up_power_of_two(std::max(configuration.value("max_block_bytes", static_cast<size_t>(1 << 20)), min_block_size));
+    slab_size = std::max(configuration.value("slab_bytes", HUGE_PAGE_SIZE), static_cast<size_t>(4096));
+    huge_pages = configuration.value("huge_pages", false);
+    size_t thread_cache_blocks = std::max(configuration.value("thread_cache_blocks", static_cast<size_t>(64)), static_cast<size_t>(2));
+    size_t thread_cache_bytes = configuration.value("thread_cache_bytes", static_cast<size_t>(4 << 20));
+
+    min_shift = 0;
+    while ((static_cast<size_t>(1) << min_shift) < min_block_size) {
+        min_shift++;
+    }
+
+    for (size_t block_size = min_block_size; block_size <= max_block_size; block_size <<= 1) {
+        auto size_class = std::make_unique<SizeClass>();
+        size_class->block_size = block_size;
+        // The caches of the large classes hold a few blocks only
+        size_class->cache_limit = std::max(static_cast<size_t>(2), std::min(thread_cache_blocks, thread_cache_bytes / block_size));
+        classes.push_back(std::move(size_class));
+    }
+
+    std::lock_guard<std::mutex> lock(registry_mutex());
+    live_pools()[id] = this;
+}
+
+BufferPool::~BufferPool() {
+    {
+        std::lock_guard<std::mutex> lock(registry_mutex());
+        live_pools().erase(id);
+    }
+    for (auto& slab : slabs) {
+        munmap(slab.memory, slab.size);
+    }
+}
+
+size_t BufferPool::class_index(size_t size) const {
+    size_t blocks = (std::max(size, static_cast<size_t>(1)) - 1) >> min_shift;
+    return blocks == 0 ? 0 : 64 - __builtin_clzll(blocks);
+}
+
+void* BufferPool::allocate(size_t size) {
+    if (size > max_block_size) {
+        oversize++;
+        return ::operator new(size);
+    }
+    allocations.fetch_add(1, std::memory_order_relaxed);
+
+    size_t index = class_index(size);
+    if (BufferPoolThreadCache::destroyed) {
+        std::vector<void*> blocks;
+        refill(index, blocks, 1);
+        return blocks.back();
+    }
+
+    auto& blocks = thread_cache.lists(this)[index];
+    if (blocks.empty()) {
+        refill(index, blocks, std::max(static_cast<size_t>(1), classes[index]->cache_limit / 2));
+    }
+    void* block = blocks.back();
+    blocks.pop_back();
+    return block;
+}
+
+void BufferPool::deallocate(void* block, size_t size) noexcept {
+    if (!block) {
+        return;
+    }
+    if (size > max_block_size) {
+        ::operator delete(block);
+        return;
+    }
+
+    size_t index = class_index(size);
+    if (BufferPoolThreadCache::destroyed) {
+        release(index, block);
+        return;
+    }
+
+    auto& blocks = thread_cache.lists(this)[index];
+    blocks.push_back(block);
+    if (blocks.size() > classes[index]->cache_limit) {
+        release(index, blocks, blocks.size() / 2);
+    }
+}
+
+void BufferPool::refill(size_t index, std::vector<void*>& blocks, size_t count) {
+    SizeClass& size_class = *classes[index];
+    std::lock_guard<std::mutex> lock(size_class.mtx);
+
+    size_t recycled = std::min(count, size_class.free_blocks.size());
+    blocks.insert(blocks.end(), size_class.free_blocks.end() - recycled, size_class.free_blocks.end());
+    size_class.free_blocks.resize(size_class.free_blocks.size() - recycled);
+    if (recycled > 0) {
+        return;
+    }
+
+    // No block to recycle: carve new ones
+    for (size_t i = 0; i < count; i++) {
+        if (size_class.slab_next == size_class.slab_end) {
+            size_t size = std::max(slab_size, size_class.block_size);
+            size = (size + size_class.block_size - 1) / size_class.block_size * size_class.block_size;
+            size_class.slab_next = static_cast<uint8_t*>(map_slab(size));
+            size_class.slab_end = size_class.slab_next + size;
+        }
+        blocks.push_back(size_class.slab_next);
+        size_class.slab_next += size_class.block_size;
+        misses.fetch_add(1, std::memory_order_relaxed);
+    }
+}
+
+void BufferPool::release(size_t index, std::vector<void*>& blocks, size_t count) noexcept {
+    SizeClass& size_class = *classes[index];
+    std::lock_guard<std::mutex> lock(size_class.mtx);
+    size_class.free_blocks.insert(size_class.free_blocks.end(), blocks.end() - count, blocks.end());
+    blocks.resize(blocks.size() - count);
+}
+
+void BufferPool::release(size_t index, void* block) noexcept {
+    SizeClass& size_class = *classes[index];
+    std::lock_guard<std::mutex> lock(size_class.mtx);
+    size_class.free_blocks.push_back(block);
+}
+
+void* BufferPool::map_slab(size_t size) {
+    void* memory = MAP_FAILED;
+    if (huge_pages) {
+        size = (size + HUGE_PAGE_SIZE - 1) / HUGE_PAGE_SIZE * HUGE_PAGE_SIZE;
+        memory = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+        if (memory != MAP_FAILED) {
+            huge_pages_mapped = true;
+        }
+    }
+    if (memory == MAP_FAILED) {
+        memory = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        if (memory == MAP_FAILED) {
+            throw std::bad_alloc();
+        }
+        if (huge_pages) {
+            madvise(memory, size, MADV_HUGEPAGE);   // No huge page reserved: transparent huge pages
+        }
+    }
+
+    std::lock_guard<std::mutex> lock(slabs_mutex);
+    slabs.push_back({memory, size});
+    reserved_bytes += size;
+    return memory;
+}
+
+double BufferPool::getHitRate() const {
+    uint64_t total = allocations + oversize;
+    if (total == 0) {
+        return 0.0;
+    }
+    uint64_t missed = std::min<uint64_t>(misses + oversize, total);
+    return static_cast<double>(total - missed) / total;
+}
+
+uint64_t BufferPool::getHitCount() const {
+    uint64_t carved = misses;
+    uint64_t count = allocations;
+    return count > carved ? count - carved : 0;
+}
+
+size_t BufferPool::getFreeBytes() {
+    size_t bytes = 0;
+    for (auto& size_class : classes) {
+        std::lock_guard<std::mutex> lock(size_class->mtx);
+        bytes += size_class->free_blocks.size() * size_class->block_size;
+    }
+    return bytes;
+}
@@ -0,0 +1,216 @@
+// Copyright (C) 2024 INAF
+// This software is distributed under the terms of the BSD-3-Clause license
+//
+// Authors:
+//
+//    Andrea Bulgarelli <andrea.bulgarelli@inaf.it>
+//
+
+#include <rtadp/DynamicBatcher.h>
+#include <rtadp/WorkerManager.h>
+#include <algorithm>
+#include <limits>
+
+DynamicBatcher::DynamicBatcher(WorkerManager* manager, std::shared_ptr<InferenceBackend> backend, const nlohmann::json& configuration)
+    : manager(manager), backend(std::move(backend)), globalname("DynamicBatcher-" + manager->getFullname()) {
+
+    max_batch_size = std::max(static_cast<size_t>(1), configuration.value("max_batch_size", static_cast<size_t>(64)));
+    if (this->backend->max_batch_size() > 0) {
+        max_batch_size = std::min(max_batch_size, this->backend->max_batch_size());
+    }
+    max_delay = std::chrono::microseconds(configuration.value("max_delay_us", 1000));
+    hp_max_delay = std::chrono::microseconds(configuration.value("hp_max_delay_us", 0));
+
+    std::vector<size_t> limits = configuration.value("size_classes", std::vector<size_t>());
+    std::sort(limits.begin(), limits.end());
+    limits.push_back(std::numeric_limits<size_t>::max());
+    for (size_t limit : limits) {
+        SizeClass size_class;
+        size_class.max_bytes = limit;
+        size_classes.push_back(std::move(size_class));
+    }
+}
+
+DynamicBatcher::~DynamicBatcher() {
+    stop();
+}
+
+void DynamicBatcher::start(int num_threads) {
+    for (int i = 0; i < std::max(1, num_threads); i++) {
+        threads.emplace_back(&DynamicBatcher::run, this);
+    }
+    manager->logger->info(fmt::format("Batcher started: backend {}, max batch {}, max delay {} us, {} size classes, {} threads",
+        backend->getName(), max_batch_size, max_delay.count(), size_classes.size(), threads.size()), globalname);
+}
+
+void DynamicBatcher::stop() {
+    std::vector<Request> pending;
+    {
+        std::lock_guard<std::mutex> lock(mtx);
+        if (stopped) {
+            return;
+        }
+        stopped = true;
+        for (auto& size_class : size_classes) {
+            for (auto& request : size_class.requests) {
+                pending.push_back(std::move(request));
+            }
+            size_class.requests.clear();
+        }
+    }
+    cv.notify_all();
+
+    for (auto& thread : threads) {
+        if (thread.joinable()) {
+            thread.join();
+        }
+    }
+
+    // The submitters may be waiting for these outputs
+    for (auto& request : pending) {
+        request.completion({});
+    }
+    queued = 0;
+}
+
+void DynamicBatcher::submit(const DataMessage& data, int priority, Completion completion) {
+    auto now = std::chrono::steady_clock::now();
+    Request request{data, now + (priority == 1 ? hp_max_delay : max_delay), std::move(completion)};
+
+    {
+        std::lock_guard<std::mutex> lock(mtx);
+        if (!stopped) {
+            auto it = std::find_if(size_classes.begin(), size_classes.end(),
+                                   [&](const SizeClass& size_class) { return data.size() <= size_class.max_bytes; });
+            if (it->requests.empty() || request.deadline < it->earliest_deadline) {
+                it->earliest_deadline = request.deadline;
+            }
+            it->requests.push_back(std::move(request));
+            queued++;
+            cv.notify_one();
+            return;
+        }
+    }
+
+    // Stopped
+    request.completion({});
+}
+
+std::future<std::vector<uint8_t>> DynamicBatcher::submit(const DataMessage& data, int priority) {
+    auto promise = std::make_shared<std::promise<std::vector<uint8_t>>>();
+    auto future = promise->get_future();
+    submit(data, priority, [promise](std::vector<uint8_t>&& output) { promise->set_value(std::move(output)); });
+    return future;
+}
+
+void DynamicBatcher::submit_result(const DataMessage& data, int priority) {
+    uint64_t sequence = data.sequence();
+    auto ingest_time = data.ingest_time();
+    WorkerManager* target = manager;
+
+    submit(data, priority, [target, sequence, ingest_time, priority](std::vector<uint8_t>&& output) {
+        if (output.empty()) {
+            target->skip_result(sequence, priority);
+            return;
+        }
+        DataMessage result = DataMessage::from_vector(std::move(output), target->getSupervisor()->getBufferPool());
+        result.set_sequence(sequence);
+        result.set_ingest_time(ingest_time);
+        target->push_result(std::move(result), priority);
+    });
+}
+
+DynamicBatcher::SizeClass* DynamicBatcher::ready_class(std::chrono::steady_clock::time_point now,
+                                                       std::chrono::steady_clock::time_point& next_deadline) {
+    SizeClass* ready = nullptr;
+    next_deadline = std::chrono::steady_clock::time_point::max();
+
+    for (auto& size_class : size_classes) {
+        if (size_class.requests.empty()) {
+            continue;
+        }
+        bool due = size_class.requests.size() >= max_batch_size || size_class.earliest_deadline <= now;
+        if (due) {
+            if (!ready || size_class.earliest_deadline < ready->earliest_deadline) {
+                ready = &size_class;
+            }
+        }
+        else {
+            next_deadline = std::min(next_deadline, size_class.earliest_deadline);
+        }
+    }
+    return ready;
+}
+
+void DynamicBatcher::run() {
+    std::vector<Request> batch;
+    batch.reserve(max_batch_size);
+
+    std::unique_lock<std::mutex> lock(mtx);
+    while (!stopped) {
+        std::chrono::steady_clock::time_point next_deadline;
+        SizeClass* size_class = ready_class(std::chrono::steady_clock::now(), next_deadline);
+
+        if (!size_class) {
+            if (next_deadline == std::chrono::steady_clock::time_point::max()) {
+                cv.wait(lock);
+            }
+            else {
+                cv.wait_until(lock, next_deadline);
+            }
+            continue;
+        }
+
+        // Take the oldest events of the class, the deadline of the class is the earliest of the remaining ones
+        size_t count = std::min(max_batch_size, size_class->requests.size());
+        for (size_t i = 0; i < count; i++) {
+            batch.push_back(std::move(size_class->requests.front()));
+            size_class->requests.pop_front();
+        }
+        size_class->earliest_deadline = std::chrono::steady_clock::time_point::max();
+        for (const auto& request : size_class->requests) {
+            size_class->earliest_deadline = std::min(size_class->earliest_deadline, request.deadline);
+        }
+        queued -= count;
+
+        lock.unlock();
+        run_batch(batch);
+        batch.clear();
+        lock.lock();
+    }
+}
+
+void DynamicBatcher::run_batch(std::vector<Request>& batch) {
+    std::vector<DataMessage> inputs;
+    inputs.reserve(batch.size());
+    for (const auto& request : batch) {
+        inputs.push_back(request.data);
+    }
+
+    std::vector<std::vector<uint8_t>> outputs;
+    try {
+        backend->infer(inputs, outputs);
+    }
+    catch (const std::exception& e) {
+        failed_batches++;
+        outputs.clear();
+        manager->logger->error(fmt::format("Inference of a batch of {} events failed: {}", batch.size(), e.what()), globalname);
+    }
+
+    batches++;
+    events += batch.size();
+
+    // Scatter the outputs back to the submitters
+    for (size_t i = 0; i < batch.size(); i++) {
+        batch[i].completion(i < outputs.size() ? std::move(outputs[i]) : std::vector<uint8_t>());
+    }
+}
+
+std::string DynamicBatcher::getBackendName() const {
+    return backend->getName();
+}
+
+double DynamicBatcher::getMeanBatchSize() const {
+    uint64_t count = batches;
+    return count > 0 ? static_cast<double>(events) / count : 0.0;
+}
@@ -0,0 +1,62 @@
+// Copyright (C) 2024 INAF
+// This software is distributed under the terms of the BSD-3-Clause license
+//
+// Authors:
+//
+//    Andrea Bulgarelli <andrea.bulgarelli@inaf.it>
+//
+
+#include <rtadp/InferenceBackend.h>
+#include <rtadp/CpuRelax.h>
+
+// Function-local statics, so that registrations from static initializers of other translation units are safe
+std::map<std::string, InferenceBackend::Factory>& InferenceBackend::factories() {
+    static std::map<std::string, Factory> instance;
+    return instance;
+}
+
+std::mutex& InferenceBackend::registry_mutex() {
+    static std::mutex instance;
+    return instance;
+}
+
+bool InferenceBackend::register_backend(const std::string& name, Factory factory) {
+    std::lock_guard<std::mutex> lock(registry_mutex());
+    factories()[name] = std::move(factory);
+    return true;
+}
+
+std::shared_ptr<InferenceBackend> InferenceBackend::create(const std::string& name, const nlohmann::json& configuration) {
+    Factory factory;
+    {
+        std::lock_guard<std::mutex> lock(registry_mutex());
+        auto it = factories().find(name);
+        if (it == factories().end()) {
+            return nullptr;
+        }
+        factory = it->second;
+    }
+    return factory(configuration);
+}
+
+static const bool cpu_mock_registered = InferenceBackend::register_backend("cpu_mock",
+    [](const nlohmann::json& configuration) { return std::make_shared<CpuMockBackend>(configuration); });
+
+CpuMockBackend::CpuMockBackend(const nlohmann::json& configuration)
+    : setup_time(configuration.value("mock_setup_us", 200)),
+      item_time(configuration.value("mock_item_us", 5)),
+      max_batch(configuration.value("mock_max_batch", static_cast<size_t>(0))) {
+}
+
+void CpuMockBackend::infer(const std::vector<DataMessage>& inputs, std::vector<std::vector<uint8_t>>& outputs) {
+    // Busy CPU time, as a model would use
+    auto deadline = std::chrono::steady_clock::now() + setup_time + item_time * static_cast<int>(inputs.size());
+    while (std::chrono::steady_clock::now() < deadline) {
+        cpu_relax();
+    }
+
+    outputs.resize(inputs.size());
+    for (size_t i = 0; i < inputs.size(); i++) {
+        outputs[i] = inputs[i].to_vector();
+    }
+}
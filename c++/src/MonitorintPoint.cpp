@@ -47,6 +47,59 @@ nlohmann::json MonitoringPoint::get_data() {
     update("queue_lp_result_size", manager->getResultLpQueue()->size());
     update("queue_hp_result_size", manager->getResultHpQueue()->size());
 
+    // Update overflow counters of the bounded queues
+    for (const auto& [queue_name, queue] : manager->getBoundedQueues()) {
+        data["queue_overflow"][queue_name]["bytes"] = queue->get_bytes();
+        data["queue_overflow"][queue_name]["dropped"] = queue->get_dropped_count();
+        data["queue_overflow"][queue_name]["rejected"] = queue->get_rejected_count();
+        data["queue_overflow"][queue_name]["blocked"] = queue->get_blocked_count();
+    }
+
+    // Update spill to disk of the lp queue
+    if (auto spill = manager->getSpillQueue()) {
+        data["spill_lp"]["messages"] = spill->get_spilled_messages();
+        data["spill_lp"]["bytes"] = spill->get_spilled_bytes();
+        data["spill_lp"]["segments"] = spill->get_segment_count();
+        data["spill_lp"]["total"] = spill->get_spilled_total();
+        data["spill_lp"]["errors"] = spill->get_spill_errors();
+    }
+
+    // Update age of the data taken by the workers and lp data expired
+    data["age_lp"] = manager->getAgeHistogram(0).to_json();
+    data["age_hp"] = manager->getAgeHistogram(1).to_json();
+    update("expired_lp", manager->getExpiredLpCount());
+
+    // Update result channel throughput
+    update("result_lp_rate", manager->getResultRate(0));
+    update("result_hp_rate", manager->getResultRate(1));
+    update("result_lp_rate_mbs", manager->getResultRateMbs(0));
+    update("result_hp_rate_mbs", manager->getResultRateMbs(1));
+    update("result_lp_sent", manager->getResultSentCount(0));
+    update("result_hp_sent", manager->getResultSentCount(1));
+
+    // Update reorder buffers state
+    if (manager->isOrderedResults()) {
+        update("reorder_lp_pending", manager->getReorderBuffer(0)->size());
+        update("reorder_hp_pending", manager->getReorderBuffer(1)->size());
+        update("reorder_lost", manager->getReorderBuffer(0)->get_lost_count() + manager->getReorderBuffer(1)->get_lost_count());
+        update("reorder_late", manager->getReorderBuffer(0)->get_late_count() + manager->getReorderBuffer(1)->get_late_count());
+    }
+
+    // Update ingest rates measured by the Supervisor
+    update("ingest_lp_rate", supervisor->get_ingest_lp_rate());
+    update("ingest_hp_rate", supervisor->get_ingest_hp_rate());
+    update("result_send_time_us", supervisor->get_result_send_time_us());
+    update("result_send_rate_mbs", supervisor->get_result_send_rate_mbs());
+
+    if (const auto& pool = supervisor->getBufferPool()) {
+        update("buffer_pool_hit_rate", pool->getHitRate());
+        update("buffer_pool_misses", pool->getMissCount());
+        update("buffer_pool_oversize", pool->getOversizeCount());
+        update("buffer_pool_reserved_bytes", pool->getReservedBytes());
+        update("buffer_pool_free_bytes", pool->getFreeBytes());
+        update("buffer_pool_huge_pages", pool->isHugePages());
+    }
+
     // Update worker status
     update("workersstatusinit", manager->getWorkersStatusInit());
     update("workersstatus", manager->getWorkersStatus());
@@ -60,6 +113,45 @@ nlohmann::json MonitoringPoint::get_data() {
             worker_status[worker->getWorkerId()] = worker->get_status();
         }
     }
+    else if (manager->getProcessingType() == "process") {
+        uint64_t restarts = 0;
+        for (const auto& worker : manager->getWorkerProcesses()) {
+            processing_rates[worker->getWorkerId()] = worker->getProcessingRate();
+            processing_tot_events[worker->getWorkerId()] = worker->getTotalProcessedDataCount();
+            worker_status[worker->getWorkerId()] = worker->get_status();
+            restarts += worker->getRestartCount();
+        }
+        update("worker_restarts", restarts);
+    }
+
+    if (manager->getProcessingType() == "thread" || manager->getProcessingType() == "process") {
+        update("scratch_high_water", manager->getScratchHighWater());
+    }
+
+    if (auto* autoscaler = manager->getAutoscaler()) {
+        update("num_workers", manager->getNumWorkers());
+        update("autoscale_enabled", autoscaler->is_enabled());
+        update("autoscale_utilization", autoscaler->getUtilization());
+        update("autoscale_mean_age_ms", autoscaler->getMeanAgeMs());
+    }
+
+    if (auto* pool = manager->getWorkerPool()) {
+        update("pool_threads", pool->getNumThreads());
+        update("pool_busy_threads", pool->getBusyThreads());
+        update("pool_weight", pool->getWeight(manager));
+        update("pool_processed", pool->getProcessedCount(manager));
+        update("pool_stolen", pool->getStolenCount());
+        update("pool_scratch_high_water", pool->getScratchHighWater());
+    }
+
+    if (auto* batcher = manager->getBatcher()) {
+        update("batcher_backend", batcher->getBackendName());
+        update("batcher_batches", batcher->getBatchCount());
+        update("batcher_events", batcher->getEventCount());
+        update("batcher_failed_batches", batcher->getFailedBatchCount());
+        update("batcher_queued", batcher->getQueuedCount());
+        update("batcher_mean_batch_size", batcher->getMeanBatchSize());
+    }
 
     // Update data with worker processing information
     data["worker_rates"] = processing_rates;
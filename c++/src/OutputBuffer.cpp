@@ -0,0 +1,121 @@
+// Copyright (C) 2024 INAF
+// This software is distributed under the terms of the BSD-3-Clause license
+//
+// Authors:
+//
+//    Andrea Bulgarelli <andrea.bulgarelli@inaf.it>
+//
+
+#include <rtadp/OutputBuffer.h>
+#include <algorithm>
+#include <cstring>
+
+namespace {
+constexpr size_t MIN_BLOCK_SIZE = 256;
+}
+
+OutputBuffer::OutputBuffer(std::shared_ptr<BufferPool> pool) : pool(std::move(pool)) {
+}
+
+OutputBuffer::~OutputBuffer() {
+    release_block();
+}
+
+void OutputBuffer::release_block() {
+    if (!block) {
+        return;
+    }
+    if (pool) {
+        pool->deallocate(block, capacity);
+    }
+    else {
+        ::operator delete(block);
+    }
+    block = nullptr;
+    used = 0;
+    capacity = 0;
+}
+
+uint8_t* OutputBuffer::reserve(size_t bytes) {
+    if (used + bytes > capacity) {
+        // Grow as a vector, the bytes written so far are moved to the new block
+        size_t new_capacity = std::max({capacity * 2, used + bytes, MIN_BLOCK_SIZE});
+        auto* new_block = static_cast<uint8_t*>(DataMessage::allocate_block(new_capacity, pool));
+        if (used > 0) {
+            std::memcpy(new_block, block, used);
+        }
+        size_t written = used;
+        release_block();
+        block = new_block;
+        used = written;
+        capacity = new_capacity;
+    }
+    return block + used;
+}
+
+void OutputBuffer::commit(size_t bytes) {
+    used = std::min(used + bytes, capacity);
+}
+
+void OutputBuffer::append(const void* data, size_t size) {
+    if (size == 0) {
+        return;
+    }
+    std::memcpy(reserve(size), data, size);
+    used += size;
+}
+
+void OutputBuffer::append_part(std::vector<uint8_t>&& data) {
+    close_part();
+    if (!data.empty()) {
+        parts.push_back(DataMessage::from_vector(std::move(data), pool));
+    }
+}
+
+void OutputBuffer::append_part(const DataMessage& data) {
+    close_part();
+    for (const DataMessage* part = &data; part; part = part->next_part()) {
+        if (!part->empty()) {
+            parts.push_back(part->part_only());
+        }
+    }
+}
+
+void OutputBuffer::next_part() {
+    close_part();
+}
+
+// The block of a non-empty part becomes the storage of the part; an empty block is kept for the next part
+void OutputBuffer::close_part() {
+    if (used == 0) {
+        return;
+    }
+    parts.push_back(DataMessage::adopt_block(block, used, capacity, pool));
+    block = nullptr;
+    used = 0;
+    capacity = 0;
+}
+
+size_t OutputBuffer::size() const {
+    size_t total = used;
+    for (const auto& part : parts) {
+        total += part.size();
+    }
+    return total;
+}
+
+size_t OutputBuffer::part_count() const {
+    return parts.size() + (used > 0 ? 1 : 0);
+}
+
+DataMessage OutputBuffer::take() {
+    close_part();
+    DataMessage result = DataMessage::from_parts(std::move(parts), pool);
+    parts.clear();
+    return result;
+}
+
+void OutputBuffer::clear() {
+    parts.clear();
+    used = 0;   // The block is kept for the next result
+}
@@ -0,0 +1,140 @@
+// Copyright (C) 2024 INAF
+// This software is distributed under the terms of the BSD-3-Clause license
+//
+// Authors:
+//
+//    Andrea Bulgarelli <andrea.bulgarelli@inaf.it>
+//
+
+#include <rtadp/ReorderBuffer.h>
+
+ReorderBuffer::ReorderBuffer(std::shared_ptr<MessageQueue<DataMessage>> output, size_t max_window, std::chrono::milliseconds timeout)
+    : output(std::move(output)), max_window(max_window), timeout(timeout), waiting_since(std::chrono::steady_clock::now()) {
+}
+
+void ReorderBuffer::insert(uint64_t sequence, DataMessage&& message) {
+    std::unique_lock<std::mutex> lock(mtx);
+    complete(sequence, Entry{std::move(message), true});
+    drain(lock, true);
+}
+
+void ReorderBuffer::skip(uint64_t sequence) {
+    std::unique_lock<std::mutex> lock(mtx);
+    complete(sequence, Entry{DataMessage(), false});
+    drain(lock, true);
+}
+
+void ReorderBuffer::complete(uint64_t sequence, Entry&& entry) {
+    if (sequence < next_sequence) {
+        // The sequence was already skipped, releasing it now would break the order
+        if (entry.has_result) {
+            late_count++;
+        }
+        return;
+    }
+
+    if (pending.empty()) {
+        waiting_since = std::chrono::steady_clock::now();
+    }
+    pending.emplace(sequence, std::move(entry));
+    release();
+
+    // Bound the memory: give up on the missing sequences when the window is full
+    while (pending.size() > max_window) {
+        skip_to_first_pending();
+    }
+}
+
+void ReorderBuffer::release() {
+    auto it = pending.begin();
+    bool advanced = false;
+
+    while (it != pending.end() && it->first == next_sequence) {
+        if (it->second.has_result) {
+            ready.push_back(std::move(it->second.message));
+        }
+        it = pending.erase(it);
+        next_sequence++;
+        advanced = true;
+    }
+
+    if (advanced) {
+        waiting_since = std::chrono::steady_clock::now();
+    }
+}
+
+void ReorderBuffer::drain(std::unique_lock<std::mutex>& lock, bool blocking) {
+    if (draining) {
+        // The draining thread pushes the new ready results too
+        return;
+    }
+    draining = true;
+
+    while (!ready.empty()) {
+        DataMessage message = std::move(ready.front());
+        ready.pop_front();
+
+        lock.unlock();
+        bool pushed = true;
+        if (blocking) {
+            output->push(std::move(message));
+        }
+        else {
+            pushed = output->try_push(message);
+        }
+        lock.lock();
+
+        if (!pushed) {
+            // Pushed by the next drain
+            ready.push_front(std::move(message));
+            break;
+        }
+    }
+
+    draining = false;
+}
+
+void ReorderBuffer::skip_to_first_pending() {
+    if (pending.empty()) {
+        return;
+    }
+
+    uint64_t first = pending.begin()->first;
+    lost_count += first - next_sequence;
+    next_sequence = first;
+    release();
+}
+
+void ReorderBuffer::flush_expired() {
+    std::unique_lock<std::mutex> lock(mtx);
+
+    if (!pending.empty() && std::chrono::steady_clock::now() - waiting_since >= timeout) {
+        skip_to_first_pending();
+    }
+
+    // Called by the consumer of the output queue: it must not wait for room in it
+    drain(lock, false);
+}
+
+void ReorderBuffer::reset(uint64_t sequence) {
+    std::lock_guard<std::mutex> lock(mtx);
+    pending.clear();
+    ready.clear();
+    next_sequence = sequence;
+    waiting_since = std::chrono::steady_clock::now();
+}
+
+size_t ReorderBuffer::size() const {
+    std::lock_guard<std::mutex> lock(mtx);
+    return pending.size() + ready.size();
+}
+
+uint64_t ReorderBuffer::get_lost_count() const {
+    std::lock_guard<std::mutex> lock(mtx);
+    return lost_count;
+}
+
+uint64_t ReorderBuffer::get_late_count() const {
+    std::lock_guard<std::mutex> lock(mtx);
+    return late_count;
+}
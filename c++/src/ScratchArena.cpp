@@ -0,0 +1,64 @@
+// Copyright (C) 2024 INAF
+// This software is distributed under the terms of the BSD-3-Clause license
+//
+// Authors:
+//
+//    Andrea Bulgarelli <andrea.bulgarelli@inaf.it>
+//
+
+#include <rtadp/ScratchArena.h>
+#include <algorithm>
+
+ScratchArena::ScratchArena(size_t initial_bytes)
+    : min_chunk_size(std::max(initial_bytes, static_cast<size_t>(4096))) {
+    if (initial_bytes > 0) {
+        add_chunk(initial_bytes);
+    }
+}
+
+void ScratchArena::add_chunk(size_t size) {
+    chunks.push_back({std::unique_ptr<uint8_t[]>(new uint8_t[size]), size});
+    capacity_bytes += size;
+    chunk_allocations++;
+}
+
+void* ScratchArena::allocate(size_t size, size_t alignment) {
+    while (true) {
+        if (current < chunks.size()) {
+            Chunk& chunk = chunks[current];
+            uintptr_t base = reinterpret_cast<uintptr_t>(chunk.data.get());
+            uintptr_t start = (base + offset + alignment - 1) & ~static_cast<uintptr_t>(alignment - 1);
+            size_t end = static_cast<size_t>(start - base) + size;
+            if (end <= chunk.size) {
+                used_bytes += end - offset;
+                offset = end;
+                if (used_bytes > high_water.load(std::memory_order_relaxed)) {
+                    high_water.store(used_bytes, std::memory_order_relaxed);
+                }
+                return reinterpret_cast<void*>(start);
+            }
+            if (current + 1 < chunks.size()) {
+                current++;
+                offset = 0;
+                continue;
+            }
+        }
+
+        // Room for the allocation at any alignment
+        add_chunk(std::max(min_chunk_size, size + alignment));
+        current = chunks.size() - 1;
+        offset = 0;
+    }
+}
+
+void ScratchArena::reset() {
+    if (chunks.size() > 1) {
+        size_t total = capacity_bytes;
+        chunks.clear();
+        capacity_bytes = 0;
+        add_chunk(total);
+    }
+    current = 0;
+    offset = 0;
+    used_bytes = 0;
+}
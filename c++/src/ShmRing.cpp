@@ -0,0 +1,213 @@
+// Copyright (C) 2024 INAF
+// This software is distributed under the terms of the BSD-3-Clause license
+//
+// Authors:
+//
+//    Andrea Bulgarelli <andrea.bulgarelli@inaf.it>
+//
+
+#include <rtadp/ShmRing.h>
+#include <cerrno>
+#include <cstring>
+#include <ctime>
+#include <new>
+#include <stdexcept>
+
+namespace {
+// Iterations spent polling before sleeping on the semaphore
+constexpr int SPIN_ITERATIONS = 256;
+
+timespec deadline_after(std::chrono::microseconds timeout) {
+    timespec ts;
+    clock_gettime(CLOCK_REALTIME, &ts);
+    long long nsec = ts.tv_nsec + static_cast<long long>(timeout.count() % 1000000) * 1000;
+    ts.tv_sec += static_cast<time_t>(timeout.count() / 1000000 + nsec / 1000000000);
+    ts.tv_nsec = static_cast<long>(nsec % 1000000000);
+    return ts;
+}
+}
+
+size_t ShmRing::required_size(size_t capacity) {
+    return header_size() + ((capacity + 7) & ~static_cast<size_t>(7));
+}
+
+ShmRing ShmRing::create(void* memory, size_t capacity) {
+    ShmRing ring;
+    ring.header = new (memory) Header();
+    ring.header->head = 0;
+    ring.header->tail = 0;
+    ring.header->consumer_waiting = 0;
+    ring.header->producer_waiting = 0;
+    ring.header->stopped = 0;
+    ring.header->capacity = (capacity + 7) & ~static_cast<size_t>(7);
+    if (sem_init(&ring.header->items, 1, 0) != 0 || sem_init(&ring.header->space, 1, 0) != 0) {
+        throw std::runtime_error(std::string("Cannot initialize the ring semaphores: ") + std::strerror(errno));
+    }
+    ring.buffer = static_cast<uint8_t*>(memory) + header_size();
+    return ring;
+}
+
+ShmRing ShmRing::attach(void* memory) {
+    ShmRing ring;
+    ring.header = static_cast<Header*>(memory);
+    ring.buffer = static_cast<uint8_t*>(memory) + header_size();
+    return ring;
+}
+
+size_t ShmRing::max_payload() const {
+    // A record takes at most half of the ring, so it always fits once the ring is empty, padding included
+    return header->capacity / 2 - sizeof(RecordHeader);
+}
+
+template <typename Ready>
+bool ShmRing::wait(std::atomic<int>& waiting, sem_t& semaphore, std::chrono::microseconds timeout, Ready ready) {
+    for (int i = 0; i < SPIN_ITERATIONS; i++) {
+        if (ready()) {
+            return true;
+        }
+        if (header->stopped.load(std::memory_order_relaxed) || timeout.count() <= 0) {
+            return false;
+        }
+        cpu_relax();
+    }
+
+    timespec deadline = deadline_after(timeout);
+    while (true) {
+        waiting.store(1, std::memory_order_seq_cst);
+        if (ready()) {
+            waiting.store(0, std::memory_order_relaxed);
+            return true;
+        }
+        if (header->stopped.load()) {
+            waiting.store(0, std::memory_order_relaxed);
+            return false;
+        }
+        int ret = sem_timedwait(&semaphore, &deadline);
+        waiting.store(0, std::memory_order_relaxed);
+        if (ret != 0 && errno == ETIMEDOUT) {
+            return ready();
+        }
+        // Posted, interrupted or a stale post of an earlier wait: check again
+    }
+}
+
+void ShmRing::wake(std::atomic<int>& waiting, sem_t& semaphore) {
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    if (waiting.load(std::memory_order_relaxed) && waiting.exchange(0) == 1) {
+        sem_post(&semaphore);
+    }
+}
+
+bool ShmRing::write(uint32_t type, uint32_t priority, uint64_t sequence, int64_t ingest_ns,
+                    const uint8_t* data, size_t size, std::chrono::microseconds timeout) {
+    if (size > max_payload()) {
+        return false;
+    }
+
+    const uint64_t capacity = header->capacity;
+    const size_t needed = record_size(size);
+    const uint64_t head = header->head.load(std::memory_order_relaxed);
+    const uint64_t offset = head % capacity;
+    const uint64_t contiguous = capacity - offset;
+    const uint64_t padding = contiguous < needed ? contiguous : 0;
+
+    auto has_space = [&] {
+        return capacity - (head - header->tail.load(std::memory_order_acquire)) >= padding + needed;
+    };
+    if (!wait(header->producer_waiting, header->space, timeout, has_space)) {
+        return false;
+    }
+
+    uint64_t position = head;
+    if (padding > 0) {
+        // The consumer skips a tail shorter than a record header without a marker
+        if (padding >= sizeof(RecordHeader)) {
+            RecordHeader wrap{RECORD_WRAP, 0, 0, 0, 0};
+            std::memcpy(buffer + offset, &wrap, sizeof(wrap));
+        }
+        position += padding;
+    }
+
+    uint8_t* record = buffer + position % capacity;
+    RecordHeader record_header{type, priority, size, sequence, ingest_ns};
+    std::memcpy(record, &record_header, sizeof(record_header));
+    if (size > 0) {
+        std::memcpy(record + sizeof(RecordHeader), data, size);
+    }
+
+    header->head.store(position + needed, std::memory_order_release);
+    wake(header->consumer_waiting, header->items);
+    return true;
+}
+
+bool ShmRing::peek(Record& record, std::chrono::microseconds timeout) {
+    const uint64_t capacity = header->capacity;
+    uint64_t tail = header->tail.load(std::memory_order_relaxed);
+
+    auto has_items = [&] {
+        return header->head.load(std::memory_order_acquire) != tail;
+    };
+
+    while (true) {
+        if (!wait(header->consumer_waiting, header->items, timeout, has_items)) {
+            return false;
+        }
+
+        const uint64_t offset = tail % capacity;
+        const uint64_t contiguous = capacity - offset;
+        if (contiguous < sizeof(RecordHeader)) {
+            tail += contiguous;
+            header->tail.store(tail, std::memory_order_release);
+            continue;
+        }
+
+        RecordHeader record_header;
+        std::memcpy(&record_header, buffer + offset, sizeof(record_header));
+        if (record_header.type == RECORD_WRAP) {
+            tail += contiguous;
+            header->tail.store(tail, std::memory_order_release);
+            continue;
+        }
+
+        record.type = record_header.type;
+        record.priority = record_header.priority;
+        record.size = record_header.size;
+        record.sequence = record_header.sequence;
+        record.ingest_ns = record_header.ingest_ns;
+        record.data = buffer + offset + sizeof(RecordHeader);
+        return true;
+    }
+}
+
+void ShmRing::consume(const Record& record) {
+    uint64_t tail = header->tail.load(std::memory_order_relaxed);
+    header->tail.store(tail + record_size(record.size), std::memory_order_release);
+    wake(header->producer_waiting, header->space);
+}
+
+bool ShmRing::empty() const {
+    return header->head.load(std::memory_order_acquire) == header->tail.load(std::memory_order_acquire);
+}
+
+size_t ShmRing::used_bytes() const {
+    return header->head.load(std::memory_order_acquire) - header->tail.load(std::memory_order_acquire);
+}
+
+void ShmRing::stop() {
+    header->stopped.store(1);
+    sem_post(&header->items);
+    sem_post(&header->space);
+}
+
+bool ShmRing::is_stopped() const {
+    return header->stopped.load() != 0;
+}
+
+void ShmRing::destroy() {
+    if (header) {
+        sem_destroy(&header->items);
+        sem_destroy(&header->space);
+        header = nullptr;
+        buffer = nullptr;
+    }
+}
@@ -0,0 +1,299 @@
+// Copyright (C) 2024 INAF
+// This software is distributed under the terms of the BSD-3-Clause license
+//
+// Authors:
+//
+//    Andrea Bulgarelli <andrea.bulgarelli@inaf.it>
+//
+
+#include <rtadp/SpillQueue.h>
+#include <cstring>
+#include <cerrno>
+#include <algorithm>
+#include <stdexcept>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+
+// Append-only segment file mapped in memory.
+// Records: [uint64 sequence][int64 ingest time ns][uint64 size][payload padded to 8 bytes]
+struct SpillQueue::Segment {
+    std::string path;
+    int fd = -1;
+    uint8_t* base = nullptr;
+    size_t capacity = 0;
+    size_t write_offset = 0;
+    size_t read_offset = 0;
+
+    ~Segment() {
+        if (base) {
+            munmap(base, capacity);
+        }
+        if (fd >= 0) {
+            close(fd);
+        }
+    }
+};
+
+namespace {
+constexpr size_t RECORD_HEADER = 3 * sizeof(uint64_t);
+
+size_t record_size(size_t payload) {
+    return RECORD_HEADER + ((payload + 7) & ~static_cast<size_t>(7));
+}
+}
+
+SpillQueue::SpillQueue(std::shared_ptr<MessageQueue<DataMessage>> queue, const SpillConfig& config, const std::string& name,
+                       RefillCallback on_refill)
+    : queue(std::move(queue)), spill_config(config), on_refill(std::move(on_refill)) {
+    if (spill_config.low_water > spill_config.high_water) {
+        spill_config.low_water = spill_config.high_water;
+    }
+    file_prefix = spill_config.directory + "/rtadp-spill-" + name + "-" + std::to_string(getpid()) + "-";
+}
+
+SpillQueue::~SpillQueue() {
+    std::lock_guard<std::mutex> lock(mtx);
+    for (auto& segment : segments) {
+        unlink(segment->path.c_str());
+    }
+    segments.clear();
+}
+
+std::shared_ptr<SpillQueue::Segment> SpillQueue::open_segment(size_t min_bytes) {
+    auto segment = std::make_shared<Segment>();
+    segment->path = file_prefix + std::to_string(segment_counter++) + ".seg";
+    segment->capacity = std::max(spill_config.segment_bytes, min_bytes);
+
+    segment->fd = open(segment->path.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0600);
+    if (segment->fd < 0) {
+        throw std::runtime_error("Cannot create spill segment " + segment->path + ": " + std::strerror(errno));
+    }
+
+    // Reserve the blocks now: writing to a sparse mapping on a full disk would raise SIGBUS
+    int err = posix_fallocate(segment->fd, 0, segment->capacity);
+    if (err != 0) {
+        unlink(segment->path.c_str());
+        throw std::runtime_error("Cannot allocate spill segment " + segment->path + ": " + std::strerror(err));
+    }
+
+    void* base = mmap(nullptr, segment->capacity, PROT_READ | PROT_WRITE, MAP_SHARED, segment->fd, 0);
+    if (base == MAP_FAILED) {
+        unlink(segment->path.c_str());
+        throw std::runtime_error("Cannot map spill segment " + segment->path + ": " + std::strerror(errno));
+    }
+    segment->base = static_cast<uint8_t*>(base);
+    madvise(segment->base, segment->capacity, MADV_SEQUENTIAL);
+
+    spilled_bytes += segment->capacity;
+    return segment;
+}
+
+bool SpillQueue::append(const DataMessage& value) {
+    size_t needed = record_size(value.size());
+
+    try {
+        if (segments.empty() || segments.back()->capacity - segments.back()->write_offset < needed) {
+            segments.push_back(open_segment(needed));
+        }
+    }
+    catch (const std::runtime_error&) {
+        return false;
+    }
+
+    Segment& segment = *segments.back();
+    uint8_t* record = segment.base + segment.write_offset;
+    uint64_t header[3] = {value.sequence(),
+        static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(value.ingest_time().time_since_epoch()).count()),
+        static_cast<uint64_t>(value.size())};
+    std::memcpy(record, header, RECORD_HEADER);
+    if (!value.empty()) {
+        std::memcpy(record + RECORD_HEADER, value.data(), value.size());
+    }
+    segment.write_offset += needed;
+
+    spilled_messages++;
+    spilled_total++;
+    return true;
+}
+
+size_t SpillQueue::refill_locked() {
+    size_t moved = 0;
+
+    while (!segments.empty() && queue->size() < spill_config.high_water) {
+        auto& segment = segments.front();
+
+        if (segment->read_offset == segment->write_offset) {
+            // Fully read: the file is deleted now, the mapping lives as long as the messages referencing it
+            unlink(segment->path.c_str());
+            spilled_bytes -= segment->capacity;
+            segments.pop_front();
+            continue;
+        }
+
+        const uint8_t* record = segment->base + segment->read_offset;
+        uint64_t header[3];
+        std::memcpy(header, record, RECORD_HEADER);
+
+        DataMessage message = DataMessage::from_shared(segment, record + RECORD_HEADER, header[2]);
+        message.set_sequence(header[0]);
+        message.set_ingest_time(std::chrono::steady_clock::time_point(
+            std::chrono::duration_cast<std::chrono::steady_clock::duration>(std::chrono::nanoseconds(static_cast<int64_t>(header[1])))));
+        if (spill_config.try_push) {
+            if (!queue->try_push(std::move(message))) {
+                break;  // Full, the record is read again by the next refill
+            }
+        }
+        else {
+            queue->push(std::move(message));
+        }
+        segment->read_offset += record_size(header[2]);
+        spilled_messages--;
+        moved++;
+    }
+
+    // Drop the last segment when everything has been read, new spills start a new segment
+    if (!segments.empty() && segments.size() == 1 && segments.front()->read_offset == segments.front()->write_offset) {
+        unlink(segments.front()->path.c_str());
+        spilled_bytes -= segments.front()->capacity;
+        segments.pop_front();
+    }
+
+    return moved;
+}
+
+void SpillQueue::refill() {
+    if (spilled_messages == 0 || queue->size() > spill_config.low_water) {
+        return;
+    }
+
+    size_t moved;
+    {
+        std::lock_guard<std::mutex> lock(mtx);
+        moved = refill_locked();
+    }
+    if (moved > 0 && on_refill) {
+        on_refill(moved);
+    }
+}
+
+template <typename U>
+bool SpillQueue::spill_push(U&& value) {
+    std::lock_guard<std::mutex> lock(mtx);
+    return spill_locked(std::forward<U>(value));
+}
+
+// Moves from value only when it returns true
+template <typename U>
+bool SpillQueue::spill_locked(U&& value) {
+    if (segments.empty() && queue->size() < spill_config.high_water) {
+        if (!spill_config.try_push) {
+            queue->push(std::forward<U>(value));
+            return true;
+        }
+        if (queue->try_push(value)) {
+            return true;
+        }
+        // Full before high_water: spilled
+    }
+    if (append(value)) {
+        return true;
+    }
+
+    spill_errors++;
+    if (!spill_config.try_push) {
+        queue->push(std::forward<U>(value));
+        return true;
+    }
+    // Never wait on a block-bounded queue under the lock: the consumers refilling it need the lock
+    return queue->try_push(value);
+}
+
+// A message that can be neither spilled nor taken by the full queue is pushed without the lock
+void SpillQueue::push(const DataMessage& value) {
+    if (!spill_push(value)) {
+        queue->push(value);
+    }
+}
+
+void SpillQueue::push(DataMessage&& value) {
+    if (!spill_push(std::move(value))) {
+        queue->push(std::move(value));
+    }
+}
+
+void SpillQueue::push_batch(const std::vector<DataMessage>& values) {
+    for (const auto& value : values) {
+        push(value);
+    }
+}
+
+// Returns false if the spill failed and the queue is full
+bool SpillQueue::try_push(const DataMessage& value) {
+    return spill_push(value);
+}
+
+bool SpillQueue::try_push(DataMessage&& value) {
+    return spill_push(std::move(value));
+}
+
+// One lock for the whole batch
+size_t SpillQueue::try_push_batch(const std::vector<DataMessage>& values) {
+    std::lock_guard<std::mutex> lock(mtx);
+    size_t count = 0;
+    while (count < values.size() && spill_locked(values[count])) {
+        count++;
+    }
+    return count;
+}
+
+bool SpillQueue::try_pop(DataMessage& value) {
+    if (queue->try_pop(value)) {
+        refill();
+        return true;
+    }
+    if (spilled_messages == 0) {
+        return false;
+    }
+
+    size_t moved;
+    {
+        std::lock_guard<std::mutex> lock(mtx);
+        moved = refill_locked();
+    }
+    if (moved > 1 && on_refill) {
+        on_refill(moved - 1);   // This consumer takes one of them
+    }
+    return queue->try_pop(value);
+}
+
+DataMessage SpillQueue::get() {
+    DataMessage value;
+    if (try_pop(value)) {
+        return value;
+    }
+    value = queue->get();
+    refill();
+    return value;
+}
+
+void SpillQueue::pop() {
+    get();
+}
+
+bool SpillQueue::empty() const {
+    return queue->empty() && spilled_messages == 0;
+}
+
+size_t SpillQueue::size() const {
+    return queue->size() + spilled_messages;
+}
+
+void SpillQueue::notify_all() {
+    queue->notify_all();
+}
+
+size_t SpillQueue::get_segment_count() const {
+    std::lock_guard<std::mutex> lock(mtx);
+    return segments.size();
+}
@@ -40,9 +40,25 @@ Supervisor::Supervisor(std::string config_file, std::string name)
         dataflowtype = config["dataflow_type"].get<std::string>();
         logger->info("dataflowtype:", dataflowtype);
         datasockettype = config["datasocket_type"].get<std::string>();
+        ingestmode = config.value("ingest_mode", std::string("poller"));
+
+        // Batch-drain parameters of the binary data channels
+        ingest_lp_config.batch_size = config.value("lp_batch_size", ingest_lp_config.batch_size);
+        ingest_lp_config.drain_budget = std::chrono::microseconds(config.value("lp_drain_budget_us", ingest_lp_config.drain_budget.count()));
+        ingest_hp_config.batch_size = config.value("hp_batch_size", ingest_hp_config.batch_size);
+        ingest_hp_config.drain_budget = std::chrono::microseconds(config.value("hp_drain_budget_us", ingest_hp_config.drain_budget.count()));
+
+        if (ingest_lp_config.batch_size == 0 || ingest_hp_config.batch_size == 0) {
+            throw std::invalid_argument("Config file: lp_batch_size and hp_batch_size must be greater than 0");
+        }
+
+        // The custom data receiver is implemented by the derived class in listen_for_lp_data()
+        if (datasockettype == "custom") {
+            ingestmode = "threads";
+        }
 
         logger->info("Supervisor: " + globalname + " / " + dataflowtype + " / " 
-                       + processingtype + " / " + datasockettype, globalname);
+                       + processingtype + " / " + datasockettype + " / " + ingestmode, globalname);
 
         // Set up data sockets based on configuration
         if (datasockettype == "pushpull") {
@@ -112,8 +128,14 @@ Supervisor::~Supervisor() {
         hp_data_thread.join();
     }
 
-    if (result_thread.joinable()) {
-        result_thread.join();
+    if (ingest_thread.joinable()) {
+        ingest_thread.join();
+    }
+
+    for (auto& result_thread : result_threads) {
+        if (result_thread.joinable()) {
+            result_thread.join();
+        }
     }
 
     if (socket_command) {
@@ -229,14 +251,45 @@ void Supervisor::load_configuration(const std::string& config_file, const std::s
     manager_result_dataflow_type = std::get<1>(workers_config)[0];
     manager_result_lp_sockets = std::get<2>(workers_config);
     manager_result_hp_sockets = std::get<3>(workers_config);
-    manager_num_workers = std::get<4>(workers_config)[0]; // assuming single value
-    workername = std::get<5>(workers_config)[0]; // assuming single value
+    manager_num_workers = std::get<4>(workers_config)[0];
+    workername = std::get<5>(workers_config)[0];
     name_workers = std::get<6>(workers_config);
+
+    manager_result_sockets_types = std::get<0>(workers_config);
+    manager_result_dataflow_types = std::get<1>(workers_config);
+    managers_num_workers = std::get<4>(workers_config);
+    manager_names = std::get<5>(workers_config);
+
+    // Encoding of the binary results: raw bytes (zero-copy) or json array of integers (previous format)
+    result_encoding = config.value("result_encoding", std::string("raw"));
+    if (result_encoding != "raw" && result_encoding != "json") {
+        std::cerr << "Unknown result_encoding " << result_encoding << ", using raw" << std::endl;
+        result_encoding = "raw";
+    }
+
+    // Recycled storage of the received messages and of the results, see BufferPool for the parameters
+    json buffer_pool_config = config.value("buffer_pool", json::object());
+    if (buffer_pool_config.value("enabled", true)) {
+        buffer_pool = std::make_shared<BufferPool>(buffer_pool_config);
+    }
+
+    // Result senders: max results sent per wake-up, max consecutive hp results while lp results are waiting
+    result_batch_size = config.value("result_batch_size", static_cast<size_t>(128));
+    result_hp_burst = config.value("result_hp_burst", static_cast<size_t>(16));
+    if (result_batch_size == 0 || result_hp_burst == 0) {
+        std::cerr << "result_batch_size and result_hp_burst must be greater than 0, using 128 and 16" << std::endl;
+        result_batch_size = 128;
+        result_hp_burst = 16;
+    }
 }
 
 // Start service threads for data handling
 void Supervisor::start_service_threads() {
-    if (dataflowtype == "binary") {
+    if (ingestmode == "poller") {
+        // A single thread serves lp, hp and command sockets
+        ingest_thread = std::thread(&Supervisor::listen_for_data, this);
+    }
+    else if (dataflowtype == "binary") {
         lp_data_thread = std::thread(&Supervisor::listen_for_lp_data, this);
         hp_data_thread = std::thread(&Supervisor::listen_for_hp_data, this);
     }
@@ -249,7 +302,13 @@ void Supervisor::start_service_threads() {
         hp_data_thread = std::thread(&Supervisor::listen_for_hp_string, this);
     }
 
-    result_thread = std::thread(&Supervisor::listen_for_result, this);
+    // One result sender per manager
+    result_stats_time = std::chrono::steady_clock::now();
+    int indexmanager = 0;
+    for (auto& manager : manager_workers) {
+        result_threads.emplace_back(&Supervisor::listen_for_result, this, manager, indexmanager);
+        indexmanager++;
+    }
 }
 
 // Set up result channel for a given WorkerManager
@@ -295,12 +354,64 @@ void Supervisor::setup_result_channel(WorkerManager* manager, int indexmanager)
 
 // Start managers
 void Supervisor::start_managers() {
-    int indexmanager = 0;
-    WorkerManager* manager = new WorkerManager(indexmanager, this, "Generic");
-    setup_result_channel(manager, indexmanager);
-    manager->run();
-    manager_workers.push_back(manager);
-    logger->info("[Supervisor] BASE SUP manager started.");
+    if (manager_names.size() > socket_lp_result.size()) {
+        logger->error(fmt::format("Too many managers ({}), only {} are started", manager_names.size(), socket_lp_result.size()), globalname);
+    }
+
+    // The pool exists before the managers, which connect their queues to its signal
+    if (config.contains("worker_pool")) {
+        worker_pool = std::make_unique<WorkerPool>(config["worker_pool"], logger, fullname);
+    }
+
+    for (size_t indexmanager = 0; indexmanager < manager_names.size() && indexmanager < socket_lp_result.size(); indexmanager++) {
+        WorkerManager* manager = create_manager(indexmanager, manager_names[indexmanager]);
+        setup_result_channel(manager, indexmanager);
+        manager->run();
+        manager_workers.push_back(manager);
+        logger->info(fmt::format("[Supervisor] BASE SUP manager {} started.", manager_names[indexmanager]), globalname);
+    }
+
+    connect_managers();
+}
+
+// Connect the managers declared as "downstream" of another manager. The graph must be acyclic.
+void Supervisor::connect_managers() {
+    std::map<std::string, WorkerManager*> managers_by_name;
+    for (auto* manager : manager_workers) {
+        managers_by_name[manager->getName()] = manager;
+    }
+
+    // True if target is reachable from start through the connections made so far
+    std::function<bool(WorkerManager*, WorkerManager*)> reaches = [&](WorkerManager* start, WorkerManager* target) {
+        if (start == target) {
+            return true;
+        }
+        for (auto* next : start->getDownstreamManagers()) {
+            if (reaches(next, target)) {
+                return true;
+            }
+        }
+        return false;
+    };
+
+    for (auto* manager : manager_workers) {
+        for (const auto& downstream_name : manager->getDownstreamNames()) {
+            auto it = managers_by_name.find(downstream_name);
+            if (it == managers_by_name.end()) {
+                logger->error("Unknown downstream manager " + downstream_name + " of " + manager->getName(), globalname);
+                continue;
+            }
+            if (reaches(it->second, manager)) {
+                logger->error("Downstream manager " + downstream_name + " of " + manager->getName() + " would create a cycle", globalname);
+                continue;
+            }
+            manager->add_downstream(it->second);
+        }
+    }
+}
+
+WorkerManager* Supervisor::create_manager(int indexmanager, const std::string& manager_name) {
+    return new WorkerManager(indexmanager, this, manager_name);
 }
 
 // Start workers
@@ -308,10 +419,15 @@ void Supervisor::start_workers() {
     int indexmanager = 0;
 
     for (auto& manager : manager_workers) {
-        manager->start_worker_threads(manager_num_workers);
+        manager->start_worker_threads(managers_num_workers[indexmanager]);
         logger->info("[Supervisor] BASE SUP start_worker_threads");
         indexmanager++;
     }
+
+    // After all the managers using the pool have been added
+    if (worker_pool) {
+        worker_pool->start();
+    }
 }
 
 // Start Supervisor operations
@@ -324,6 +440,15 @@ void Supervisor::start() {
     status = "Waiting";
     send_info(1, status, fullname, 1, "Low");
 
+    if (ingestmode == "poller") {
+        // Commands are served by the ingest engine, wait here until shutdown
+        std::unique_lock<std::mutex> lock(cv_mtx);
+        while (continueall) {
+            cv.wait_for(lock, std::chrono::seconds(1));
+        }
+        return;
+    }
+
     while (continueall) {
         listen_for_commands();
         std::this_thread::sleep_for(std::chrono::seconds(1)); // To avoid 100% CPU
@@ -377,37 +502,37 @@ void Supervisor::handle_signals(int signum) {
     }
 }
 
-// Listen for result data
-void Supervisor::listen_for_result() {
-    try {
-        while (continueall) {
-            std::this_thread::sleep_for(std::chrono::milliseconds(10));     // To avoid 100% CPU 
-            int indexmanager = 0;
+// Result sender of one manager: waits on the manager result signal and drains the result queues
+// in batches. Each manager has its own sender thread, so the result sockets are used by one thread only.
+void Supervisor::listen_for_result(WorkerManager* manager, int indexmanager) {
+    const auto idle_timeout = std::chrono::milliseconds(100);   // Upper bound to check continueall and flush the reorder buffers
+    auto result_signal = manager->getResultSignal();
 
-            for (auto& manager : manager_workers) {
-                int attempt = 0;  
+    logger->info(fmt::format("[Supervisor] Start result sender for manager at index {}", indexmanager), globalname);
 
-                while (manager == nullptr && attempt < 10) {
-                    std::this_thread::sleep_for(std::chrono::seconds(1));  // Sleep for 1 second to avoid 100% CPU 
-                    attempt++;
-                }
+    try {
+        while (continueall) {
+            // The ticket is taken before draining, so a result pushed after the drain wakes the sender
+            uint64_t ticket = result_signal->prepare_wait();
+            size_t sent = 0;
 
-                if (manager == nullptr) {
-                    logger->error(fmt::format("Manager worker not initialized after maximum attempts, skipping index {}", indexmanager));
-                    continue;  // Skip sending results if manager is still null 
-                }
+            try {
+                // Release the ordered results blocked by lost sequences
+                manager->flush_expired_results();
+                sent = send_result(manager, indexmanager);
+            }
+            catch (const std::exception& e) {
+                logger->error(fmt::format("Exception while sending results for manager at index {}: {}", indexmanager, e.what()));
+            }
+            catch (...) {
+                logger->error(fmt::format("Unknown exception while sending results for manager at index {}", indexmanager));
+            }
 
-                try {
-                    send_result(manager, indexmanager);
-                }
-                catch (const std::exception& e) {
-                    logger->error(fmt::format("Exception while sending results for manager at index {}: {}", indexmanager, e.what()));
-                }
-                catch (...) {
-                    logger->error(fmt::format("Unknown exception while sending results for manager at index {}", indexmanager));
-                }
+            update_result_stats();
+            manager->update_result_rates();
 
-                indexmanager++;
+            if (sent == 0) {
+                result_signal->wait(ticket, idle_timeout);
             }
         }
     }
@@ -420,92 +545,147 @@ void Supervisor::listen_for_result() {
         continueall = false;
     }
 
-    std::cout << "[Supervisor] End listen_for_result" << std::endl;
-    logger->info("[Supervisor] End listen_for_result", globalname);
+    std::cout << "[Supervisor] End listen_for_result " << indexmanager << std::endl;
+    logger->info(fmt::format("[Supervisor] End listen_for_result for manager at index {}", indexmanager), globalname);
 }
 
-// Send result data
-void Supervisor::send_result(WorkerManager* manager, int indexmanager) {
-    if (manager->getResultLpQueue()->empty() && manager->getResultHpQueue()->empty()) {
-        return;
+// Send up to result_batch_size results of a manager, returns the number of results taken from the queues.
+// hp results are preferred, but after result_hp_burst consecutive hp results one lp result is sent
+// so that a steady hp flow cannot starve the lp channel.
+size_t Supervisor::send_result(WorkerManager* manager, int indexmanager) {
+    auto result_hp_queue = manager->getResultHpQueue();
+    auto result_lp_queue = manager->getResultLpQueue();
+    size_t sent = 0;
+    size_t hp_streak = 0;
+    DataMessage data;
+
+    while (sent < result_batch_size) {
+        bool lp_turn = hp_streak >= result_hp_burst;
+
+        if (!lp_turn && result_hp_queue->try_pop(data)) {
+            hp_streak++;
+            send_result_channel(manager, indexmanager, data, 1);
+        }
+        else if (result_lp_queue->try_pop(data)) {
+            hp_streak = 0;
+            send_result_channel(manager, indexmanager, data, 0);
+        }
+        else if (lp_turn && result_hp_queue->try_pop(data)) {
+            hp_streak = 0;  // No lp result is waiting
+            send_result_channel(manager, indexmanager, data, 1);
+        }
+        else {
+            break;
+        }
+
+        sent++;
     }
 
-    json data;
-    int channel = -1;
+    return sent;
+}
 
-    if (!manager->getResultHpQueue()->empty()) {
-        channel = 1;
-        data = manager->getResultHpQueue()->get();
-    }
-    else if (!manager->getResultLpQueue()->empty()) {
-        channel = 0;
-        data = manager->getResultLpQueue()->get();
-    }
-    else {
-        std::cerr << "Both queues are empty, can't send results." << std::endl;
-        logger->warning("Both queues are empty, can't send results.");
-        return;
+// Send a result to the downstream managers and on the lp (channel 0) or hp (channel 1) result socket of a manager.
+// The result socket is only needed by the managers at the end of an in-process pipeline.
+void Supervisor::send_result_channel(WorkerManager* manager, int indexmanager, const DataMessage& data, int channel) {
+    bool forwarded = !manager->getDownstreamManagers().empty();
+    if (forwarded) {
+        manager->forward_result(data, channel);
     }
 
     if (channel == 0) {
-        logger->info("Sending lp results.");
-
         if (manager->get_result_lp_socket() == "none") {
-            std::cerr << "Lp socket is empty, can't send results." << std::endl;
-            logger->warning("Lp socket is empty, can't send results.");
+            if (!forwarded) {
+                logger->warning("Lp socket is empty, can't send results.");
+            }
             return;
         }
-        if (manager->get_result_dataflow_type() == "string" || manager->get_result_dataflow_type() == "filename") {
-            try {
-                std::string data_str = data.get<std::string>();
-                socket_lp_result[indexmanager]->send(zmq::buffer(data_str));
-            }
-            catch (const std::exception& e) {
-                std::cerr << "ERROR: data not in string format to be sent to: " << e.what() << std::endl;
-                logger->error("ERROR: data not in string format to be sent to: " + std::string(e.what()), globalname);
-            }
+        if (send_result_data(socket_lp_result[indexmanager], data, manager->get_result_dataflow_type())) {
+            manager->add_result_sent(0, data.total_size());
         }
-        else if (manager->get_result_dataflow_type() == "binary") {
-            try {
-                logger->info("Supervisor::send_result: sending binary lp results.");
-                socket_lp_result[indexmanager]->send(zmq::buffer(data.dump()));
-                logger->info("Supervisor::send_result: finished sending binary lp results.");
-            }
-            catch (const std::exception& e) {
-                std::cerr << "ERROR: data not in binary format to be sent to socket_result: " << e.what() << std::endl;
-                logger->error("ERROR: data not in binary format to be sent to socket_result: " + std::string(e.what()), globalname);
+    }
+    else {
+        if (manager->get_result_hp_socket() == "none") {
+            if (!forwarded) {
+                logger->warning("Hp socket is empty, can't send results.");
             }
+            return;
+        }
+        if (send_result_data(socket_hp_result[indexmanager], data, manager->get_result_dataflow_type())) {
+            manager->add_result_sent(1, data.total_size());
         }
     }
+}
 
-    if (channel == 1) {
-        logger->info("Sending hp results.");
+// Send one result on a result socket.
+// String, filename and raw binary results are handed to zmq without copying: the message references
+// the result buffer and releases it once sent. The json encoding (array of integers) is kept for
+// consumers of the previous format.
+bool Supervisor::send_result_data(zmq::socket_t* socket, const DataMessage& data, const std::string& dataflow_type) {
+    if (dataflow_type != "string" && dataflow_type != "filename" && dataflow_type != "binary") {
+        return false;
+    }
 
-        if (manager->get_result_hp_socket() == "none") {
-            std::cerr << "Hp socket is empty, can't send results." << std::endl;
-            logger->warning("Hp socket is empty, can't send results.");
-            return;
-        }
-        if (manager->get_result_dataflow_type() == "string" || manager->get_result_dataflow_type() == "filename") {
-            try {
-                std::string data_str = data.get<std::string>();
-                socket_hp_result[indexmanager]->send(zmq::buffer(data_str));
-            }
-            catch (const std::exception& e) {
-                std::cerr << "ERROR: data not in string format to be sent to: " << e.what() << std::endl;
-                logger->error("ERROR: data not in string format to be sent to: " + std::string(e.what()), globalname);
-            }
+    auto start = std::chrono::steady_clock::now();
+
+    try {
+        if (dataflow_type == "binary" && result_encoding == "json") {
+            json data_json = data.to_vector();
+            socket->send(zmq::buffer(data_json.dump()), zmq::send_flags::none);
         }
-        else if (manager->get_result_dataflow_type() == "binary") {
-            try {
-                socket_hp_result[indexmanager]->send(zmq::buffer(data.dump()));
-            }
-            catch (const std::exception& e) {
-                std::cerr << "ERROR: data not in binary format to be sent to socket_result: " << e.what() << std::endl;
-                logger->error("ERROR: data not in binary format to be sent to socket_result: " + std::string(e.what()), globalname);
+        else {
+            // The parts of a multipart result (OutputBuffer::next_part) are sent as frames of one zmq message
+            for (const DataMessage* part = &data; part; part = part->next_part()) {
+                socket->send(part->to_message(buffer_pool), part->next_part() ? zmq::send_flags::sndmore : zmq::send_flags::none);
             }
         }
     }
+    catch (const std::exception& e) {
+        std::cerr << "ERROR: data not in " << dataflow_type << " format to be sent to socket_result: " << e.what() << std::endl;
+        logger->error("ERROR: data not in " + dataflow_type + " format to be sent to socket_result: " + std::string(e.what()), globalname);
+        return false;
+    }
+
+    auto elapsed = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count();
+    result_send_count.fetch_add(1, std::memory_order_relaxed);
+    result_send_bytes.fetch_add(data.total_size(), std::memory_order_relaxed);
+    result_send_time_ns.fetch_add(elapsed, std::memory_order_relaxed);
+    return true;
+}
+
+// Compute the result send statistics once per second, called by all the result senders
+void Supervisor::update_result_stats() {
+    std::unique_lock<std::mutex> lock(result_stats_mtx, std::try_to_lock);
+    if (!lock.owns_lock()) {
+        return;     // Another sender is updating
+    }
+
+    auto now = std::chrono::steady_clock::now();
+    double elapsed = std::chrono::duration<double>(now - result_stats_time).count();
+
+    if (elapsed < 1.0) {
+        return;
+    }
+
+    uint64_t count = result_send_count.exchange(0, std::memory_order_relaxed);
+    uint64_t bytes = result_send_bytes.exchange(0, std::memory_order_relaxed);
+    uint64_t time_ns = result_send_time_ns.exchange(0, std::memory_order_relaxed);
+    result_stats_time = now;
+
+    result_send_time_us = count > 0 ? time_ns / 1000.0 / count : 0.0;
+    result_send_rate_mbs = bytes / elapsed / 1e6;
+
+    if (count > 0) {
+        logger->info(fmt::format("Result send ({}) {} messages {:.2f} MB/s, {:.2f} us per message",
+            result_encoding, count, result_send_rate_mbs.load(), result_send_time_us.load()), globalname);
+    }
+}
+
+double Supervisor::get_result_send_time_us() const {
+    return result_send_time_us;
+}
+
+double Supervisor::get_result_send_rate_mbs() const {
+    return result_send_rate_mbs;
 }
 
 // Helper function to receive and process binary data
@@ -523,20 +703,36 @@ void Supervisor::receive_and_process_binary(zmq::socket_t* socket, bool is_low_p
         return;
     }
     
-    // Convert received binary data to vector
-    std::vector<unsigned char> data_vec(
-        static_cast<unsigned char*>(data.data()), 
-        static_cast<unsigned char*>(data.data()) + data.size()
-    );
-
-    // Push to all manager queues
-    for (auto& manager : manager_workers) {
-        if (is_low_priority) {
-            manager->getLowPriorityQueue()->push(data_vec);
-        } else {
-            manager->getHighPriorityQueue()->push(data_vec);
+    const IngestChannelConfig& channel = is_low_priority ? ingest_lp_config : ingest_hp_config;
+    std::vector<DataMessage>& batch = is_low_priority ? ingest_lp_batch : ingest_hp_batch;
+    batch.clear();
+
+    // The received frame is shared by all the managers, the payload is not copied
+    batch.push_back(DataMessage::from_frame(std::move(data), buffer_pool));
+    batch.back().set_ingest_time(std::chrono::steady_clock::now());
+
+    // Drain the messages already pending on the socket, up to the batch size and the drain budget
+    auto deadline = std::chrono::steady_clock::now() + channel.drain_budget;
+    while (batch.size() < channel.batch_size && std::chrono::steady_clock::now() < deadline) {
+        zmq::message_t next;
+        if (!socket->recv(next, zmq::recv_flags::dontwait)) {
+            break;
         }
+        batch.push_back(DataMessage::from_frame(std::move(next), buffer_pool));
+        batch.back().set_ingest_time(std::chrono::steady_clock::now());
     }
+
+    (is_low_priority ? ingest_lp_count : ingest_hp_count) += batch.size();
+
+    uint64_t sequence = next_sequence(is_low_priority, batch.size());
+    for (auto& message : batch) {
+        message.set_sequence(sequence++);
+    }
+
+    push_ingest(batch, is_low_priority);
+
+    // The queues hold their own references
+    batch.clear();
 }
 
 // Helper function to receive and process string data
@@ -554,17 +750,18 @@ void Supervisor::receive_and_process_string(zmq::socket_t* socket, bool is_low_p
         return;
     }
     
-    std::string data_str(static_cast<char*>(data.data()), data.size());
-    std::vector<unsigned char> data_vec(data_str.begin(), data_str.end());
-
-    // Push to all manager queues
-    for (auto& manager : manager_workers) {
-        if (is_low_priority) {
-            manager->getLowPriorityQueue()->push(data_vec);
-        } else {
-            manager->getHighPriorityQueue()->push(data_vec);
-        }
-    }
+    // The string bytes are kept in the received frame, shared by all the managers
+    DataMessage message = DataMessage::from_frame(std::move(data), buffer_pool);
+    message.set_sequence(next_sequence(is_low_priority));
+    message.set_ingest_time(std::chrono::steady_clock::now());
+
+    (is_low_priority ? ingest_lp_count : ingest_hp_count)++;
+
+    std::vector<DataMessage>& batch = is_low_priority ? ingest_lp_batch : ingest_hp_batch;
+    batch.clear();
+    batch.push_back(std::move(message));
+    push_ingest(batch, is_low_priority);
+    batch.clear();
 }
 
 // Helper function to receive and process file data
@@ -583,17 +780,204 @@ void Supervisor::receive_and_process_file(zmq::socket_t* socket, bool is_low_pri
     }
     
     std::string filename(static_cast<char*>(filename_msg.data()), filename_msg.size());
+    (is_low_priority ? ingest_lp_count : ingest_hp_count)++;
+    auto ingest_time = std::chrono::steady_clock::now();    // All the records are received with the file name
+
+    // The file is read once and its records are shared by all the managers
+    auto [data, size] = open_file(filename);
+    std::vector<DataMessage> records;
+    records.reserve(size);
+
+    for (int i = 0; i < size; i++) {
+        try {
+            records.push_back(DataMessage::from_vector(data[i].get<std::vector<uint8_t>>(), buffer_pool));
+        }
+        catch (const json::exception& e) {
+            logger->error(fmt::format("[{}] record {} of {} is not binary: {}", log_context, i, filename, e.what()), globalname);
+        }
+    }
+
+    uint64_t sequence = next_sequence(is_low_priority, records.size());
+    for (auto& record : records) {
+        record.set_sequence(sequence++);
+        record.set_ingest_time(ingest_time);
+    }
+
+    push_ingest(records, is_low_priority);
+}
+
+void Supervisor::push_ingest(const std::vector<DataMessage>& messages, bool is_low_priority) {
+    std::lock_guard<std::mutex> lock(ingest_backlog_mtx);
+    auto& backlogs = is_low_priority ? ingest_lp_backlog : ingest_hp_backlog;
 
     for (auto& manager : manager_workers) {
-        auto [data, size] = open_file(filename);
-        for (int i = 0; i < size; i++) {
-            if (is_low_priority) {
-                manager->getLowPriorityQueue()->push(data[i]);
-            } else {
-                manager->getHighPriorityQueue()->push(data[i]);
+        if (!manager->isIngestInput()) {
+            continue;   // Fed by other managers
+        }
+        auto queue = is_low_priority ? manager->getLowPriorityQueue() : manager->getHighPriorityQueue();
+        auto& backlog = backlogs[manager];
+
+        // Behind the held back messages, to keep the order. Only a full block-bounded queue refuses
+        // a message, the other overflow policies have already dropped or rejected it.
+        size_t accepted = backlog.empty() ? queue->try_push_batch(messages) : 0;
+        backlog.insert(backlog.end(), messages.begin() + accepted, messages.end());
+    }
+}
+
+bool Supervisor::flush_ingest_backlog(bool is_low_priority) {
+    std::lock_guard<std::mutex> lock(ingest_backlog_mtx);
+    bool empty = true;
+
+    for (auto& [manager, backlog] : is_low_priority ? ingest_lp_backlog : ingest_hp_backlog) {
+        auto queue = is_low_priority ? manager->getLowPriorityQueue() : manager->getHighPriorityQueue();
+        if (!backlog.empty()) {
+            size_t accepted = queue->try_push_batch(backlog);
+            backlog.erase(backlog.begin(), backlog.begin() + accepted);
+        }
+        empty = empty && backlog.empty();
+    }
+    return empty;
+}
+
+// Dispatch a ready message on a data socket according to the configured dataflow type
+void Supervisor::receive_data(zmq::socket_t* socket, bool is_low_priority, const std::string& log_context) {
+    if (dataflowtype == "binary") {
+        receive_and_process_binary(socket, is_low_priority, log_context);
+    }
+    else if (dataflowtype == "string") {
+        receive_and_process_string(socket, is_low_priority, log_context);
+    }
+    else if (dataflowtype == "filename") {
+        receive_and_process_file(socket, is_low_priority, log_context);
+    }
+}
+
+// Helper function to receive and process a command without blocking
+void Supervisor::receive_and_process_command(zmq::socket_t* socket) {
+    zmq::message_t command_msg;
+    auto result = socket->recv(command_msg, zmq::recv_flags::dontwait);
+
+    if (!result) {
+        return;
+    }
+
+    std::string command_str(static_cast<char*>(command_msg.data()), command_msg.size());
+
+    try {
+        json command = json::parse(command_str);
+        process_command(command);
+    }
+    catch (const json::exception& e) {
+        logger->error("JSON parse error: " + std::string(e.what()), globalname);
+    }
+}
+
+// Compute the ingest rates once per second
+void Supervisor::update_ingest_rate(std::chrono::steady_clock::time_point& last_time, uint64_t& last_lp_count, uint64_t& last_hp_count) {
+    auto now = std::chrono::steady_clock::now();
+    double elapsed = std::chrono::duration<double>(now - last_time).count();
+
+    if (elapsed < 1.0) {
+        return;
+    }
+
+    uint64_t lp_count = ingest_lp_count.load(std::memory_order_relaxed);
+    uint64_t hp_count = ingest_hp_count.load(std::memory_order_relaxed);
+    ingest_lp_rate = (lp_count - last_lp_count) / elapsed;
+    ingest_hp_rate = (hp_count - last_hp_count) / elapsed;
+    last_lp_count = lp_count;
+    last_hp_count = hp_count;
+    last_time = now;
+
+    if (!stopdata) {
+        logger->info(fmt::format("Ingest rate Hz lp {:.1f} hp {:.1f} Total events lp {} hp {}",
+            ingest_lp_rate.load(), ingest_hp_rate.load(), lp_count, hp_count), globalname);
+    }
+}
+
+uint64_t Supervisor::next_sequence(bool is_low_priority, uint64_t count) {
+    return (is_low_priority ? lp_sequence : hp_sequence).fetch_add(count, std::memory_order_relaxed);
+}
+
+uint64_t Supervisor::get_next_sequence(bool is_low_priority) const {
+    return (is_low_priority ? lp_sequence : hp_sequence).load(std::memory_order_relaxed);
+}
+
+double Supervisor::get_ingest_lp_rate() const {
+    return ingest_lp_rate;
+}
+
+double Supervisor::get_ingest_hp_rate() const {
+    return ingest_hp_rate;
+}
+
+// Ingest engine: a single zmq::poll over the command, hp and lp sockets.
+// The thread sleeps in the poll until a socket is readable, so the ingest rate is
+// bound by the downstream processing instead of a fixed sleep per message.
+void Supervisor::listen_for_data() {
+    const auto poll_timeout = std::chrono::milliseconds(100);   // Upper bound to check continueall and stopdata
+    const auto backlog_retry = std::chrono::milliseconds(1);    // Retry period of the messages held back by full queues
+
+    std::vector<zmq::pollitem_t> items;
+    items.reserve(3);
+
+    auto last_time = std::chrono::steady_clock::now();
+    uint64_t last_lp_count = 0;
+    uint64_t last_hp_count = 0;
+
+    logger->info("[Supervisor] Start ingest engine", globalname);
+
+    while (continueall) {
+        bool hp_ready = flush_ingest_backlog(false);
+        bool lp_ready = flush_ingest_backlog(true);
+
+        // While data is stopped only the command socket is polled, the data stays in the socket buffers.
+        // The same for a channel held back by a full queue: it is read again once its backlog is accepted,
+        // and the commands are served meanwhile.
+        // hp is placed before lp so that it is served first when both are ready
+        items.clear();
+        items.push_back({socket_command->handle(), 0, ZMQ_POLLIN, 0});
+        size_t hp_item = 0;
+        size_t lp_item = 0;
+        if (!stopdata && hp_ready) {
+            hp_item = items.size();
+            items.push_back({socket_hp_data->handle(), 0, ZMQ_POLLIN, 0});
+        }
+        if (!stopdata && lp_ready) {
+            lp_item = items.size();
+            items.push_back({socket_lp_data->handle(), 0, ZMQ_POLLIN, 0});
+        }
+
+        try {
+            zmq::poll(items.data(), items.size(), hp_ready && lp_ready ? poll_timeout : backlog_retry);
+        }
+        catch (const zmq::error_t& e) {
+            if (e.num() == EINTR) {
+                continue;
+            }
+            if (e.num() != ETERM) {
+                logger->error("ZMQ exception in listen_for_data: " + std::string(e.what()), globalname);
             }
+            break;
+        }
+
+        if (hp_item > 0 && (items[hp_item].revents & ZMQ_POLLIN)) {
+            receive_data(socket_hp_data, false, "listen_for_data hp");
+        }
+
+        if (lp_item > 0 && (items[lp_item].revents & ZMQ_POLLIN)) {
+            receive_data(socket_lp_data, true, "listen_for_data lp");
+        }
+
+        if (items[0].revents & ZMQ_POLLIN) {
+            receive_and_process_command(socket_command);
         }
+
+        update_ingest_rate(last_time, last_lp_count, last_hp_count);
     }
+
+    std::cout << "[Supervisor] End listen_for_data" << std::endl;
+    logger->info("[Supervisor] End listen_for_data", globalname);
 }
 
 // Listen for low priority data (method is overridden in Supervisor1 and Supervisor2)
@@ -601,7 +985,7 @@ void Supervisor::listen_for_lp_data() {
     while (continueall) {
         std::this_thread::sleep_for(std::chrono::milliseconds(10));     // To avoid 100% CPU 
 
-        if (!stopdata) {
+        if (!stopdata && flush_ingest_backlog(true)) {
             receive_and_process_binary(socket_lp_data, true, "listen_for_lp_data");
         }
     }
@@ -615,7 +999,7 @@ void Supervisor::listen_for_hp_data() {
     while (continueall) {
         std::this_thread::sleep_for(std::chrono::milliseconds(10));     // To avoid 100% CPU 
 
-        if (!stopdata) {
+        if (!stopdata && flush_ingest_backlog(false)) {
             receive_and_process_binary(socket_hp_data, false, "listen_for_hp_data");
         }
     }
@@ -629,7 +1013,7 @@ void Supervisor::listen_for_lp_string() {
     while (continueall) {
         std::this_thread::sleep_for(std::chrono::milliseconds(10));     // To avoid 100% CPU 
 
-        if (!stopdata) {
+        if (!stopdata && flush_ingest_backlog(true)) {
             receive_and_process_string(socket_lp_data, true, "listen_for_lp_string");
         }
     }
@@ -643,7 +1027,7 @@ void Supervisor::listen_for_hp_string() {
     while (continueall) {
         std::this_thread::sleep_for(std::chrono::milliseconds(10));     // To avoid 100% CPU 
 
-        if (!stopdata) {
+        if (!stopdata && flush_ingest_backlog(false)) {
             receive_and_process_string(socket_hp_data, false, "listen_for_hp_string");
         }
     }
@@ -657,7 +1041,7 @@ void Supervisor::listen_for_lp_file() {
     while (continueall) {
         std::this_thread::sleep_for(std::chrono::milliseconds(10));     // To avoid 100% CPU 
 
-        if (!stopdata) {
+        if (!stopdata && flush_ingest_backlog(true)) {
             receive_and_process_file(socket_lp_data, true, "listen_for_lp_file");
         }
     }
@@ -701,7 +1085,7 @@ void Supervisor::listen_for_hp_file() {
     while (continueall) {
         std::this_thread::sleep_for(std::chrono::milliseconds(10));     // To avoid 100% CPU 
 
-        if (!stopdata) {
+        if (!stopdata && flush_ingest_backlog(false)) {
             receive_and_process_file(socket_hp_data, false, "listen_for_hp_file");
         }
     }
@@ -789,7 +1173,10 @@ void Supervisor::command_cleanedshutdown() {
             std::cout << "[Supervisor] Trying to stop " << manager->get_globalname() << "..." << std::endl;
             logger->info("[Supervisor] Trying to stop " + manager->get_globalname() + "...", globalname);
 
-            while (manager->getLowPriorityQueue()->size() != 0 || manager->getHighPriorityQueue()->size() != 0) {
+            // The messages held back by the full queues are pushed before, the messages taken by the pool threads processed
+            while (!flush_ingest_backlog(true) || !flush_ingest_backlog(false) ||
+                   manager->getLowPriorityQueue()->size() != 0 || manager->getHighPriorityQueue()->size() != 0 ||
+                   (manager->getWorkerPool() && manager->getWorkerPool()->getLocalQueuedCount() != 0)) {
                 std::cout << "[Supervisor] Queues data of manager " << manager->get_globalname() << " have size "
                     << manager->getLowPriorityQueue()->size() << " " << manager->getHighPriorityQueue()->size() << std::endl;
                 logger->info("[Supervisor] Queues data of manager " + manager->get_globalname() + " have size "
@@ -822,6 +1209,12 @@ void Supervisor::command_reset() {
     if (status == "Processing" || status == "Waiting") {
         command_stop();
 
+        {
+            std::lock_guard<std::mutex> lock(ingest_backlog_mtx);
+            ingest_lp_backlog.clear();
+            ingest_hp_backlog.clear();
+        }
+
         for (auto& manager : manager_workers) {
             std::cout << "Trying to reset " << manager->get_globalname() << "..." << std::endl;
             logger->info("Trying to reset " + manager->get_globalname() + "...", globalname);
@@ -841,6 +1234,37 @@ void Supervisor::command_reset() {
     }
 }
 
+// Scale command, body: { "manager": name (all the managers if missing), "workers": n, "autoscale": true|false }.
+// Setting the number of workers disables the autoscaling of the manager, unless "autoscale": true is given too.
+void Supervisor::command_scale(const json& command) {
+    json body = command.value("body", json::object());
+    std::string manager_name = body.value("manager", std::string());
+
+    for (auto& manager : manager_workers) {
+        if (!manager_name.empty() && manager->getName() != manager_name) {
+            continue;
+        }
+
+        Autoscaler* autoscaler = manager->getAutoscaler();
+        if (body.contains("workers")) {
+            if (autoscaler) {
+                autoscaler->set_enabled(false);
+            }
+            int workers = manager->scale_workers(body["workers"].get<int>());
+            logger->info(fmt::format("Manager {} scaled to {} workers by command", manager->getName(), workers), globalname);
+        }
+        if (body.contains("autoscale")) {
+            if (autoscaler) {
+                autoscaler->set_enabled(body["autoscale"].get<bool>());
+                logger->info(fmt::format("Manager {} autoscaling {}", manager->getName(), autoscaler->is_enabled() ? "enabled" : "disabled"), globalname);
+            }
+            else {
+                logger->warning("Manager " + manager->getName() + " has no autoscale configuration", globalname);
+            }
+        }
+    }
+}
+
 // Start command
 void Supervisor::command_start() {
 
@@ -935,6 +1359,9 @@ void Supervisor::process_command(const json& command) {
             else if (subtype_value == "startdata") {
                 command_startdata();
             }
+            else if (subtype_value == "scale") {
+                command_scale(command);
+            }
         }
     }
     else if (type_value == 3) { // config
@@ -992,6 +1419,7 @@ void Supervisor::send_info(int level, const std::string& message, const std::str
 // Stop all threads and processes
 void Supervisor::stop_all(bool fast) {
     continueall = false;
+    cv.notify_all();
 
     std::cout << "[Supervisor] Stopping all workers and managers..." << std::endl;
     logger->info("[Supervisor] Stopping all workers and managers...", globalname);
@@ -1002,6 +1430,11 @@ void Supervisor::stop_all(bool fast) {
     command_stop();
     std::this_thread::sleep_for(std::chrono::milliseconds(100));
 
+    // The pool threads use the managers: stop them first
+    if (worker_pool) {
+        worker_pool->stop();
+    }
+
     for (auto& manager : manager_workers) {
         manager->stop(fast);
     }
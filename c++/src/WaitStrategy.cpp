@@ -0,0 +1,67 @@
+// Copyright (C) 2024 INAF
+// This software is distributed under the terms of the BSD-3-Clause license
+//
+// Authors:
+//
+//    Andrea Bulgarelli <andrea.bulgarelli@inaf.it>
+//
+
+#include <rtadp/WaitStrategy.h>
+#include <rtadp/CpuRelax.h>
+#include <stdexcept>
+#include <algorithm>
+
+std::shared_ptr<WaitStrategy> WaitStrategy::create(const std::string& name, const nlohmann::json& configuration) {
+    if (name == "blocking") {
+        return std::make_shared<BlockingWaitStrategy>();
+    }
+    if (name == "spin_then_park") {
+        auto spin_time = std::chrono::microseconds(configuration.value("spin_us", 50));
+        return std::make_shared<SpinThenParkWaitStrategy>(spin_time);
+    }
+    if (name == "busy_spin") {
+        return std::make_shared<BusySpinWaitStrategy>();
+    }
+    throw std::invalid_argument("Config file: wait_strategy must be blocking, spin_then_park or busy_spin");
+}
+
+void BlockingWaitStrategy::wait(WorkSignal& signal, uint64_t ticket, std::chrono::microseconds timeout) {
+    signal.wait(ticket, timeout);
+}
+
+SpinThenParkWaitStrategy::SpinThenParkWaitStrategy(std::chrono::microseconds spin_time)
+    : spin_time(spin_time) {
+}
+
+void SpinThenParkWaitStrategy::wait(WorkSignal& signal, uint64_t ticket, std::chrono::microseconds timeout) {
+    auto start = std::chrono::steady_clock::now();
+    auto spin_deadline = start + std::min(spin_time, timeout);
+
+    while (std::chrono::steady_clock::now() < spin_deadline) {
+        // Check the clock every few spins, the check is more expensive than the pause
+        for (int i = 0; i < 64; i++) {
+            if (signal.changed(ticket)) {
+                return;
+            }
+            cpu_relax();
+        }
+    }
+
+    auto remaining = timeout - std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start);
+    if (remaining.count() > 0) {
+        signal.wait(ticket, remaining);
+    }
+}
+
+void BusySpinWaitStrategy::wait(WorkSignal& signal, uint64_t ticket, std::chrono::microseconds timeout) {
+    auto deadline = std::chrono::steady_clock::now() + timeout;
+
+    while (std::chrono::steady_clock::now() < deadline) {
+        for (int i = 0; i < 64; i++) {
+            if (signal.changed(ticket)) {
+                return;
+            }
+            cpu_relax();
+        }
+    }
+}
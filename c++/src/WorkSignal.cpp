@@ -0,0 +1,64 @@
+// Copyright (C) 2024 INAF
+// This software is distributed under the terms of the BSD-3-Clause license
+//
+// Authors:
+//
+//    Andrea Bulgarelli <andrea.bulgarelli@inaf.it>
+//
+
+#include <rtadp/WorkSignal.h>
+
+WorkSignal::WorkSignal(bool broadcast) : broadcast(broadcast) {
+}
+
+uint64_t WorkSignal::prepare_wait() const {
+    return epoch.load(std::memory_order_acquire);
+}
+
+bool WorkSignal::changed(uint64_t ticket) const {
+    return stopped.load(std::memory_order_relaxed) || epoch.load(std::memory_order_acquire) != ticket;
+}
+
+void WorkSignal::wait(uint64_t ticket, std::chrono::microseconds timeout) {
+    waiters.fetch_add(1, std::memory_order_relaxed);
+    // Pairs with the fence in notify(): either the notifier sees the waiter or the waiter sees the new epoch
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    {
+        std::unique_lock<std::mutex> lock(mtx);
+        condvar.wait_for(lock, timeout, [this, ticket] { return changed(ticket); });
+    }
+    waiters.fetch_sub(1, std::memory_order_relaxed);
+}
+
+void WorkSignal::notify(size_t count) {
+    epoch.fetch_add(1, std::memory_order_release);
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+
+    if (waiters.load(std::memory_order_relaxed) == 0) {
+        return;
+    }
+
+    std::lock_guard<std::mutex> lock(mtx);
+    if (count > 1 || broadcast) {
+        condvar.notify_all();
+    }
+    else {
+        condvar.notify_one();
+    }
+}
+
+void WorkSignal::notify_all() {
+    epoch.fetch_add(1, std::memory_order_release);
+    std::lock_guard<std::mutex> lock(mtx);
+    condvar.notify_all();
+}
+
+void WorkSignal::stop() {
+    std::lock_guard<std::mutex> lock(mtx);
+    stopped = true;
+    condvar.notify_all();
+}
+
+bool WorkSignal::is_stopped() const {
+    return stopped;
+}
@@ -7,6 +7,7 @@
 //
 
 #include <rtadp/WorkerBase.h>
+#include <rtadp/WorkerManager.h>
 
 // Default constructor
 WorkerBase::WorkerBase()
@@ -40,5 +41,40 @@ void WorkerBase::config(const nlohmann::json& configuration) {
 
 // Method is overridden in Worker1 and Worker2
 std::vector<uint8_t> WorkerBase::processData(const std::vector<uint8_t>& data, int priority) {
+    if (!missing_override_logged.exchange(true) && manager) {
+        manager->logger->error(fmt::format("Worker {} does not override processData: its messages produce no result", fullname),
+                               "WorkerBase-" + fullname);
+    }
     return {};
 }
+
+// Adapter for the workers that implement only the std::vector interface
+std::vector<uint8_t> WorkerBase::processData(const DataMessage& data, int priority) {
+    return processData(data.to_vector(), priority);
+}
+
+// Adapter for the workers that do not use the context
+std::vector<uint8_t> WorkerBase::processData(const DataMessage& data, int priority, WorkerContext& context) {
+    return processData(data, priority);
+}
+
+// Adapter for the workers that return the result as a vector
+void WorkerBase::processData(const DataMessage& data, int priority, OutputBuffer& output, WorkerContext& context) {
+    output.append_part(processData(data, priority, context));
+}
+
+// Adapter for the workers that process one message at a time, through the same entry point as the single messages
+void WorkerBase::processBatch(const std::vector<DataMessage>& batch, int priority, std::vector<DataMessage>& results,
+                              WorkerContext& context) {
+    OutputBuffer& output = context.output();
+    results.resize(batch.size());
+    for (size_t i = 0; i < batch.size(); i++) {
+        output.clear();
+        processData(batch[i], priority, output, context);
+        results[i] = output.take();
+    }
+}
+
+DynamicBatcher* WorkerBase::get_batcher() const {
+    return manager ? manager->getBatcher() : nullptr;
+}
@@ -6,6 +6,7 @@
 //    Andrea Bulgarelli <andrea.bulgarelli@inaf.it>
 //
 #include <atomic>
+#include <algorithm>
 #include <rtadp/WorkerManager.h>
 
 // Constructor
@@ -22,25 +23,137 @@ WorkerManager::WorkerManager(int manager_id, Supervisor* supervisor, const std::
     globalname = "WorkerManager-" + fullname;
     processingtype = supervisor->processingtype;
     max_workers = 100;
-    result_socket_type = supervisor->manager_result_sockets_type;
+    result_socket_type = supervisor->manager_result_sockets_types[manager_id];
     result_lp_socket = supervisor->manager_result_lp_sockets[manager_id];
     result_hp_socket = supervisor->manager_result_hp_sockets[manager_id];
-    // result_dataflow_type = supervisor->manager_result_dataflow_type[manager_id];
-    result_dataflow_type = supervisor->manager_result_dataflow_type;
+    result_dataflow_type = supervisor->manager_result_dataflow_types[manager_id];
+    num_workers = supervisor->managers_num_workers[manager_id];
     socket_lp_result = supervisor->socket_lp_result;
     socket_hp_result = supervisor->socket_hp_result;
     pid = getpid();
     socket_monitoring = supervisor->socket_monitoring;
+
+    // Configuration block of this manager in the "manager" array
+    manager_config = json::object();
+    if (config->contains("manager") && manager_id < static_cast<int>((*config)["manager"].size())) {
+        manager_config = (*config)["manager"][manager_id];
+    }
        
-    low_priority_queue = std::make_shared<ThreadSafeQueue<std::vector<uint8_t>>>();
-    high_priority_queue = std::make_shared<ThreadSafeQueue<std::vector<uint8_t>>>();
-    result_lp_queue = std::make_shared<ThreadSafeQueue<std::vector<uint8_t>>>();
-    result_hp_queue = std::make_shared<ThreadSafeQueue<std::vector<uint8_t>>>();
+    // token: the workers take turns reading the queues (see change_token_reading)
+    // concurrent: every idle worker blocks on the queues and takes the data as soon as it arrives
+    scheduling = manager_config.value("scheduling", std::string("token"));
+    if (scheduling != "token" && scheduling != "concurrent") {
+        logger->warning("Unknown scheduling " + scheduling + ", using token", globalname);
+        scheduling = "token";
+    }
+
+    // threads: the manager owns its workers (default)
+    // pool: the data is processed by the worker pool shared by the managers, weighted by "pool_weight"
+    worker_pool = nullptr;
+    pool_weight = manager_config.value("pool_weight", 1);
+    std::string executor = manager_config.value("executor", std::string("threads"));
+    if (executor == "pool") {
+        worker_pool = supervisor->getWorkerPool();
+        if (!worker_pool) {
+            logger->warning("executor pool without a worker_pool in the configuration, using threads", globalname);
+        }
+        else if (scheduling != "concurrent") {
+            logger->info("The worker pool uses concurrent scheduling", globalname);
+            scheduling = "concurrent";
+        }
+    }
+
+    // blocking: idle workers sleep on the work signal (default)
+    // spin_then_park: spin for "spin_us" microseconds before sleeping
+    // busy_spin: never sleep, one core per idle worker
+    std::string wait_strategy_name = manager_config.value("wait_strategy", std::string("blocking"));
+    try {
+        wait_strategy = WaitStrategy::create(wait_strategy_name, manager_config);
+    }
+    catch (const std::invalid_argument& e) {
+        logger->warning("Unknown wait_strategy " + wait_strategy_name + ", using blocking", globalname);
+        wait_strategy = std::make_shared<BlockingWaitStrategy>();
+    }
+
+    // Concurrent workers take up to batch_size messages of the same priority at once (WorkerBase::processBatch).
+    // An lp batch waits up to batch_wait_us to fill; hp batches never wait.
+    batch_size = std::max(static_cast<size_t>(1), manager_config.value("batch_size", static_cast<size_t>(1)));
+    batch_wait = std::chrono::microseconds(manager_config.value("batch_wait_us", 0));
+    if (batch_size > 1 && !isConcurrentScheduling()) {
+        logger->warning("batch_size requires concurrent scheduling, batches disabled", globalname);
+        batch_size = 1;
+    }
+
+    // The scratch arena grows to the peak need of the worker anyway, a right size avoids the warm-up allocations
+    scratch_bytes = manager_config.value("scratch_bytes", WorkerContext::DEFAULT_SCRATCH_BYTES);
+
+    // With token scheduling only the worker holding the reading token can take the data,
+    // so every push must wake all the idle workers
+    work_signal = worker_pool ? worker_pool->getSignal() : std::make_shared<WorkSignal>(!isConcurrentScheduling());
+    low_priority_queue = std::make_shared<NotifyingQueue<DataMessage>>(create_spill_queue("lp", create_queue("lp")), work_signal);
+
+    // hp fast lane: the last hp_reserved_workers workers serve only the hp queue
+    // (and the lp queue when hp is idle, if hp_reserved_lp is set). They wait on hp_signal,
+    // optionally with their own wait strategy and pinned to the CPUs in hp_reserved_cpus.
+    hp_reserved_workers = manager_config.value("hp_reserved_workers", 0);
+    hp_reserved_lp = manager_config.value("hp_reserved_lp", false);
+    hp_reserved_cpus = manager_config.value("hp_reserved_cpus", std::vector<int>());
+    if (worker_pool) {
+        hp_reserved_workers = 0;    // The pool threads take hp data first
+    }
+    else if (hp_reserved_workers < 0 || hp_reserved_workers >= num_workers) {
+        logger->warning(fmt::format("hp_reserved_workers must be between 0 and num_workers - 1, using {}", 
+            std::max(0, num_workers - 1)), globalname);
+        hp_reserved_workers = std::max(0, std::min(hp_reserved_workers, num_workers - 1));
+    }
+
+    if (hp_reserved_workers > 0) {
+        std::string hp_wait_strategy_name = manager_config.value("hp_reserved_wait_strategy", wait_strategy->getName());
+        try {
+            hp_wait_strategy = WaitStrategy::create(hp_wait_strategy_name, manager_config);
+        }
+        catch (const std::invalid_argument& e) {
+            logger->warning("Unknown hp_reserved_wait_strategy " + hp_wait_strategy_name + ", using " + wait_strategy->getName(), globalname);
+            hp_wait_strategy = wait_strategy;
+        }
+
+        // The hp pushes wake both the reserved workers and the others
+        hp_signal = std::make_shared<WorkSignal>();
+        auto hp_queue = std::make_shared<NotifyingQueue<DataMessage>>(create_queue("hp"), hp_signal);
+        high_priority_queue = std::make_shared<NotifyingQueue<DataMessage>>(hp_queue, work_signal);
+    }
+    else {
+        hp_signal = work_signal;
+        hp_wait_strategy = wait_strategy;
+        high_priority_queue = std::make_shared<NotifyingQueue<DataMessage>>(create_queue("hp"), work_signal);
+    }
+    // The result sender of this manager waits on result_signal
+    result_signal = std::make_shared<WorkSignal>();
+    result_lp_queue = std::make_shared<NotifyingQueue<DataMessage>>(create_queue("result_lp"), result_signal);
+    result_hp_queue = std::make_shared<NotifyingQueue<DataMessage>>(create_queue("result_hp"), result_signal);
+
+    // The workers run in parallel, the results are put back in order by sequence number
+    ordered_results = manager_config.value("ordered_results", false);
+    size_t reorder_window = manager_config.value("reorder_window", static_cast<size_t>(4096));
+    auto reorder_timeout = std::chrono::milliseconds(manager_config.value("reorder_timeout_ms", 1000));
+    reorder_lp = std::make_shared<ReorderBuffer>(result_lp_queue, reorder_window, reorder_timeout);
+    reorder_hp = std::make_shared<ReorderBuffer>(result_hp_queue, reorder_window, reorder_timeout);
     
+    // In-process pipeline: the results of this manager are pushed into the input queues of the "downstream"
+    // managers (connected by Supervisor::connect_managers). "ingest": false for the managers fed only by other managers.
+    ingest_input = manager_config.value("ingest", true);
+
+    // lp data older than lp_max_age_ms when taken by a worker is skipped (0 = no limit)
+    lp_max_age = std::chrono::milliseconds(manager_config.value("lp_max_age_ms", 0));
+    if (lp_max_age.count() > 0) {
+        logger->info(fmt::format("lp max age {} ms", lp_max_age.count()), globalname);
+    }
+
+    retired_busy_ns = 0;
+
     // Initialize monitoring
     monitoringpoint = nullptr;
     monitoringthread = nullptr;
-    num_workers = supervisor->manager_num_workers;  
     workersstatus = 0;
     workersstatusinit = 0;
 
@@ -50,6 +163,14 @@ WorkerManager::WorkerManager(int manager_id, Supervisor* supervisor, const std::
     // Log the start of WorkerManager
     logger->info("Started", globalname);
     logger->info(fmt::format("Socket result parameters: {} / {} / {} / {}", result_socket_type, result_lp_socket, result_hp_socket, result_dataflow_type), globalname);
+    logger->info("Scheduling: " + scheduling + " Wait strategy: " + wait_strategy->getName(), globalname);
+    if (ordered_results) {
+        logger->info(fmt::format("Ordered results: window {} timeout {} ms", reorder_window, reorder_timeout.count()), globalname);
+    }
+    if (hp_reserved_workers > 0) {
+        logger->info(fmt::format("hp fast lane: {} reserved workers, wait strategy {}, serve lp {}", 
+            hp_reserved_workers, hp_wait_strategy->getName(), hp_reserved_lp), globalname);
+    }
 
     status = "Initialised";
     supervisor->send_info(1, status, fullname, 1, "Low");
@@ -99,11 +220,32 @@ std::string WorkerManager::getProcessingType() const {
  std::vector<std::shared_ptr<WorkerThread>> WorkerManager::getWorkerProcesses() {
     return workerprocesses;
 }
+*/
+
+std::vector<std::shared_ptr<WorkerProcess>> WorkerManager::getWorkerProcesses() {
+    return worker_processes;
+}
 
-std::vector<std::shared_ptr<WorkerProcess>> WorkerManager::getWorker_Processes() {
-	return worker_processes;
+const json& WorkerManager::getManagerConfig() const {
+    return manager_config;
+}
+
+WorkerPool* WorkerManager::getWorkerPool() const {
+    return worker_pool;
+}
+
+json WorkerManager::getWorkerConfiguration() {
+    std::lock_guard<std::mutex> lock(workers_mutex);
+    return worker_configuration;
+}
+
+uint64_t WorkerManager::getWorkerConfigurationGeneration() const {
+    return worker_configuration_generation;
+}
+
+int WorkerManager::getProcessData() const {
+    return processdata;
 }
-*/
 
 std::vector<std::atomic<double>>& WorkerManager::getProcessingRatesShared() {
     return processing_rates_shared;
@@ -118,25 +260,316 @@ std::vector<std::atomic<int>>& WorkerManager::getWorkerStatusShared() {
 }
 
 std::vector<std::shared_ptr<WorkerThread>> WorkerManager::getWorkerThreads() {
+    std::lock_guard<std::mutex> lock(workers_mutex);
     return worker_threads;
 }
 
-std::shared_ptr<ThreadSafeQueue<std::vector<uint8_t>>> WorkerManager::getLowPriorityQueue() const {
+// Create a queue according to the "queues" block of the manager configuration, e.g.
+// "queues": { "lp": { "type": "lockfree", "capacity": 65536, "max_messages": 10000, "max_bytes": 100000000, "overflow": "drop_oldest" } }
+// Queue names are lp, hp, result_lp, result_hp. The default type is the mutex-based ThreadSafeQueue.
+// max_messages and max_bytes (0 = no limit) bound the queue, overflow is block|drop_oldest|drop_newest|reject.
+std::shared_ptr<MessageQueue<DataMessage>> WorkerManager::create_queue(const std::string& queue_name) {
+    json queue_config = manager_config.value("queues", json::object()).value(queue_name, json::object());
+    std::string type = queue_config.value("type", std::string("mutex"));
+    std::shared_ptr<MessageQueue<DataMessage>> queue;
+
+    if (type == "lockfree") {
+        size_t capacity = queue_config.value("capacity", static_cast<size_t>(65536));
+        logger->info(fmt::format("Queue {}: lockfree ring buffer, capacity {}", queue_name, capacity), globalname);
+        queue = std::make_shared<LockFreeRingBuffer<DataMessage>>(capacity);
+    }
+    else {
+        if (type != "mutex") {
+            logger->warning(fmt::format("Queue {}: unknown type {}, using mutex", queue_name, type), globalname);
+        }
+        queue = std::make_shared<ThreadSafeQueue<DataMessage>>();
+    }
+
+    size_t max_messages = queue_config.value("max_messages", static_cast<size_t>(0));
+    size_t max_bytes = queue_config.value("max_bytes", static_cast<size_t>(0));
+    if (max_messages == 0 && max_bytes == 0) {
+        return queue;
+    }
+
+    std::string overflow = queue_config.value("overflow", std::string("block"));
+    OverflowPolicy policy = OverflowPolicy::Block;
+    try {
+        policy = parse_overflow_policy(overflow);
+    }
+    catch (const std::invalid_argument& e) {
+        logger->warning(fmt::format("Queue {}: unknown overflow {}, using block", queue_name, overflow), globalname);
+        overflow = "block";
+    }
+
+    auto alarm = [this, queue_name](const std::string& message) {
+        logger->error(fmt::format("Queue {} rejecting data. {}", queue_name, message), globalname);
+        supervisor->send_alarm(2, "Queue " + queue_name + " rejecting data. " + message, fullname, 0, "High");
+    };
+
+    // A discarded message will never produce a result: its sequence is skipped, otherwise the ordered
+    // results and the downstream managers would wait for it until the reorder timeout
+    int priority = (queue_name == "hp" || queue_name == "result_hp") ? 1 : 0;
+    auto on_drop = [this, priority](const DataMessage& data) {
+        skip_result(data.sequence(), priority);
+    };
+
+    auto bounded = std::make_shared<BoundedQueue<DataMessage>>(queue, max_messages, max_bytes, policy, alarm, on_drop);
+    bounded_queues[queue_name] = bounded;
+    logger->info(fmt::format("Queue {}: max messages {} max bytes {} overflow {}", queue_name, max_messages, max_bytes, overflow), globalname);
+    return bounded;
+}
+
+// Add the spill to disk to a queue if its configuration has a "spill" block, e.g.
+// "queues": { "lp": { "spill": { "directory": "/data/spill", "high_water": 100000, "low_water": 50000, "segment_bytes": 67108864 } } }
+// Only the lp queue can spill, the hp data always stays in memory.
+std::shared_ptr<MessageQueue<DataMessage>> WorkerManager::create_spill_queue(const std::string& queue_name, std::shared_ptr<MessageQueue<DataMessage>> queue) {
+    json queue_config = manager_config.value("queues", json::object()).value(queue_name, json::object());
+    if (!queue_config.contains("spill")) {
+        return queue;
+    }
+
+    json spill = queue_config["spill"];
+    SpillConfig spill_config;
+    spill_config.directory = spill.value("directory", spill_config.directory);
+    spill_config.high_water = spill.value("high_water", spill_config.high_water);
+    spill_config.low_water = spill.value("low_water", spill_config.low_water);
+    spill_config.segment_bytes = spill.value("segment_bytes", spill_config.segment_bytes);
+
+    // A block-bounded queue can be full below high_water (e.g. by max_bytes): the spill must not wait on it,
+    // the consumers refill it and would wait for themselves
+    auto bounded = bounded_queues.find(queue_name);
+    spill_config.try_push = bounded != bounded_queues.end() && bounded->second->get_policy() == OverflowPolicy::Block;
+
+    logger->info(fmt::format("Queue {}: spill to {} high water {} low water {} segment {} bytes", queue_name,
+        spill_config.directory, spill_config.high_water, spill_config.low_water, spill_config.segment_bytes), globalname);
+
+    // The messages read back from disk do not pass through the NotifyingQueue, wake the workers here
+    auto on_refill = [this](size_t count) { work_signal->notify(count); };
+    spill_lp_queue = std::make_shared<SpillQueue>(queue, spill_config, fullname + "-" + queue_name, on_refill);
+    return spill_lp_queue;
+}
+
+std::shared_ptr<SpillQueue> WorkerManager::getSpillQueue() const {
+    return spill_lp_queue;
+}
+
+const std::map<std::string, std::shared_ptr<BoundedQueue<DataMessage>>>& WorkerManager::getBoundedQueues() const {
+    return bounded_queues;
+}
+
+std::shared_ptr<MessageQueue<DataMessage>> WorkerManager::getLowPriorityQueue() const {
     return low_priority_queue;
 }
 
-std::shared_ptr<ThreadSafeQueue<std::vector<uint8_t>>> WorkerManager::getHighPriorityQueue() const {
+std::shared_ptr<MessageQueue<DataMessage>> WorkerManager::getHighPriorityQueue() const {
     return high_priority_queue;
 }
 
-std::shared_ptr<ThreadSafeQueue<std::vector<uint8_t>>> WorkerManager::getResultLpQueue() const {
+std::shared_ptr<MessageQueue<DataMessage>> WorkerManager::getResultLpQueue() const {
     return result_lp_queue;
 }
 
-std::shared_ptr<ThreadSafeQueue<std::vector<uint8_t>>> WorkerManager::getResultHpQueue() const {
+std::shared_ptr<MessageQueue<DataMessage>> WorkerManager::getResultHpQueue() const {
     return result_hp_queue;
 }
 
+std::shared_ptr<WorkSignal> WorkerManager::getWorkSignal() const {
+    return work_signal;
+}
+
+bool WorkerManager::check_data_age(const DataMessage& data, int priority) {
+    auto age = data.age();
+    (priority == 0 ? age_lp : age_hp).record(age);
+
+    if (priority == 0 && lp_max_age.count() > 0 && age > lp_max_age) {
+        expired_lp_count++;
+        // The sequence is completed without result, so the ordered results do not wait for it
+        skip_result(data.sequence(), priority);
+        return false;
+    }
+    return true;
+}
+
+uint64_t WorkerManager::getExpiredLpCount() const {
+    return expired_lp_count;
+}
+
+const AgeHistogram& WorkerManager::getAgeHistogram(int priority) const {
+    return priority == 0 ? age_lp : age_hp;
+}
+
+bool WorkerManager::isHpReservedWorker(int worker_id) const {
+    return hp_reserved_workers > 0 && worker_id >= num_workers - hp_reserved_workers;
+}
+
+bool WorkerManager::isHpReservedLp() const {
+    return hp_reserved_lp;
+}
+
+int WorkerManager::getHpReservedCpu(int worker_id) const {
+    int index = worker_id - (num_workers - hp_reserved_workers);
+    if (!isHpReservedWorker(worker_id) || index >= static_cast<int>(hp_reserved_cpus.size())) {
+        return -1;
+    }
+    return hp_reserved_cpus[index];
+}
+
+std::shared_ptr<WorkSignal> WorkerManager::getHpSignal() const {
+    return hp_signal;
+}
+
+std::shared_ptr<WaitStrategy> WorkerManager::getHpWaitStrategy() const {
+    return hp_wait_strategy;
+}
+
+std::shared_ptr<WorkSignal> WorkerManager::getResultSignal() const {
+    return result_signal;
+}
+
+void WorkerManager::add_result_sent(int priority, size_t bytes) {
+    ResultChannelStats& stats = result_stats[priority == 0 ? 0 : 1];
+    stats.count.fetch_add(1, std::memory_order_relaxed);
+    stats.bytes.fetch_add(bytes, std::memory_order_relaxed);
+}
+
+void WorkerManager::update_result_rates() {
+    auto now = std::chrono::steady_clock::now();
+
+    for (auto& stats : result_stats) {
+        double elapsed = std::chrono::duration<double>(now - stats.last_time).count();
+        if (elapsed < 1.0) {
+            continue;
+        }
+
+        uint64_t count = stats.count.load(std::memory_order_relaxed);
+        uint64_t bytes = stats.bytes.load(std::memory_order_relaxed);
+        stats.rate = (count - stats.last_count) / elapsed;
+        stats.rate_mbs = (bytes - stats.last_bytes) / elapsed / 1e6;
+        stats.last_count = count;
+        stats.last_bytes = bytes;
+        stats.last_time = now;
+    }
+}
+
+uint64_t WorkerManager::getResultSentCount(int priority) const {
+    return result_stats[priority == 0 ? 0 : 1].count;
+}
+
+double WorkerManager::getResultRate(int priority) const {
+    return result_stats[priority == 0 ? 0 : 1].rate;
+}
+
+double WorkerManager::getResultRateMbs(int priority) const {
+    return result_stats[priority == 0 ? 0 : 1].rate_mbs;
+}
+
+std::shared_ptr<WaitStrategy> WorkerManager::getWaitStrategy() const {
+    return wait_strategy;
+}
+
+size_t WorkerManager::getBatchSize() const {
+    return batch_size;
+}
+
+std::chrono::microseconds WorkerManager::getBatchWait() const {
+    return batch_wait;
+}
+
+size_t WorkerManager::getScratchBytes() const {
+    return scratch_bytes;
+}
+
+size_t WorkerManager::getScratchHighWater() {
+    size_t high_water = 0;
+    for (const auto& thread : getWorkerThreads()) {
+        high_water = std::max(high_water, thread->getScratchHighWater());
+    }
+    for (const auto& process : worker_processes) {
+        high_water = std::max(high_water, process->getScratchHighWater());
+    }
+    return high_water;
+}
+
+std::string WorkerManager::getScheduling() const {
+    return scheduling;
+}
+
+bool WorkerManager::isConcurrentScheduling() const {
+    return scheduling == "concurrent";
+}
+
+void WorkerManager::push_result(DataMessage&& result, int priority) {
+    if (ordered_results) {
+        uint64_t sequence = result.sequence();
+        getReorderBuffer(priority)->insert(sequence, std::move(result));
+    }
+    else if (priority == 0) {
+        result_lp_queue->push(std::move(result));
+    }
+    else {
+        result_hp_queue->push(std::move(result));
+    }
+}
+
+void WorkerManager::skip_result(uint64_t sequence, int priority) {
+    if (ordered_results) {
+        getReorderBuffer(priority)->skip(sequence);
+    }
+
+    // The downstream managers will not receive this sequence either
+    for (auto* downstream : downstream_managers) {
+        downstream->skip_result(sequence, priority);
+    }
+}
+
+bool WorkerManager::isIngestInput() const {
+    return ingest_input;
+}
+
+std::vector<std::string> WorkerManager::getDownstreamNames() const {
+    return manager_config.value("downstream", std::vector<std::string>());
+}
+
+void WorkerManager::add_downstream(WorkerManager* downstream) {
+    downstream_managers.push_back(downstream);
+    logger->info("Results forwarded to " + downstream->getName(), globalname);
+}
+
+const std::vector<WorkerManager*>& WorkerManager::getDownstreamManagers() const {
+    return downstream_managers;
+}
+
+// Push a result into the input queues of the downstream managers. The payload is shared, not copied.
+// The push blocks if a downstream queue is bounded with the block policy, so the backpressure reaches
+// the result queues of this manager and then its workers.
+// A multipart result is concatenated once: the downstream workers read the input as a single payload.
+void WorkerManager::forward_result(const DataMessage& result, int priority) {
+    DataMessage input = result.flatten(supervisor->getBufferPool());
+    for (auto* downstream : downstream_managers) {
+        if (priority == 0) {
+            downstream->getLowPriorityQueue()->push(input);
+        }
+        else {
+            downstream->getHighPriorityQueue()->push(input);
+        }
+    }
+}
+
+void WorkerManager::flush_expired_results() {
+    if (ordered_results) {
+        reorder_lp->flush_expired();
+        reorder_hp->flush_expired();
+    }
+}
+
+bool WorkerManager::isOrderedResults() const {
+    return ordered_results;
+}
+
+std::shared_ptr<ReorderBuffer> WorkerManager::getReorderBuffer(int priority) const {
+    return priority == 0 ? reorder_lp : reorder_hp;
+}
+
 MonitoringPoint* WorkerManager::getMonitoringPoint() const {
     return monitoringpoint;
 }
@@ -149,9 +582,12 @@ MonitoringThread* WorkerManager::getMonitoringThread() const {
 void WorkerManager::change_token_results() {
     std::lock_guard<std::mutex> lock(*tokenresultslock);
 
+    // The reserved hp workers do not take part in the token rotation
+    int token_workers = std::max(1, num_workers - hp_reserved_workers);
+
     for (auto& worker : worker_threads) {
         int token_result = worker->get_tokenresult();
-        token_result = (token_result - 1 + num_workers) % num_workers; // Fix the circular decrement
+        token_result = (token_result - 1 + token_workers) % token_workers; // Fix the circular decrement
         worker->set_tokenresult(token_result);
     }
 }
@@ -169,11 +605,17 @@ void WorkerManager::change_token_reading() {
         return;
     }
 
+    // The reserved hp workers do not take part in the token rotation
+    int token_workers = std::max(1, num_workers - hp_reserved_workers);
+
     for (auto& worker : worker_threads) {
         int token_reading = worker->get_tokenreading();
-        token_reading = (token_reading - 1 + num_workers) % num_workers; // Fix the circular decrement
+        token_reading = (token_reading - 1 + token_workers) % token_workers; // Fix the circular decrement
         worker->set_tokenreading(token_reading);
     }
+
+    // Wake the new token holder, it may be waiting with data already in the queues
+    work_signal->notify_all();
 }
 
 void WorkerManager::set_stopdata(bool stopdata) {
@@ -201,9 +643,15 @@ void WorkerManager::set_processdata(int processdata) {
     this->processdata = processdata;
     change_status();
 
-    for (auto& worker : worker_threads) {
+    for (auto& worker : getWorkerThreads()) {
+        worker->set_processdata(this->processdata);
+    }
+    for (auto& worker : worker_processes) {
         worker->set_processdata(this->processdata);
     }
+
+    // Wake the idle workers so that they see the new processdata value
+    work_signal->notify_all();
 }
 
 void WorkerManager::setWorkerStatus(int worker_id, int status) {
@@ -237,20 +685,212 @@ void WorkerManager::start_service_threads() {
     logger->info(fmt::format("Service thread started"));
 }
 
-// Function to start worker threads 
+// Function to start worker threads.
+// The default implementation creates num_threads WorkerThreads with the workers returned by create_worker().
+// Derived managers can override create_worker() or this method.
 void WorkerManager::start_worker_threads(int num_threads) {
+    // Cross-worker batching of model invocations, see DynamicBatcher.
+    // The forked process workers cannot reach the batcher threads of the parent.
+    if (manager_config.contains("batcher") && processingtype != "process") {
+        const json& batcher_config = manager_config["batcher"];
+        std::string backend_name = batcher_config.value("backend", std::string("cpu_mock"));
+        auto backend = InferenceBackend::create(backend_name, batcher_config);
+        if (!backend) {
+            logger->warning("Unknown inference backend " + backend_name + ", batcher disabled", globalname);
+        }
+        else {
+            batcher = std::make_unique<DynamicBatcher>(this, backend, batcher_config);
+            batcher->start(batcher_config.value("threads", 1));
+        }
+    }
+
+    if (worker_pool) {
+        worker_pool->add_manager(this, pool_weight);
+        num_workers = 0;
+        return;
+    }
+    if (processingtype == "process") {
+        start_worker_processes(num_threads);
+        return;
+    }
+    if (processingtype != "thread") {
+        return;
+    }
+
+    if (num_threads > max_workers) {
+        logger->warning(fmt::format("WARNING! It is not possible to create more than {} threads", max_workers), globalname);
+        num_threads = max_workers;
+    }
+    num_workers = num_threads;
+    // Room for the workers added by scale_workers
+    worker_status_shared = std::vector<std::atomic<int>>(max_workers);
+    processing_rates_shared = std::vector<std::atomic<double>>(max_workers);
+    total_processed_data_count_shared = std::vector<std::atomic<int>>(max_workers);
+
+    {
+        std::lock_guard<std::mutex> lock(workers_mutex);
+        for (int worker_id = 0; worker_id < num_threads; worker_id++) {
+            WorkerBase* worker = create_worker();
+            if (!worker) {
+                logger->warning("No worker class for the workers of " + name + " (set worker_class or override create_worker)", globalname);
+                return;
+            }
+            worker_threads.push_back(std::make_shared<WorkerThread>(worker_id, this, workersname, worker));
+        }
+    }
+
+    logger->info(fmt::format("Started {} worker threads", num_threads), globalname);
+
+    // Autoscaling of the worker threads, see Autoscaler for the parameters
+    if (manager_config.contains("autoscale")) {
+        if (!isScalable()) {
+            logger->warning("autoscale requires concurrent scheduling and no hp reserved workers, disabled", globalname);
+        }
+        else {
+            autoscaler = std::make_unique<Autoscaler>(this, AutoscaleConfig::from_json(manager_config["autoscale"], max_workers));
+            autoscaler->start();
+        }
+    }
 }
 
-/*
-// Function to start worker processes
+bool WorkerManager::isScalable() const {
+    return processingtype == "thread" && !worker_pool && isConcurrentScheduling() && hp_reserved_workers == 0;
+}
+
+// The token rotation and the hp reserved workers depend on a fixed number of workers:
+// only the concurrent workers are scaled. A retired worker finishes its current message.
+int WorkerManager::scale_workers(int num_threads) {
+    if (!isScalable()) {
+        logger->warning("The workers can be scaled only with concurrent scheduling and no hp reserved workers", globalname);
+        return num_workers;
+    }
+    num_threads = std::max(1, std::min(num_threads, max_workers));
+
+    std::vector<std::pair<std::shared_ptr<WorkerThread>, uint64_t>> retired;    // With their busy time when retired
+    {
+        std::lock_guard<std::mutex> lock(workers_mutex);
+
+        while (static_cast<int>(worker_threads.size()) < num_threads) {
+            WorkerBase* worker = create_worker();
+            if (!worker) {
+                logger->warning("No worker class for the workers of " + name + " (set worker_class or override create_worker)", globalname);
+                break;
+            }
+            auto thread = std::make_shared<WorkerThread>(static_cast<int>(worker_threads.size()), this, workersname, worker);
+            if (!worker_configuration.is_null()) {
+                thread->config(worker_configuration);
+            }
+            thread->set_processdata(processdata);
+            worker_threads.push_back(thread);
+        }
+
+        // The busy time moves to retired_busy_ns with the thread, so that getWorkersBusyTime() never decreases
+        while (static_cast<int>(worker_threads.size()) > num_threads) {
+            uint64_t busy = worker_threads.back()->getBusyTime();
+            retired_busy_ns += busy;
+            retired.emplace_back(worker_threads.back(), busy);
+            worker_threads.pop_back();
+        }
+
+        num_workers = static_cast<int>(worker_threads.size());
+    }
+
+    // Stopped in the background, a worker can take some time to finish its message and the caller
+    // (the command or the autoscaler thread) must not wait for it
+    if (!retired.empty()) {
+        auto retire = [this](std::vector<std::pair<std::shared_ptr<WorkerThread>, uint64_t>> threads) {
+            for (auto& [thread, retired_busy] : threads) {
+                thread->stop();
+                std::lock_guard<std::mutex> lock(workers_mutex);
+                // The message finished after the thread was retired
+                retired_busy_ns += thread->getBusyTime() - retired_busy;
+                // The id may already belong to a worker added since
+                if (thread->getWorkerId() >= static_cast<int>(worker_threads.size())) {
+                    setWorkerStatus(thread->getWorkerId(), 16);
+                    setProcessingRate(thread->getWorkerId(), 0.0);
+                }
+            }
+        };
+
+        std::lock_guard<std::mutex> lock(workers_mutex);
+        retiring_workers.erase(std::remove_if(retiring_workers.begin(), retiring_workers.end(), [](const std::future<void>& stop) {
+            return stop.wait_for(std::chrono::seconds(0)) == std::future_status::ready;
+        }), retiring_workers.end());
+        retiring_workers.push_back(std::async(std::launch::async, retire, std::move(retired)));
+    }
+
+    logger->info(fmt::format("Workers scaled to {}", num_workers.load()), globalname);
+    return num_workers;
+}
+
+uint64_t WorkerManager::getWorkersBusyTime() {
+    std::lock_guard<std::mutex> lock(workers_mutex);
+    uint64_t busy = retired_busy_ns;
+    for (const auto& thread : worker_threads) {
+        busy += thread->getBusyTime();
+    }
+    return busy;
+}
+
+Autoscaler* WorkerManager::getAutoscaler() const {
+    return autoscaler.get();
+}
+
+DynamicBatcher* WorkerManager::getBatcher() const {
+    return batcher.get();
+}
+
+// Worker instance selected with "worker_class" in the manager configuration (see WorkerRegistry)
+WorkerBase* WorkerManager::create_worker() {
+    std::string worker_class = manager_config.value("worker_class", std::string());
+    if (worker_class.empty()) {
+        return nullptr;
+    }
+
+    WorkerBase* worker = WorkerRegistry::create(worker_class);
+    if (!worker) {
+        logger->error("Worker class " + worker_class + " is not registered", globalname);
+    }
+    return worker;
+}
+
+int WorkerManager::getNumWorkers() const {
+    return num_workers;
+}
+
+// Function to start worker processes.
+// Each WorkerProcess forks a single-threaded zygote when it is created, and the zygote forks the child
+// running the worker (and its restarts), fed through shared memory rings. The Supervisor and the
+// monitoring threads of the managers are already running then: none of their threads is copied in a child.
 void WorkerManager::start_worker_processes(int num_processes) {
     if (num_processes > max_workers) {
         // spdlog::warn("WARNING! It is not possible to create more than {} processes", max_workers);
         logger->warning(fmt::format("WARNING! It is not possible to create more than {} processes", max_workers), globalname);
+        num_processes = max_workers;
     }
-    num_workers = num_processes;    
+    num_workers = num_processes;
+    worker_status_shared = std::vector<std::atomic<int>>(num_processes);
+    processing_rates_shared = std::vector<std::atomic<double>>(num_processes);
+    total_processed_data_count_shared = std::vector<std::atomic<int>>(num_processes);
+
+    for (int worker_id = 0; worker_id < num_processes; worker_id++) {
+        WorkerBase* worker = create_worker();
+        if (!worker) {
+            logger->warning("No worker class for the workers of " + name + " (set worker_class or override create_worker)", globalname);
+            return;
+        }
+        try {
+            worker_processes.push_back(std::make_shared<WorkerProcess>(worker_id, this, workersname, worker));
+        }
+        catch (const std::runtime_error& e) {
+            delete worker;
+            logger->error(fmt::format("Cannot start worker process {}: {}", worker_id, e.what()), globalname);
+            return;
+        }
+    }
+
+    logger->info(fmt::format("Started {} worker processes", num_processes), globalname);
 }
-*/
 
 void WorkerManager::start() {
     // Start the thread with the run() method
@@ -275,7 +915,9 @@ void WorkerManager::run() {
             workersstatusinit = 0;
             int worker_id = 0;
 
-            for (auto& thread : worker_threads) {
+            // Copy taken under the lock, scale_workers can change the workers meanwhile
+            auto threads = getWorkerThreads();
+            for (auto& thread : threads) {
                 if (thread->get_status() == 0) {
                     workersstatusinit++;
                 } 
@@ -284,8 +926,8 @@ void WorkerManager::run() {
                 }
             }
 
-            if (num_workers != workersstatusinit) {
-                workersstatus = workersstatus / (num_workers - workersstatusinit);
+            if (static_cast<int>(threads.size()) != workersstatusinit) {
+                workersstatus = workersstatus / (static_cast<int>(threads.size()) - workersstatusinit);
             }
         }
     } 
@@ -305,6 +947,10 @@ void WorkerManager::clean_queue() {
     clean_single_queue(result_lp_queue, "result_lp_queue");
     clean_single_queue(result_hp_queue, "result_hp_queue");
 
+    // The dropped sequences will never complete, restart from the next ingest sequence
+    reorder_lp->reset(supervisor->get_next_sequence(true));
+    reorder_hp->reset(supervisor->get_next_sequence(false));
+
     logger->info("End cleaning queues", globalname);
 }
 
@@ -317,16 +963,44 @@ void WorkerManager::stop(bool fast) {
     high_priority_queue->notify_all();
     result_lp_queue->notify_all();
     result_hp_queue->notify_all();
+    // The signal of the worker pool is stopped by the pool
+    if (!worker_pool) {
+        work_signal->stop();
+        hp_signal->stop();
+    }
+    result_signal->stop();
 
     if (worker_thread.joinable()) {
         worker_thread.join();
     }
 
-    for (auto& t : worker_threads) {
+    if (autoscaler) {
+        autoscaler->stop();
+    }
+
+    for (auto& t : getWorkerThreads()) {
         if (t) {
             t->stop();
         }
     }
+    std::vector<std::future<void>> retiring;
+    {
+        std::lock_guard<std::mutex> lock(workers_mutex);
+        retiring.swap(retiring_workers);
+    }
+    for (auto& stop : retiring) {
+        stop.wait();
+    }
+    for (auto& p : worker_processes) {
+        if (p) {
+            p->stop();
+        }
+    }
+
+    // After the workers, no more submits: the pending events are skipped
+    if (batcher) {
+        batcher->stop();
+    }
 
     // _stop_event = true;
     stop_internalthreads();
@@ -349,13 +1023,21 @@ void WorkerManager::stop_internalthreads() {
 // Function to configure workers
 void WorkerManager::configworkers(const json& configuration) {
     if (processingtype == "thread") {
+        std::lock_guard<std::mutex> lock(workers_mutex);
+        worker_configuration = configuration;
+        worker_configuration_generation++;  // Applied by the pool threads before their next message (executor pool)
         for (auto& worker : worker_threads) {
             worker->config(configuration);
         }
     }
+    else if (processingtype == "process") {
+        for (auto& worker : worker_processes) {
+            worker->config(configuration);
+        }
+    }
 }
 
-void WorkerManager::clean_single_queue(std::shared_ptr<ThreadSafeQueue<std::vector<uint8_t>>>& queue, const std::string& queue_name) {
+void WorkerManager::clean_single_queue(std::shared_ptr<MessageQueue<DataMessage>>& queue, const std::string& queue_name) {
     if (!queue->empty()) {
         logger->info(fmt::format("   - {} size {}", queue_name, queue->size()), globalname);
 
@@ -0,0 +1,441 @@
+// Copyright (C) 2024 INAF
+// This software is distributed under the terms of the BSD-3-Clause license
+//
+// Authors:
+//
+//    Andrea Bulgarelli <andrea.bulgarelli@inaf.it>
+//
+
+#include <rtadp/WorkerPool.h>
+#include <rtadp/WorkerManager.h>
+#include <rtadp/Supervisor.h>
+#include <algorithm>
+#include <numeric>
+#include <stdexcept>
+
+namespace {
+// Pass increment of a member with weight 1
+constexpr uint64_t STRIDE_UNIT = 1 << 20;
+}
+
+// State of a pool thread, used only by that thread
+struct WorkerPool::ThreadState {
+    int index;
+    std::vector<WorkerBase*> workers;       // Worker of each member, created on first use
+    std::vector<uint64_t> configured;       // Configuration generation applied to each worker
+
+    // Stride scheduling: the member with the lowest pass is served first, every message taken
+    // advances its pass by its stride. A member idle for a while restarts from the current virtual
+    // time instead of using the credit accumulated while idle.
+    std::vector<uint64_t> pass;
+    std::vector<size_t> order;
+    uint64_t virtual_time = 0;
+
+    std::vector<DataMessage> batch;
+    std::vector<DataMessage> results;
+};
+
+WorkerPool::WorkerPool(const nlohmann::json& configuration, WorkerLogger* logger, const std::string& name)
+    : logger(logger), globalname("WorkerPool-" + name) {
+
+    num_threads = configuration.value("threads", 0);
+    if (num_threads <= 0) {
+        num_threads = std::max(1u, std::thread::hardware_concurrency());
+    }
+
+    scratch_bytes = configuration.value("scratch_bytes", WorkerContext::DEFAULT_SCRATCH_BYTES);
+    grab_messages = std::max(static_cast<size_t>(1), configuration.value("grab_messages", static_cast<size_t>(16)));
+
+    // The pool threads take the data of any manager: one pushed message wakes one thread
+    signal = std::make_shared<WorkSignal>();
+
+    std::string wait_strategy_name = configuration.value("wait_strategy", std::string("blocking"));
+    try {
+        wait_strategy = WaitStrategy::create(wait_strategy_name, configuration);
+    }
+    catch (const std::invalid_argument& e) {
+        logger->warning("Unknown wait_strategy " + wait_strategy_name + ", using blocking", globalname);
+        wait_strategy = std::make_shared<BlockingWaitStrategy>();
+    }
+
+    logger->info(fmt::format("Worker pool: {} threads, grab {} messages, wait strategy {}", num_threads, grab_messages,
+        wait_strategy->getName()), globalname);
+}
+
+WorkerPool::~WorkerPool() {
+    stop();
+}
+
+std::shared_ptr<WorkSignal> WorkerPool::getSignal() const {
+    return signal;
+}
+
+void WorkerPool::add_manager(WorkerManager* manager, int weight) {
+    if (!threads.empty()) {
+        logger->error("Manager " + manager->getName() + " added to a running worker pool, ignored", globalname);
+        return;
+    }
+
+    auto member = std::make_unique<Member>();
+    member->manager = manager;
+    member->weight = std::max(1, weight);
+    member->stride = STRIDE_UNIT / member->weight;
+    member->batch_size = manager->getBatchSize();
+    members.push_back(std::move(member));
+
+    logger->info(fmt::format("Manager {} added with weight {}, batch size {}", manager->getName(), std::max(1, weight),
+        manager->getBatchSize()), globalname);
+    if (manager->getBatchSize() > 1 && manager->getBatchWait().count() > 0) {
+        logger->warning(fmt::format("Manager {}: the pool threads do not wait for a batch to fill, batch_wait_us ignored",
+            manager->getName()), globalname);
+    }
+}
+
+void WorkerPool::start() {
+    if (members.empty() || !threads.empty()) {
+        return;
+    }
+
+    // The results are stored in the buffer pool of the Supervisor of the members
+    auto buffer_pool = members.front()->manager->getSupervisor()->getBufferPool();
+    for (int thread_index = 0; thread_index < num_threads; thread_index++) {
+        contexts.push_back(std::make_unique<WorkerContext>(thread_index, scratch_bytes, buffer_pool));
+        local_queues.push_back(std::make_unique<LocalQueue>());
+    }
+
+    for (int thread_index = 0; thread_index < num_threads; thread_index++) {
+        threads.emplace_back(&WorkerPool::run, this, thread_index);
+    }
+    logger->info(fmt::format("Started {} pool threads for {} managers", num_threads, members.size()), globalname);
+}
+
+void WorkerPool::stop() {
+    if (stop_event.exchange(true)) {
+        return;
+    }
+
+    signal->stop();
+    for (auto& thread : threads) {
+        if (thread.joinable()) {
+            thread.join();
+        }
+    }
+
+    // The messages left in the deques will never produce a result
+    for (auto& local : local_queues) {
+        for (int priority = 0; priority < 2; priority++) {
+            for (const auto& task : local->tasks[priority]) {
+                members[task.member]->manager->skip_result(task.data.sequence(), priority);
+            }
+            local->tasks[priority].clear();
+        }
+        local->size = 0;
+    }
+}
+
+void WorkerPool::run(int thread_index) {
+    const auto idle_timeout = std::chrono::milliseconds(100);   // Upper bound to check stop_event
+
+    ThreadState state;
+    state.index = thread_index;
+    state.workers.assign(members.size(), nullptr);
+    state.configured.assign(members.size(), 0);
+    state.pass.assign(members.size(), 0);
+    state.order.resize(members.size());
+
+    while (!stop_event) {
+        // The ticket is taken before checking the queues, so a push after the check wakes the thread
+        uint64_t ticket = signal->prepare_wait();
+
+        // Own deque, then the queues of the managers, then the deques of the other threads
+        bool processed = false;
+        for (int priority = 1; priority >= 0 && !processed; priority--) {
+            processed = run_local(state, priority) ||
+                        (grab(state, priority) && run_local(state, priority)) ||
+                        (steal(state, priority) && run_local(state, priority));
+        }
+
+        if (!processed) {
+            wait_strategy->wait(*signal, ticket, idle_timeout);
+        }
+    }
+
+    for (auto* worker : state.workers) {
+        delete worker;
+    }
+}
+
+bool WorkerPool::run_local(ThreadState& state, int priority) {
+    LocalQueue& local = *local_queues[state.index];
+    size_t index;
+    {
+        std::lock_guard<std::mutex> lock(local.mtx);
+        auto& tasks = local.tasks[priority];
+        if (tasks.empty()) {
+            return false;
+        }
+
+        // A batch is made of the consecutive messages of the same member
+        index = tasks.front().member;
+        size_t batch_size = members[index]->batch_size;
+        while (!tasks.empty() && tasks.front().member == index && state.batch.size() < batch_size) {
+            state.batch.push_back(std::move(tasks.front().data));
+            tasks.pop_front();
+        }
+        local.size -= state.batch.size();
+    }
+
+    Member& member = *members[index];
+    WorkerBase* worker = prepare_worker(state, index);
+    WorkerContext& context = *contexts[state.index];
+
+    busy_threads++;
+    if (member.batch_size > 1) {
+        process_batch(member, worker, context, state.batch, priority, state.results);
+    }
+    else {
+        process_data(member, worker, context, state.batch.front(), priority);
+    }
+    busy_threads--;
+
+    state.batch.clear();
+    state.results.clear();
+    return true;
+}
+
+bool WorkerPool::grab(ThreadState& state, int priority) {
+    // Ties are broken from a different member for each thread, so the threads spread over the queues
+    size_t count = members.size();
+    std::iota(state.order.begin(), state.order.end(), 0);
+    std::sort(state.order.begin(), state.order.end(), [&](size_t a, size_t b) {
+        if (state.pass[a] != state.pass[b]) {
+            return state.pass[a] < state.pass[b];
+        }
+        return (a + count - state.index % count) % count < (b + count - state.index % count) % count;
+    });
+
+    LocalQueue& local = *local_queues[state.index];
+    for (size_t index : state.order) {
+        Member& member = *members[index];
+        WorkerManager* manager = member.manager;
+        if (manager->getProcessData() != 1) {
+            continue;
+        }
+
+        auto queue = priority == 1 ? manager->getHighPriorityQueue() : manager->getLowPriorityQueue();
+        size_t limit = std::max(grab_messages, member.batch_size);
+        size_t taken = 0;
+        DataMessage data;
+        {
+            std::lock_guard<std::mutex> lock(local.mtx);
+            while (taken < limit && queue->try_pop(data)) {
+                local.tasks[priority].push_back(Task{index, std::move(data)});
+                taken++;
+            }
+            local.size += taken;
+        }
+        if (taken == 0) {
+            continue;
+        }
+
+        state.virtual_time = std::max(state.pass[index], state.virtual_time);
+        state.pass[index] = state.virtual_time + member.stride * taken;
+
+        // The idle threads can steal what this thread will not process next
+        if (taken > member.batch_size) {
+            signal->notify(taken - member.batch_size);
+        }
+        return true;
+    }
+    return false;
+}
+
+bool WorkerPool::steal(ThreadState& state, int priority) {
+    std::vector<Task> loot;
+    for (int offset = 1; offset < num_threads && loot.empty(); offset++) {
+        LocalQueue& victim = *local_queues[(state.index + offset) % num_threads];
+        if (victim.size == 0) {
+            continue;
+        }
+
+        // Half of the messages of the victim, from the back: the victim keeps the ones it takes next
+        std::lock_guard<std::mutex> lock(victim.mtx);
+        auto& tasks = victim.tasks[priority];
+        size_t count = (tasks.size() + 1) / 2;
+        for (auto it = tasks.end() - count; it != tasks.end(); ++it) {
+            loot.push_back(std::move(*it));
+        }
+        tasks.erase(tasks.end() - count, tasks.end());
+        victim.size -= count;
+    }
+    if (loot.empty()) {
+        return false;
+    }
+
+    stolen += loot.size();
+    LocalQueue& local = *local_queues[state.index];
+    std::lock_guard<std::mutex> lock(local.mtx);
+    for (auto& task : loot) {
+        local.tasks[priority].push_back(std::move(task));
+    }
+    local.size += loot.size();
+    return true;
+}
+
+WorkerBase* WorkerPool::prepare_worker(ThreadState& state, size_t index) {
+    WorkerManager* manager = members[index]->manager;
+    WorkerBase*& worker = state.workers[index];
+    if (!worker) {
+        worker = manager->create_worker();
+        if (worker) {
+            std::string workersname = manager->getFullname() + "-" + manager->getWorkersName();
+            worker->init(manager, manager->getSupervisor(), workersname, workersname + "-pool-" + std::to_string(state.index));
+        }
+    }
+
+    // The configuration received by the manager (configworkers) since the last message of this thread
+    uint64_t generation = manager->getWorkerConfigurationGeneration();
+    if (worker && state.configured[index] != generation) {
+        state.configured[index] = generation;
+        try {
+            worker->config(manager->getWorkerConfiguration());
+        }
+        catch (const std::exception& e) {
+            logger->error(fmt::format("Configuration of the worker of {} failed: {}", manager->getName(), e.what()), globalname);
+        }
+    }
+    return worker;
+}
+
+void WorkerPool::process_data(Member& member, WorkerBase* worker, WorkerContext& context, const DataMessage& data, int priority) {
+    WorkerManager* manager = member.manager;
+    if (!manager->check_data_age(data, priority)) {
+        return;     // Expired
+    }
+
+    member.processed++;
+
+    OutputBuffer& output = context.output();
+    output.clear();
+    if (worker) {
+        try {
+            worker->processData(data, priority, output, context);
+        }
+        catch (const std::exception& e) {
+            logger->critical(e.what(), globalname);
+            output.clear();
+        }
+        context.reset();
+        if (worker->take_result_deferred()) {
+            output.clear();
+            return;     // Result delivered by the worker (e.g. through the batcher)
+        }
+    }
+
+    if (!output.empty()) {
+        DataMessage result = output.take();
+        result.set_sequence(data.sequence());
+        result.set_ingest_time(data.ingest_time());   // Age measured from the first ingest along a pipeline
+        manager->push_result(std::move(result), priority);
+    }
+    else {
+        manager->skip_result(data.sequence(), priority);
+    }
+}
+
+void WorkerPool::process_batch(Member& member, WorkerBase* worker, WorkerContext& context, std::vector<DataMessage>& batch,
+                               int priority, std::vector<DataMessage>& results) {
+    WorkerManager* manager = member.manager;
+
+    // The expired data is skipped before the batch is passed to the worker
+    size_t kept = 0;
+    for (size_t i = 0; i < batch.size(); i++) {
+        if (manager->check_data_age(batch[i], priority)) {
+            if (kept != i) {
+                batch[kept] = std::move(batch[i]);
+            }
+            kept++;
+        }
+    }
+    batch.erase(batch.begin() + kept, batch.end());
+    if (batch.empty()) {
+        return;
+    }
+
+    member.processed += batch.size();
+
+    results.clear();
+    if (worker) {
+        try {
+            worker->processBatch(batch, priority, results, context);
+        }
+        catch (const std::exception& e) {
+            logger->critical(e.what(), globalname);
+            results.clear();
+        }
+        context.reset();
+        if (worker->take_result_deferred()) {
+            results.clear();
+            context.output().clear();
+            return;     // Results delivered by the worker (e.g. through the batcher)
+        }
+    }
+
+    for (size_t i = 0; i < batch.size(); i++) {
+        if (i < results.size() && results[i].total_size() > 0) {
+            DataMessage result = std::move(results[i]);
+            result.set_sequence(batch[i].sequence());
+            result.set_ingest_time(batch[i].ingest_time());
+            manager->push_result(std::move(result), priority);
+        }
+        else {
+            manager->skip_result(batch[i].sequence(), priority);
+        }
+    }
+}
+
+int WorkerPool::getNumThreads() const {
+    return num_threads;
+}
+
+int WorkerPool::getBusyThreads() const {
+    return busy_threads;
+}
+
+uint64_t WorkerPool::getStolenCount() const {
+    return stolen;
+}
+
+size_t WorkerPool::getLocalQueuedCount() const {
+    size_t count = 0;
+    for (const auto& local : local_queues) {
+        count += local->size;
+    }
+    return count;
+}
+
+size_t WorkerPool::getScratchHighWater() const {
+    size_t high_water = 0;
+    for (const auto& context : contexts) {
+        high_water = std::max(high_water, context->scratch().getHighWater());
+    }
+    return high_water;
+}
+
+uint64_t WorkerPool::getProcessedCount(const WorkerManager* manager) const {
+    for (const auto& member : members) {
+        if (member->manager == manager) {
+            return member->processed;
+        }
+    }
+    return 0;
+}
+
+int WorkerPool::getWeight(const WorkerManager* manager) const {
+    for (const auto& member : members) {
+        if (member->manager == manager) {
+            return member->weight;
+        }
+    }
+    return 0;
+}
@@ -1,131 +1,782 @@
+// Copyright (C) 2024 INAF
+// This software is distributed under the terms of the BSD-3-Clause license
+//
+// Authors:
+//
+//    Andrea Bulgarelli <andrea.bulgarelli@inaf.it>
+//
+
 #include <rtadp/WorkerProcess.h>
+#include <rtadp/WorkerManager.h>
+#include <rtadp/Supervisor.h>
+#include <algorithm>
+#include <csignal>
+#include <cstdlib>
+#include <cstring>
+#include <cerrno>
+#include <iostream>
+#include <new>
 #include <stdexcept>
-#include <unistd.h> // for sleep
+#include <dirent.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <sys/mman.h>
+#include <sys/prctl.h>
+#include <sys/signalfd.h>
+#include <sys/wait.h>
+
+// Control block at the start of the shared memory
+struct WorkerProcess::ControlBlock {
+    std::atomic<int> status;            // Set by the child: 2 waiting for new data, 8 processing
+    std::atomic<int> stop;              // Set by the parent to terminate the child
+    std::atomic<uint64_t> processed;    // Messages processed by the children of this worker
+    std::atomic<uint64_t> scratch_high_water;   // Largest scratch arena usage of the children
+};
+
+// Event written by the zygote in the event pipe (smaller than PIPE_BUF, so written atomically)
+struct WorkerProcess::ZygoteEvent {
+    int32_t type;       // ZYGOTE_SPAWNED or ZYGOTE_EXITED
+    int32_t pid;        // Child pid, -errno if the fork failed
+    int32_t wstatus;    // Exit status of the child (waitpid)
+};
+
+namespace {
+constexpr int32_t ZYGOTE_SPAWNED = 1;
+constexpr int32_t ZYGOTE_EXITED = 2;
+constexpr char ZYGOTE_SPAWN = 'S';
+constexpr char ZYGOTE_QUIT = 'Q';
+
+const auto ring_timeout = std::chrono::milliseconds(100);   // Upper bound to check the stop flags
+
+// Close the descriptors inherited from the Supervisor (sockets, files, pipes of the other zygotes),
+// except the standard ones and keep: a pipe of another worker held open here would never see its EOF
+void close_inherited_fds(int keep1, int keep2) {
+    DIR* dir = opendir("/proc/self/fd");
+    if (!dir) {
+        return;
+    }
+    std::vector<int> fds;
+    while (struct dirent* entry = readdir(dir)) {
+        int fd = std::atoi(entry->d_name);
+        if (fd > 2 && fd != keep1 && fd != keep2 && fd != dirfd(dir)) {
+            fds.push_back(fd);
+        }
+    }
+    closedir(dir);
+    for (int fd : fds) {
+        close(fd);
+    }
+}
+
+size_t align_cache_line(size_t size) {
+    return (size + CACHE_LINE_SIZE - 1) & ~(CACHE_LINE_SIZE - 1);
+}
+
+int64_t to_ns(std::chrono::steady_clock::time_point time) {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(time.time_since_epoch()).count();
+}
+
+std::chrono::steady_clock::time_point from_ns(int64_t ns) {
+    return std::chrono::steady_clock::time_point(
+        std::chrono::duration_cast<std::chrono::steady_clock::duration>(std::chrono::nanoseconds(ns)));
+}
+}
 
-WorkerProcess::WorkerProcess(int worker_id, std::shared_ptr<WorkerManager> manager, const std::string& name, std::shared_ptr<WorkerBase> worker)
+WorkerProcess::WorkerProcess(int worker_id, WorkerManager* manager, const std::string& name, WorkerBase* worker)
     : worker_id(worker_id), manager(manager), supervisor(manager->getSupervisor()), worker(worker), name(name),
-      workersname(supervisor->getName() + "-" + manager->getName() + "-" + name),
-      fullname(workersname + "-" + std::to_string(worker_id)),
-      globalname("WorkerProcess-" + fullname), stop_event(false) {
+      shared_memory(nullptr), shared_size(0), control(nullptr),
+      zygote_pid(-1), zygote_request_fd(-1), zygote_event_fd(-1), pidprocess(-1), child_alive(false),
+      restart_count(0), stop_event(false), processdata(0), status(0),
+      processing_rate(0.0), total_processed_data_count(0) {
 
-    pidprocess = getpid();
-    logger = supervisor->getLogger();
-    worker->init(manager.get(), supervisor.get(), workersname, fullname);
+    workersname = supervisor->name + "-" + manager->getName() + "-" + name;
+    fullname = workersname + "-" + std::to_string(worker_id);
+    globalname = "WorkerProcess-" + fullname;
+    logger = supervisor->logger;
 
-    low_priority_queue = manager->getLowPriorityQueue();
-    high_priority_queue = manager->getHighPriorityQueue();
-    monitoringpoint = manager->getMonitoringPoint();
+    worker->init(manager, supervisor, workersname, fullname);
 
-    start_time = std::chrono::system_clock::now().time_since_epoch().count();
-    next_time = start_time;
-    processed_data_count = 0;
-    total_processed_data_count = 0;
-    processing_rate = 0;
+    work_signal = manager->getWorkSignal();
+    wait_strategy = manager->getWaitStrategy();
 
-    manager->setWorkerStatus(worker_id, 0); // initialized
+    // Size of each ring: the largest message is half of it
+    const nlohmann::json& manager_config = manager->getManagerConfig();
+    ring_bytes = manager_config.value("process_ring_bytes", static_cast<size_t>(16 << 20));
+    prefetch = std::max(static_cast<size_t>(1), manager_config.value("process_prefetch", static_cast<size_t>(2)));
+    restart = manager_config.value("process_restart", true);
+    scratch_bytes = manager->getScratchBytes();
+
+    create_shared_memory();
+    reset_rings();
+
+    // Fork the zygote before starting the threads of this worker, the children are forked by the zygote
+    try {
+        start_zygote();
+    }
+    catch (const std::runtime_error&) {
+        input_ring.destroy();
+        result_ring.destroy();
+        munmap(shared_memory, shared_size);
+        shared_memory = nullptr;
+        throw;
+    }
+    if (!spawn()) {
+        status = 32;
+    }
 
+    feeder_thread = std::make_unique<std::thread>(&WorkerProcess::feed, this);
+    collector_thread = std::make_unique<std::thread>(&WorkerProcess::collect, this);
     start_timer(1);
-    std::cout << globalname << " started " << pidprocess << std::endl;
-    logger->info("WorkerProcess started", globalname);
+
+    logger->info(fmt::format("WorkerProcess started: ring {} bytes, prefetch {}, restart {}", ring_bytes, prefetch, restart), globalname);
 }
 
 WorkerProcess::~WorkerProcess() {
     stop();
+
+    input_ring.destroy();
+    result_ring.destroy();
+    if (shared_memory) {
+        munmap(shared_memory, shared_size);
+        shared_memory = nullptr;
+    }
+
+    if (worker) {
+        delete worker;
+        worker = nullptr;
+    }
+}
+
+// Anonymous shared mapping, inherited by the children across fork()
+void WorkerProcess::create_shared_memory() {
+    size_t ring_size = align_cache_line(ShmRing::required_size(ring_bytes));
+    shared_size = align_cache_line(sizeof(ControlBlock)) + 2 * ring_size;
+
+    shared_memory = mmap(nullptr, shared_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+    if (shared_memory == MAP_FAILED) {
+        shared_memory = nullptr;
+        throw std::runtime_error(std::string("Cannot map the worker process shared memory: ") + std::strerror(errno));
+    }
+
+    control = new (shared_memory) ControlBlock();
+    control->status = 0;
+    control->stop = 0;
+    control->processed = 0;
+    control->scratch_high_water = 0;
+}
+
+// Create empty rings, when no child is running
+void WorkerProcess::reset_rings() {
+    input_ring.destroy();
+    result_ring.destroy();
+
+    uint8_t* base = static_cast<uint8_t*>(shared_memory) + align_cache_line(sizeof(ControlBlock));
+    size_t ring_size = align_cache_line(ShmRing::required_size(ring_bytes));
+    input_ring = ShmRing::create(base, ring_bytes);
+    result_ring = ShmRing::create(base + ring_size, ring_bytes);
+}
+
+void WorkerProcess::start_zygote() {
+    int request_pipe[2];
+    int event_pipe[2];
+    if (pipe2(request_pipe, O_CLOEXEC) != 0) {
+        throw std::runtime_error(std::string("Cannot create the zygote pipes: ") + std::strerror(errno));
+    }
+    if (pipe2(event_pipe, O_CLOEXEC) != 0) {
+        int err = errno;
+        close(request_pipe[0]);
+        close(request_pipe[1]);
+        throw std::runtime_error(std::string("Cannot create the zygote pipes: ") + std::strerror(err));
+    }
+
+    pid_t supervisor_pid = getpid();
+    pid_t pid = fork();
+    if (pid < 0) {
+        int err = errno;
+        close(request_pipe[0]);
+        close(request_pipe[1]);
+        close(event_pipe[0]);
+        close(event_pipe[1]);
+        throw std::runtime_error(std::string("Cannot fork the zygote process: ") + std::strerror(err));
+    }
+    if (pid == 0) {
+        zygote_main(supervisor_pid, request_pipe[0], event_pipe[1]);
+    }
+
+    close(request_pipe[0]);
+    close(event_pipe[1]);
+    zygote_pid = pid;
+    zygote_request_fd = request_pipe[1];
+    zygote_event_fd = event_pipe[0];
+    logger->info(fmt::format("Zygote process {} started", pid), globalname);
+}
+
+// Only the thread calling fork() exists in the zygote: it forks the children and reaps them, nothing else.
+// The exit of the Supervisor is detected with getppid(): PR_SET_PDEATHSIG would fire when the thread
+// that forked the zygote exits, not the Supervisor.
+void WorkerProcess::zygote_main(pid_t supervisor_pid, int request_fd, int event_fd) {
+    std::signal(SIGINT, SIG_IGN);       // The parent stops the zygote through the request pipe
+    std::signal(SIGTERM, SIG_DFL);
+    close_inherited_fds(request_fd, event_fd);
+
+    // SIGCHLD is read from a descriptor, polled with the requests
+    sigset_t sigchld;
+    sigemptyset(&sigchld);
+    sigaddset(&sigchld, SIGCHLD);
+    sigset_t previous_mask;
+    sigprocmask(SIG_BLOCK, &sigchld, &previous_mask);
+    int signal_fd = signalfd(-1, &sigchld, SFD_CLOEXEC | SFD_NONBLOCK);
+
+    pid_t child = -1;
+    bool quit = false;
+
+    auto send_event = [&](int32_t type, int32_t pid, int32_t wstatus) {
+        ZygoteEvent event{type, pid, wstatus};
+        ssize_t written = write(event_fd, &event, sizeof(event));
+        (void)written;
+    };
+
+    while (true) {
+        if (getppid() != supervisor_pid) {
+            quit = true;    // The Supervisor is gone
+        }
+
+        int wstatus;
+        if (child > 0 && waitpid(child, &wstatus, WNOHANG) == child) {
+            send_event(ZYGOTE_EXITED, child, wstatus);
+            child = -1;
+        }
+
+        if (quit) {
+            if (child > 0) {
+                kill(child, SIGKILL);
+                waitpid(child, &wstatus, 0);
+                send_event(ZYGOTE_EXITED, child, wstatus);
+            }
+            _exit(0);
+        }
+
+        struct pollfd fds[2] = {{request_fd, POLLIN, 0}, {signal_fd, POLLIN, 0}};
+        if (poll(fds, signal_fd >= 0 ? 2 : 1, 100) <= 0) {
+            continue;
+        }
+
+        if (signal_fd >= 0 && (fds[1].revents & POLLIN)) {
+            struct signalfd_siginfo info;
+            while (read(signal_fd, &info, sizeof(info)) == sizeof(info)) {
+            }
+        }
+
+        if (fds[0].revents & (POLLIN | POLLHUP)) {
+            char request;
+            ssize_t count = read(request_fd, &request, 1);
+            if (count <= 0 || request == ZYGOTE_QUIT) {
+                quit = true;
+            }
+            else if (request == ZYGOTE_SPAWN) {
+                if (child > 0) {
+                    send_event(ZYGOTE_SPAWNED, -EBUSY, 0);
+                    continue;
+                }
+                pid_t zygote = getpid();
+                pid_t pid = fork();
+                if (pid == 0) {
+                    if (signal_fd >= 0) {
+                        close(signal_fd);
+                    }
+                    close(request_fd);
+                    close(event_fd);
+                    sigprocmask(SIG_SETMASK, &previous_mask, nullptr);
+                    child_main(zygote);
+                }
+                send_event(ZYGOTE_SPAWNED, pid > 0 ? pid : -errno, 0);
+                if (pid > 0) {
+                    child = pid;
+                }
+            }
+        }
+    }
+}
+
+bool WorkerProcess::read_event(ZygoteEvent& event, int timeout_ms) {
+    if (zygote_event_fd < 0) {
+        return false;
+    }
+    struct pollfd fd = {zygote_event_fd, POLLIN, 0};
+    if (poll(&fd, 1, timeout_ms) <= 0 || !(fd.revents & POLLIN)) {
+        return false;
+    }
+    return read(zygote_event_fd, &event, sizeof(event)) == static_cast<ssize_t>(sizeof(event));
+}
+
+bool WorkerProcess::wait_child_exit(pid_t pid, std::chrono::milliseconds timeout) {
+    auto deadline = std::chrono::steady_clock::now() + timeout;
+    ZygoteEvent event;
+    while (true) {
+        auto remaining = std::chrono::duration_cast<std::chrono::milliseconds>(deadline - std::chrono::steady_clock::now());
+        if (remaining.count() <= 0) {
+            return false;
+        }
+        if (read_event(event, static_cast<int>(remaining.count())) && event.type == ZYGOTE_EXITED && event.pid == pid) {
+            return true;
+        }
+    }
+}
+
+void WorkerProcess::stop_zygote() {
+    if (zygote_request_fd >= 0) {
+        char request = ZYGOTE_QUIT;
+        ssize_t written = write(zygote_request_fd, &request, 1);
+        (void)written;
+        close(zygote_request_fd);
+        zygote_request_fd = -1;
+    }
+
+    if (zygote_pid > 0) {
+        int wstatus;
+        bool exited = false;
+        for (int i = 0; i < 100 && !exited; i++) {
+            exited = waitpid(zygote_pid, &wstatus, WNOHANG) == zygote_pid;
+            if (!exited) {
+                std::this_thread::sleep_for(std::chrono::milliseconds(10));
+            }
+        }
+        if (!exited) {
+            logger->warning(fmt::format("Zygote process {} does not stop, killed", zygote_pid), globalname);
+            kill(zygote_pid, SIGKILL);
+            waitpid(zygote_pid, &wstatus, 0);
+        }
+        zygote_pid = -1;
+    }
+
+    if (zygote_event_fd >= 0) {
+        close(zygote_event_fd);
+        zygote_event_fd = -1;
+    }
+}
+
+bool WorkerProcess::spawn() {
+    if (zygote_pid <= 0) {
+        logger->error("Cannot start the worker process: the zygote is not running", globalname);
+        return false;
+    }
+
+    control->stop = 0;
+    control->status = 0;
+
+    char request = ZYGOTE_SPAWN;
+    if (write(zygote_request_fd, &request, 1) != 1) {
+        logger->error(fmt::format("Cannot request a worker process to the zygote: {}", std::strerror(errno)), globalname);
+        return false;
+    }
+
+    // The previous child has been reported before the request: the next event is the answer
+    ZygoteEvent event;
+    auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(5);
+    while (!read_event(event, 100) || event.type != ZYGOTE_SPAWNED) {
+        if (std::chrono::steady_clock::now() > deadline) {
+            logger->error("The zygote did not start the worker process", globalname);
+            return false;
+        }
+    }
+    if (event.pid < 0) {
+        logger->error(fmt::format("Cannot fork the worker process: {}", std::strerror(-event.pid)), globalname);
+        return false;
+    }
+
+    pidprocess = event.pid;
+    child_alive = true;
+    logger->info(fmt::format("Child process {} started", event.pid), globalname);
+    return true;
+}
+
+// Forked by the single-threaded zygote: the loop uses the rings and the worker only
+void WorkerProcess::child_main(pid_t zygote_pid) {
+    // The zygote has a single thread, the signal is sent when the zygote exits
+    prctl(PR_SET_PDEATHSIG, SIGKILL);
+    if (getppid() != zygote_pid) {
+        _exit(0);   // The zygote exited before the prctl
+    }
+    std::signal(SIGINT, SIG_IGN);       // The parent stops the child through the control block
+    std::signal(SIGTERM, SIG_DFL);
+
+    // Created in the child, the parent does not pay for the arenas of its process workers.
+    // No buffer pool: its locks may have been held by other threads of the parent at fork time.
+    WorkerContext context(worker_id, scratch_bytes);
+
+    bool running = true;
+    while (running && !control->stop) {
+        control->status = 2; // waiting for new data
+
+        ShmRing::Record record;
+        if (!input_ring.peek(record, ring_timeout)) {
+            running = !input_ring.is_stopped() && getppid() == zygote_pid;
+            continue;
+        }
+
+        if (record.type == ShmRing::RECORD_CONFIG) {
+            try {
+                worker->config(nlohmann::json::parse(record.data, record.data + record.size));
+            }
+            catch (const std::exception& e) {
+                std::cerr << globalname << " configuration error: " << e.what() << std::endl;
+            }
+            input_ring.consume(record);
+            continue;
+        }
+
+        control->status = 8; // processing new data
+
+        int priority = static_cast<int>(record.priority);
+        uint64_t sequence = record.sequence;
+        int64_t ingest_ns = record.ingest_ns;
+
+        // The payload is processed in place. The ring slot is released after the result is written,
+        // the result can reference the input (OutputBuffer::append_part).
+        OutputBuffer& output = context.output();
+        output.clear();
+        try {
+            DataMessage data = DataMessage::from_shared(nullptr, record.data, record.size);
+            data.set_sequence(sequence);
+            data.set_ingest_time(from_ns(ingest_ns));
+            worker->processData(data, priority, output, context);
+        }
+        catch (const std::exception& e) {
+            std::cerr << globalname << " " << e.what() << std::endl;
+            output.clear();
+        }
+        context.reset();
+        if (context.scratch().getHighWater() > control->scratch_high_water) {
+            control->scratch_high_water = context.scratch().getHighWater();
+        }
+
+        // The result ring takes a single record: the parts are concatenated
+        DataMessage dataresult = output.take().flatten(nullptr);
+        if (dataresult.size() > result_ring.max_payload()) {
+            std::cerr << globalname << " result of " << dataresult.size() << " bytes larger than the ring, discarded" << std::endl;
+            dataresult = DataMessage();
+        }
+
+        // An empty result tells the parent that the sequence has no result
+        while (!result_ring.write(ShmRing::RECORD_DATA, priority, sequence, ingest_ns,
+                                  dataresult.data(), dataresult.size(), ring_timeout)) {
+            if (result_ring.is_stopped()) {
+                running = false;
+                break;
+            }
+        }
+        dataresult = DataMessage();
+        input_ring.consume(record);
+        control->processed++;
+    }
+
+    _exit(0);
 }
 
 void WorkerProcess::stop() {
-    stop_event = true;
+    if (stop_event.exchange(true)) {
+        return;
+    }
 
-    low_priority_queue->notify_all();
-    high_priority_queue->notify_all();
+    control->stop = 1;
+    input_ring.stop();
+    result_ring.stop();
+    slot_signal.stop();
 
+    if (feeder_thread && feeder_thread->joinable()) {
+        feeder_thread->join();
+    }
+    if (collector_thread && collector_thread->joinable()) {
+        collector_thread->join();
+    }
     if (timer_thread && timer_thread->joinable()) {
         timer_thread->join();
     }
 
-    sleep(0.1);
+    // Give the child one second to finish the current message, its exit is reported by the zygote
+    pid_t pid = pidprocess;
+    if (child_alive && pid > 0) {
+        if (!wait_child_exit(pid, std::chrono::seconds(1))) {
+            logger->warning(fmt::format("Child process {} does not stop, killed", pid), globalname);
+            kill(pid, SIGKILL);
+            wait_child_exit(pid, std::chrono::seconds(1));
+        }
+        child_alive = false;
+    }
+    stop_zygote();
+
+    status = 16; // stop
+    logger->info("WorkerProcess stop", globalname);
 }
 
+// Kept by the parent and sent again to a restarted child: the zygote has the worker as it was created
 void WorkerProcess::config(const nlohmann::json& configuration) {
-    worker->config(configuration);
+    std::string text = configuration.dump();
+    DataMessage message = DataMessage::from_vector(std::vector<uint8_t>(text.begin(), text.end()));
+    if (message.size() > input_ring.max_payload()) {
+        logger->error(fmt::format("Configuration of {} bytes larger than the ring", message.size()), globalname);
+        return;
+    }
+
+    std::lock_guard<std::mutex> lock(input_mutex);
+    last_configuration = std::move(text);
+    if (!write_input(ShmRing::RECORD_CONFIG, 0, message)) {
+        logger->warning("Configuration not sent, the child process is not running", globalname);
+    }
 }
 
-void WorkerProcess::run() {
-    start_timer(1);
+void WorkerProcess::set_processdata(int processdata1) {
+    processdata = processdata1;
+}
 
-    try {
-        while (!stop_event) {
-            usleep(100); // equivalent to time.sleep(0.0001)
-
-            if (manager->getProcessDataSharedValue() == 1) {
-                manager->setWorkerStatus(worker_id, 2); // assume queue empty
-
-                try {
-                    auto high_priority_data = high_priority_queue->get();
-                    process_data(high_priority_data, 1);
-                } 
-                catch (const std::out_of_range&) {
-                    try {
-                        auto low_priority_data = low_priority_queue->get();
-                        process_data(low_priority_data, 0);
-                    } 
-                    catch (const std::out_of_range&) {
-                        manager->setWorkerStatus(worker_id, 2); // waiting for new data
-                    }
-                }
-            }
+// Called with input_mutex held
+bool WorkerProcess::write_input(uint32_t type, int priority, const DataMessage& data) {
+    while (!stop_event && child_alive) {
+        if (input_ring.write(type, static_cast<uint32_t>(priority), data.sequence(), to_ns(data.ingest_time()),
+                             data.data(), data.size(), ring_timeout)) {
+            return true;
         }
-    } 
-    catch (const std::exception& e) {
-        std::cerr << "An error occurred: " << e.what() << std::endl;
     }
+    return false;
+}
 
-    stop();
-    manager->setWorkerStatus(worker_id, 16); // stop
-    std::cout << "WorkerProcess stop " << globalname << std::endl;
-    logger->info("WorkerProcess stop", globalname);
+void WorkerProcess::send_data(const DataMessage& data, int priority) {
+    if (!manager->check_data_age(data, priority)) {
+        return;     // Expired
+    }
+
+    if (data.size() > input_ring.max_payload()) {
+        logger->error(fmt::format("Message of {} bytes larger than the ring (process_ring_bytes), skipped", data.size()), globalname);
+        manager->skip_result(data.sequence(), priority);
+        return;
+    }
+
+    // The in-flight entry is added and, on failure, removed under input_mutex: check_child skips
+    // the in-flight sequences of a dead child under the same lock, so no sequence is skipped twice
+    std::lock_guard<std::mutex> lock(input_mutex);
+    {
+        std::lock_guard<std::mutex> inflight_lock(inflight_mutex);
+        inflight.emplace_back(data.sequence(), priority);
+    }
+
+    if (!write_input(ShmRing::RECORD_DATA, priority, data)) {
+        {
+            std::lock_guard<std::mutex> inflight_lock(inflight_mutex);
+            auto it = std::find(inflight.begin(), inflight.end(), std::make_pair(data.sequence(), priority));
+            if (it != inflight.end()) {
+                inflight.erase(it);
+            }
+        }
+        manager->skip_result(data.sequence(), priority);
+    }
 }
 
-void WorkerProcess::start_timer(int interval) {
-    timer_thread = std::make_unique<std::thread>([this, interval]() {
-        while (!stop_event) {
-            std::this_thread::sleep_for(std::chrono::seconds(interval));
-            workerop();
+// Moves the data from the manager queues to the input ring, hp first
+void WorkerProcess::feed() {
+    auto high_priority_queue = manager->getHighPriorityQueue();
+    auto low_priority_queue = manager->getLowPriorityQueue();
+
+    while (!stop_event) {
+        // Wait for a free slot before taking data, the other workers can take it meanwhile
+        uint64_t slot_ticket = slot_signal.prepare_wait();
+        size_t pending;
+        {
+            std::lock_guard<std::mutex> lock(inflight_mutex);
+            pending = inflight.size();
+        }
+        if (!child_alive || pending >= prefetch) {
+            slot_signal.wait(slot_ticket, ring_timeout);
+            continue;
         }
-    });
+
+        // The ticket is taken before checking the queues, so a push after the check wakes the feeder
+        uint64_t ticket = work_signal->prepare_wait();
+
+        if (processdata == 1) {
+            DataMessage data;
+
+            if (high_priority_queue->try_pop(data)) {
+                send_data(data, 1);
+                continue;
+            }
+            if (low_priority_queue->try_pop(data)) {
+                send_data(data, 0);
+                continue;
+            }
+        }
+
+        wait_strategy->wait(*work_signal, ticket, ring_timeout);
+    }
 }
 
-void WorkerProcess::workerop() {
-    double elapsed_time = std::chrono::system_clock::now().time_since_epoch().count() - next_time;
-    next_time = std::chrono::system_clock::now().time_since_epoch().count();
-    processing_rate = processed_data_count / elapsed_time;
-    manager->setProcessingRate(worker_id, processing_rate);
-    total_processed_data_count += processed_data_count;
-    manager->setTotalProcessedDataCount(worker_id, total_processed_data_count);
+void WorkerProcess::handle_result(const ShmRing::Record& record) {
+    int priority = static_cast<int>(record.priority);
+    {
+        std::lock_guard<std::mutex> lock(inflight_mutex);
+        auto it = std::find(inflight.begin(), inflight.end(), std::make_pair(record.sequence, priority));
+        if (it != inflight.end()) {
+            inflight.erase(it);
+        }
+    }
+
+    if (record.size > 0) {
+        // Copied out of the ring: the result lives in the result queues for an unbounded time
+        DataMessage result = DataMessage::copy_from(record.data, record.size, supervisor->getBufferPool());
+        result.set_sequence(record.sequence);
+        result.set_ingest_time(from_ns(record.ingest_ns));   // Age measured from the first ingest along a pipeline
+        manager->push_result(std::move(result), priority);
+    }
+    else {
+        manager->skip_result(record.sequence, priority);
+    }
+
+    result_ring.consume(record);
+    slot_signal.notify();
+}
 
-    std::cout << globalname << " Rate Hz " << processing_rate << " Current events " << processed_data_count
-              << " Total events " << total_processed_data_count << std::endl;
-    logger->info("Rate Hz " + std::to_string(processing_rate) + " Current events " +
-                  std::to_string(processed_data_count) + " Total events " + std::to_string(total_processed_data_count),
-                  globalname);
-    processed_data_count = 0;
+// Moves the results from the result ring to the manager result queues and watches the child
+void WorkerProcess::collect() {
+    while (!stop_event) {
+        ShmRing::Record record;
+        if (result_ring.peek(record, ring_timeout)) {
+            handle_result(record);
+            continue;
+        }
+        check_child();
+    }
 }
 
-void WorkerProcess::process_data(const nlohmann::json& data, int priority) {
-    manager->setWorkerStatus(worker_id, 8); // processing new data
-    processed_data_count += 1;
+// Called by the collector thread only
+void WorkerProcess::check_child() {
+    pid_t pid = pidprocess;
+    bool exited = false;
+    int wstatus = 0;
 
-    nlohmann::json dataresult;
-    try {
-        dataresult = worker->processData(data, priority);
-    } 
-    catch (const std::exception& e) {
-        logger->critical(e.what(), globalname);
+    ZygoteEvent event;
+    while (read_event(event, 0)) {
+        if (event.type == ZYGOTE_EXITED && event.pid == pid) {
+            exited = true;
+            wstatus = event.wstatus;
+        }
+    }
+
+    // Without the zygote the child is killed (PR_SET_PDEATHSIG) and cannot be restarted
+    bool zygote_lost = false;
+    int zygote_status;
+    if (!exited && zygote_pid > 0 && waitpid(zygote_pid, &zygote_status, WNOHANG) == zygote_pid) {
+        logger->error(fmt::format("Zygote process {} terminated, the worker process cannot be restarted", zygote_pid), globalname);
+        zygote_pid = -1;
+        close(zygote_request_fd);
+        zygote_request_fd = -1;
+        close(zygote_event_fd);
+        zygote_event_fd = -1;
+        zygote_lost = true;
+    }
+
+    if (!child_alive || pid <= 0 || !(exited || zygote_lost)) {
+        return;
+    }
+
+    child_alive = false;
+    status = 32; // crashed
+    slot_signal.notify_all();
+
+    if (zygote_lost) {
+        kill(pid, SIGKILL);     // In case it did not receive its PR_SET_PDEATHSIG yet
+        logger->error(fmt::format("Child process {} terminated with its zygote", pid), globalname);
+    }
+    else if (WIFSIGNALED(wstatus)) {
+        logger->error(fmt::format("Child process {} killed by signal {}", pid, WTERMSIG(wstatus)), globalname);
+    }
+    else {
+        logger->error(fmt::format("Child process {} exited with code {}", pid, WEXITSTATUS(wstatus)), globalname);
+    }
+    supervisor->send_alarm(2, fmt::format("Worker process {} terminated", fullname), fullname, 0, "Medium");
+
+    // Results written before the end of the child
+    ShmRing::Record record;
+    while (result_ring.peek(record, std::chrono::microseconds(0))) {
+        handle_result(record);
+    }
+
+    // The data in flight is lost: skip it so that the ordered results are not blocked
+    std::vector<std::pair<uint64_t, int>> lost;
+    {
+        std::lock_guard<std::mutex> lock(input_mutex);
+        {
+            std::lock_guard<std::mutex> inflight_lock(inflight_mutex);
+            lost.swap(inflight);
+        }
+        reset_rings();
+    }
+    for (const auto& entry : lost) {
+        manager->skip_result(entry.first, entry.second);
     }
+    if (!lost.empty()) {
+        logger->warning(fmt::format("{} messages lost with the child process", lost.size()), globalname);
+    }
+
+    if (restart && !stop_event && spawn()) {
+        restart_count++;
+        status = 0;
+
+        // The new child starts from the worker of the zygote, without the configurations received since
+        std::lock_guard<std::mutex> lock(input_mutex);
+        if (!last_configuration.empty()) {
+            write_input(ShmRing::RECORD_CONFIG, 0, DataMessage::from_vector(std::vector<uint8_t>(last_configuration.begin(), last_configuration.end())));
+        }
+    }
+}
+
+void WorkerProcess::start_timer(int interval) {
+    timer_thread = std::make_unique<std::thread>(&WorkerProcess::workerop, this, interval);
+}
+
+// The rates are computed from the counter of the child in the shared memory
+void WorkerProcess::workerop(int interval) {
+    uint64_t last_processed = control->processed;
+
+    while (!stop_event) {
+        std::this_thread::sleep_for(std::chrono::seconds(interval));
 
-    if (priority == 0) {
-        manager->getResultLpQueue()->push(dataresult);
-    } else {
-        manager->getResultHpQueue()->push(dataresult);
+        uint64_t processed = control->processed;
+        uint64_t processed_data_count = processed - last_processed;
+        last_processed = processed;
+
+        processing_rate = static_cast<double>(processed_data_count) / interval;
+        total_processed_data_count = static_cast<int>(processed);
+        manager->setProcessingRate(worker_id, processing_rate);
+        manager->setTotalProcessedDataCount(worker_id, total_processed_data_count);
+        manager->setWorkerStatus(worker_id, get_status());
+
+        logger->info(fmt::format("{} Rate Hz {:.1f} Current events {} Total events {} Pid {}", globalname, processing_rate.load(), processed_data_count, processed, pidprocess.load()));
     }
 }
+
+int WorkerProcess::getWorkerId() const {
+    return worker_id;
+}
+
+pid_t WorkerProcess::getPid() const {
+    return pidprocess;
+}
+
+int WorkerProcess::get_status() const {
+    return child_alive ? control->status.load() : status.load();
+}
+
+double WorkerProcess::getProcessingRate() const {
+    return processing_rate;
+}
+
+int WorkerProcess::getTotalProcessedDataCount() const {
+    return total_processed_data_count;
+}
+
+uint64_t WorkerProcess::getRestartCount() const {
+    return restart_count;
+}
+
+size_t WorkerProcess::getScratchHighWater() const {
+    return control->scratch_high_water;
+}
@@ -0,0 +1,50 @@
+// Copyright (C) 2024 INAF
+// This software is distributed under the terms of the BSD-3-Clause license
+//
+// Authors:
+//
+//    Andrea Bulgarelli <andrea.bulgarelli@inaf.it>
+//
+
+#include <rtadp/WorkerRegistry.h>
+#include <rtadp/WorkerBase.h>
+
+// Function-local statics, so that registrations from static initializers of other translation units are safe
+std::map<std::string, WorkerRegistry::Factory>& WorkerRegistry::factories() {
+    static std::map<std::string, Factory> instance;
+    return instance;
+}
+
+std::mutex& WorkerRegistry::registry_mutex() {
+    static std::mutex instance;
+    return instance;
+}
+
+bool WorkerRegistry::register_worker(const std::string& name, Factory factory) {
+    std::lock_guard<std::mutex> lock(registry_mutex());
+    factories()[name] = std::move(factory);
+    return true;
+}
+
+WorkerBase* WorkerRegistry::create(const std::string& name) {
+    std::lock_guard<std::mutex> lock(registry_mutex());
+    auto it = factories().find(name);
+    if (it == factories().end()) {
+        return nullptr;
+    }
+    return it->second();
+}
+
+bool WorkerRegistry::contains(const std::string& name) {
+    std::lock_guard<std::mutex> lock(registry_mutex());
+    return factories().count(name) > 0;
+}
+
+std::vector<std::string> WorkerRegistry::names() {
+    std::lock_guard<std::mutex> lock(registry_mutex());
+    std::vector<std::string> result;
+    for (const auto& entry : factories()) {
+        result.push_back(entry.first);
+    }
+    return result;
+}
@@ -9,6 +9,8 @@
 #include <memory>
 #include <execinfo.h>
 #include <unistd.h>
+#include <pthread.h>
+#include <sched.h>
 #include <rtadp/utils2.hh>
 #include <iostream>
 #include <rtadp/WorkerThread.h>
@@ -31,7 +33,17 @@ WorkerThread::WorkerThread(int worker_id, WorkerManager* manager, const std::str
 
     low_priority_queue = manager->getLowPriorityQueue();
     high_priority_queue = manager->getHighPriorityQueue();
+    work_signal = manager->getWorkSignal();
+    wait_strategy = manager->getWaitStrategy();
+    concurrent_scheduling = manager->isConcurrentScheduling();
+    hp_reserved = manager->isHpReservedWorker(worker_id);
+    hp_reserved_lp = manager->isHpReservedLp();
+    hp_signal = manager->getHpSignal();
+    hp_wait_strategy = manager->getHpWaitStrategy();
+    batch_size = manager->getBatchSize();
+    batch_wait = manager->getBatchWait();
     monitoringpoint = manager->getMonitoringPoint();
+    context = std::make_unique<WorkerContext>(worker_id, manager->getScratchBytes(), supervisor->getBufferPool());
 
     start_time = std::chrono::high_resolution_clock::now();
     next_time = start_time;
@@ -42,6 +54,28 @@ WorkerThread::WorkerThread(int worker_id, WorkerManager* manager, const std::str
     logger->info("WorkerThread started", globalname);
 
     internal_thread = std::make_unique<std::thread>(&WorkerThread::run, this);
+
+    if (hp_reserved) {
+        logger->info("Reserved to the hp queue", globalname);
+        int cpu = manager->getHpReservedCpu(worker_id);
+        if (cpu >= 0) {
+            set_cpu_affinity(cpu);
+        }
+    }
+}
+
+void WorkerThread::set_cpu_affinity(int cpu) {
+    cpu_set_t cpuset;
+    CPU_ZERO(&cpuset);
+    CPU_SET(cpu, &cpuset);
+
+    int err = pthread_setaffinity_np(internal_thread->native_handle(), sizeof(cpu_set_t), &cpuset);
+    if (err != 0) {
+        logger->warning(fmt::format("Cannot pin to CPU {}: error {}", cpu, err), globalname);
+    }
+    else {
+        logger->info(fmt::format("Pinned to CPU {}", cpu), globalname);
+    }
 }
 
 void WorkerThread::config(const json& configuration) {
@@ -55,33 +89,169 @@ void WorkerThread::set_processdata(int processdata1) {
 void WorkerThread::run() {
     start_timer(1);
 
+    if (hp_reserved) {
+        run_hp_reserved();
+    }
+    else if (concurrent_scheduling && batch_size > 1) {
+        run_batch();
+    }
+    else if (concurrent_scheduling) {
+        run_concurrent();
+    }
+    else {
+        run_token();
+    }
+}
+
+// Token scheduling: only the worker holding the reading token dequeues, then the token is passed on.
+// The worker waits on the manager work signal, which is notified on every push and token change.
+void WorkerThread::run_token() {
+    const auto idle_timeout = std::chrono::milliseconds(100);   // Upper bound to check _stop_event
+
     while (!_stop_event) {
-        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+        // The ticket is taken before checking the queues, so a push after the check wakes the worker
+        uint64_t ticket = work_signal->prepare_wait();
 
         if (processdata == 1 && tokenreading == 0) {
+                DataMessage data;
+
                 // Check and process high-priority queue first
-                if (!high_priority_queue->empty()) {
-                    auto high_priority_data = high_priority_queue->get();
+                if (high_priority_queue->try_pop(data)) {
                     manager->change_token_reading();
-                    process_data(high_priority_data, 1);
+                    process_data(data, 1);
+                    continue;
                 } 
                 // Process low-priority queue if high-priority queue is empty
-                else if (!low_priority_queue->empty()) {
-                    auto low_priority_data = low_priority_queue->get();
+                if (low_priority_queue->try_pop(data)) {
                     manager->change_token_reading();
-                    process_data(low_priority_data, 0);
-                }
-                else if (high_priority_queue->empty() && low_priority_queue->empty()) {
-                    status = 2; // Waiting for new data
+                    process_data(data, 0);
+                    continue;
                 }
+
+                status = 2; // Waiting for new data
         } 
         else {
             if (tokenreading != 0 && status != 4) {
                 status = 4; // Waiting for reading from queue
             }
         }
+
+        wait_strategy->wait(*work_signal, ticket, idle_timeout);
+    }
+
+}
+
+// Concurrent scheduling: every idle worker sleeps on the manager work signal and dequeues directly,
+// so all workers can read at the same time. The order of the results is not preserved.
+void WorkerThread::run_concurrent() {
+    const auto idle_timeout = std::chrono::milliseconds(100);   // Upper bound to check _stop_event
+
+    while (!_stop_event) {
+        // The ticket is taken before checking the queues, so a push after the check wakes the worker
+        uint64_t ticket = work_signal->prepare_wait();
+
+        if (processdata == 1) {
+            DataMessage data;
+
+            // Check and process high-priority queue first
+            if (high_priority_queue->try_pop(data)) {
+                process_data(data, 1);
+                continue;
+            }
+            if (low_priority_queue->try_pop(data)) {
+                process_data(data, 0);
+                continue;
+            }
+
+            status = 2; // Waiting for new data
+        }
+
+        wait_strategy->wait(*work_signal, ticket, idle_timeout);
+    }
+}
+
+// Concurrent scheduling with batches: an hp batch is formed with the hp data already queued, an lp batch
+// waits up to batch_wait for more lp data unless hp data arrives meanwhile.
+void WorkerThread::run_batch() {
+    const auto idle_timeout = std::chrono::milliseconds(100);   // Upper bound to check _stop_event
+
+    std::vector<DataMessage> batch;
+    batch.reserve(batch_size);
+    std::vector<DataMessage> results;
+    results.reserve(batch_size);
+
+    while (!_stop_event) {
+        // The ticket is taken before checking the queues, so a push after the check wakes the worker
+        uint64_t ticket = work_signal->prepare_wait();
+
+        if (processdata == 1) {
+            if (pop_batch(*high_priority_queue, batch) > 0) {
+                process_batch(batch, 1, results);
+                continue;
+            }
+
+            if (pop_batch(*low_priority_queue, batch) > 0) {
+                auto deadline = std::chrono::steady_clock::now() + batch_wait;
+                while (batch.size() < batch_size && !_stop_event && high_priority_queue->empty()) {
+                    uint64_t fill_ticket = work_signal->prepare_wait();
+                    if (pop_batch(*low_priority_queue, batch) > 0) {
+                        continue;
+                    }
+                    auto now = std::chrono::steady_clock::now();
+                    if (now >= deadline) {
+                        break;
+                    }
+                    wait_strategy->wait(*work_signal, fill_ticket, std::chrono::duration_cast<std::chrono::microseconds>(deadline - now));
+                }
+                process_batch(batch, 0, results);
+                continue;
+            }
+
+            status = 2; // Waiting for new data
+        }
+
+        wait_strategy->wait(*work_signal, ticket, idle_timeout);
     }
+}
 
+size_t WorkerThread::pop_batch(MessageQueue<DataMessage>& queue, std::vector<DataMessage>& batch) {
+    size_t count = 0;
+    DataMessage data;
+    while (batch.size() < batch_size && queue.try_pop(data)) {
+        batch.push_back(std::move(data));
+        count++;
+    }
+    return count;
+}
+
+// hp fast lane: the worker takes only hp data, so an hp message never waits behind a long lp processing.
+// If hp_reserved_lp is set, lp data is processed when the hp queue is empty.
+void WorkerThread::run_hp_reserved() {
+    const auto idle_timeout = std::chrono::milliseconds(100);   // Upper bound to check _stop_event
+
+    // hp pushes notify both signals, lp pushes only work_signal
+    auto& signal = hp_reserved_lp ? work_signal : hp_signal;
+
+    while (!_stop_event) {
+        uint64_t ticket = signal->prepare_wait();
+
+        if (processdata == 1) {
+            DataMessage data;
+
+            if (high_priority_queue->try_pop(data)) {
+                process_data(data, 1);
+                continue;
+            }
+            if (hp_reserved_lp && low_priority_queue->try_pop(data)) {
+                process_data(data, 0);
+                continue;
+            }
+
+            status = 2; // Waiting for new data
+        }
+
+        hp_wait_strategy->wait(*signal, ticket, idle_timeout);
+    }
 }
 
 // Destructor
@@ -111,6 +281,13 @@ void WorkerThread::stop() {
     low_priority_queue->notify_all();
     high_priority_queue->notify_all();
 
+    // The workers idle on the signals, not on the queues: wake them so a retired worker exits now
+    // instead of at the end of its idle timeout
+    work_signal->notify_all();
+    if (hp_reserved) {
+        hp_signal->notify_all();
+    }
+
     if (internal_thread && internal_thread->joinable()) {
         internal_thread->join();
     }
@@ -154,6 +331,14 @@ int WorkerThread::getTotalProcessedDataCount() const {
     return total_processed_data_count;
 }
 
+uint64_t WorkerThread::getBusyTime() const {
+    return busy_ns;
+}
+
+size_t WorkerThread::getScratchHighWater() const {
+    return context->scratch().getHighWater();
+}
+
 void WorkerThread::set_status(int value) { 
     status = value;
 }
@@ -186,7 +371,61 @@ void WorkerThread::workerop(int interval) {
     }
 }
 
-void WorkerThread::process_data(const std::vector<uint8_t>& data, int priority) {
+void WorkerThread::process_batch(std::vector<DataMessage>& batch, int priority, std::vector<DataMessage>& results) {
+    // The expired data is skipped before the batch is passed to the worker
+    size_t kept = 0;
+    for (size_t i = 0; i < batch.size(); i++) {
+        if (manager->check_data_age(batch[i], priority)) {
+            if (kept != i) {
+                batch[kept] = std::move(batch[i]);
+            }
+            kept++;
+        }
+    }
+    batch.erase(batch.begin() + kept, batch.end());
+
+    if (batch.empty() || !worker) {
+        batch.clear();
+        return;
+    }
+
+    status = 8; // processing new data
+    processed_data_count += static_cast<int>(batch.size());
+
+    results.clear();
+    auto busy_start = std::chrono::steady_clock::now();
+    worker->processBatch(batch, priority, results, *context);
+    context->reset();
+    busy_ns += std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - busy_start).count();
+
+    if (worker->take_result_deferred()) {
+        batch.clear();
+        results.clear();
+        context->output().clear();
+        return;     // Results delivered by the worker (e.g. through the batcher)
+    }
+
+    for (size_t i = 0; i < batch.size(); i++) {
+        if (i < results.size() && results[i].total_size() > 0) {
+            DataMessage result = std::move(results[i]);
+            result.set_sequence(batch[i].sequence());
+            result.set_ingest_time(batch[i].ingest_time());
+            manager->push_result(std::move(result), priority);
+        }
+        else {
+            manager->skip_result(batch[i].sequence(), priority);
+        }
+    }
+
+    batch.clear();
+    results.clear();    // Releases the result payloads not pushed
+}
+
+void WorkerThread::process_data(const DataMessage& data, int priority) {
+    if (!manager->check_data_age(data, priority)) {
+        return;     // Expired
+    }
+
     status = 8; // processing new data
     processed_data_count++;
 
@@ -194,42 +433,32 @@ void WorkerThread::process_data(const std::vector<uint8_t>& data, int priority)
         return;
     }
 
-    auto dataresult = worker->processData(data, priority);
+    auto busy_start = std::chrono::steady_clock::now();
+    OutputBuffer& output = context->output();
+    output.clear();
+    worker->processData(data, priority, output, *context);
+    context->reset();
+    busy_ns += std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - busy_start).count();
 
-    if (!dataresult.empty() && tokenresult == 0) {
-        logger->info("WorkerThread::process_data: pushing dataresult into the queue");
+    if (worker->take_result_deferred()) {
+        output.clear();
+        return;     // Result delivered by the worker (e.g. through the batcher)
+    }
 
-        // Push the received data into queue according to the packet type
-        if (priority == 0) {
-            /*
-            if (!dataresult.empty() && tokenresult == 0) {
-                std::cout << "WorkerThread::process_data: pusho sulla coda" << std::endl;
+    if (!output.empty() && (concurrent_scheduling || hp_reserved || tokenresult == 0)) {
+        // Push the result into the result queue of the channel the data came from
+        DataMessage result = output.take();
+        result.set_sequence(data.sequence());
+        result.set_ingest_time(data.ingest_time());   // Age measured from the first ingest along a pipeline
+        manager->push_result(std::move(result), priority);
 
-                if (priority == 0) {
-                    for (auto& manager : manager_workers) {
-                        manager->getResultLpQueue()->push(dataresult);
-                    }
-                }
-                else {
-                    for (auto& manager : manager_workers) {
-                        manager->getResultHpQueue()->push(dataresult);
-                    }
-                }
-                manager->change_token_results();
-            }
-            else {
-                std::cout << "WorkerThread::process_data: dataresult EMPTY" << std::endl;
-            }
-            */
-        } 
-        else {
-            manager->getResultHpQueue()->push(dataresult);
+        if (!concurrent_scheduling && !hp_reserved) {
+            manager->change_token_results();
         }
-
-        manager->change_token_results();
     }
     else {
-        logger->info("WorkerThread::process_data: dataresult EMPTY");
+        output.clear();
+        manager->skip_result(data.sequence(), priority);
 
     }
 }
\ No newline at end of file
@@ -0,0 +1,192 @@
+// Copyright (C) 2024 INAF
+// This software is distributed under the terms of the BSD-3-Clause license
+//
+// Authors:
+//
+//    Andrea Bulgarelli <andrea.bulgarelli@inaf.it>
+//
+
+#include <rtadp/BoundedQueue.h>
+#include <rtadp/ThreadSafeQueue.h>
+#include <rtadp/DataMessage.h>
+#include <atomic>
+#include <thread>
+#include <vector>
+#include "TestCheck.h"
+
+namespace {
+
+DataMessage message(uint64_t sequence, size_t size = 1) {
+    DataMessage data = DataMessage::from_vector(std::vector<uint8_t>(size, static_cast<uint8_t>(sequence)));
+    data.set_sequence(sequence);
+    return data;
+}
+
+std::vector<DataMessage> batch(uint64_t first, uint64_t count) {
+    std::vector<DataMessage> values;
+    for (uint64_t sequence = first; sequence < first + count; sequence++) {
+        values.push_back(message(sequence));
+    }
+    return values;
+}
+
+std::vector<uint64_t> take_all(MessageQueue<DataMessage>& queue) {
+    std::vector<uint64_t> sequences;
+    DataMessage data;
+    while (queue.try_pop(data)) {
+        sequences.push_back(data.sequence());
+    }
+    return sequences;
+}
+
+// Queue of max_messages messages recording the sequences passed to on_drop
+struct Fixture {
+    std::vector<uint64_t> dropped;
+    std::vector<std::string> alarms;
+    std::shared_ptr<BoundedQueue<DataMessage>> queue;
+
+    Fixture(OverflowPolicy policy, size_t max_messages, size_t max_bytes = 0) {
+        queue = std::make_shared<BoundedQueue<DataMessage>>(
+            std::make_shared<ThreadSafeQueue<DataMessage>>(), max_messages, max_bytes, policy,
+            [this](const std::string& alarm) { alarms.push_back(alarm); },
+            [this](const DataMessage& data) { dropped.push_back(data.sequence()); });
+    }
+};
+
+void test_block_try_push() {
+    Fixture fixture(OverflowPolicy::Block, 2);
+    BoundedQueue<DataMessage>& queue = *fixture.queue;
+
+    CHECK(queue.try_push(message(0)));
+    CHECK(queue.try_push(message(1)));
+    CHECK(!queue.try_push(message(2)));     // Full: the caller keeps the message
+    CHECK(queue.try_push_batch(batch(2, 3)) == 0);
+    CHECK(fixture.dropped.empty());
+    CHECK(queue.get_dropped_count() == 0 && queue.get_rejected_count() == 0);
+
+    DataMessage data;
+    CHECK(queue.try_pop(data) && data.sequence() == 0);
+    CHECK(queue.try_push_batch(batch(2, 3)) == 1);
+    CHECK((take_all(queue) == std::vector<uint64_t>{1, 2}));
+}
+
+// A blocked push waits for a consumer and is counted
+void test_block_push_waits() {
+    Fixture fixture(OverflowPolicy::Block, 1);
+    BoundedQueue<DataMessage>& queue = *fixture.queue;
+
+    queue.push(message(0));
+    std::atomic<bool> pushed{false};
+    std::thread producer([&] {
+        queue.push(message(1));
+        pushed = true;
+    });
+    std::this_thread::sleep_for(std::chrono::milliseconds(50));
+    CHECK(!pushed);
+
+    DataMessage data = queue.get();
+    CHECK(data.sequence() == 0);
+    producer.join();
+    CHECK(pushed);
+    CHECK(queue.get_blocked_count() == 1);
+    CHECK((take_all(queue) == std::vector<uint64_t>{1}));
+}
+
+// notify_all releases a producer blocked on a full queue
+void test_block_stop() {
+    Fixture fixture(OverflowPolicy::Block, 1);
+    BoundedQueue<DataMessage>& queue = *fixture.queue;
+
+    queue.push(message(0));
+    std::thread producer([&] { queue.push(message(1)); });
+    std::this_thread::sleep_for(std::chrono::milliseconds(20));
+    queue.notify_all();
+    producer.join();
+    CHECK(fixture.dropped.empty());
+}
+
+void test_drop_oldest() {
+    Fixture fixture(OverflowPolicy::DropOldest, 2);
+    BoundedQueue<DataMessage>& queue = *fixture.queue;
+
+    queue.push(message(0));
+    queue.push(message(1));
+    queue.push(message(2));
+    CHECK(queue.try_push(message(3)));
+    CHECK((fixture.dropped == std::vector<uint64_t>{0, 1}));
+    CHECK(queue.get_dropped_count() == 2);
+
+    // The batch evicts the queued messages first, then its own oldest ones
+    CHECK(queue.try_push_batch(batch(4, 3)) == 3);
+    CHECK((fixture.dropped == std::vector<uint64_t>{0, 1, 2, 3, 4}));
+    CHECK(queue.get_dropped_count() == 5);
+    CHECK((take_all(queue) == std::vector<uint64_t>{5, 6}));
+    CHECK(queue.get_bytes() == 0);
+}
+
+void test_drop_newest() {
+    Fixture fixture(OverflowPolicy::DropNewest, 2);
+    BoundedQueue<DataMessage>& queue = *fixture.queue;
+
+    queue.push(message(0));
+    queue.push(message(1));
+    queue.push(message(2));
+    CHECK(queue.try_push(message(3)));      // Taken: discarded by the policy, not returned to the caller
+    CHECK(queue.try_push_batch(batch(4, 2)) == 2);
+    CHECK((fixture.dropped == std::vector<uint64_t>{2, 3, 4, 5}));
+    CHECK(queue.get_dropped_count() == 4);
+    CHECK(queue.get_rejected_count() == 0);
+    CHECK((take_all(queue) == std::vector<uint64_t>{0, 1}));
+}
+
+// The alarm is raised once, and again only after the queue accepted a push
+void test_reject() {
+    Fixture fixture(OverflowPolicy::Reject, 1);
+    BoundedQueue<DataMessage>& queue = *fixture.queue;
+
+    queue.push(message(0));
+    queue.push(message(1));
+    CHECK(queue.try_push(message(2)));
+    CHECK(queue.get_rejected_count() == 2);
+    CHECK(queue.get_dropped_count() == 0);
+    CHECK((fixture.dropped == std::vector<uint64_t>{1, 2}));
+    CHECK(fixture.alarms.size() == 1);
+
+    DataMessage data;
+    CHECK(queue.try_pop(data));
+    queue.push(message(3));
+    queue.push(message(4));
+    CHECK(fixture.alarms.size() == 2);
+    CHECK((fixture.dropped == std::vector<uint64_t>{1, 2, 4}));
+}
+
+void test_max_bytes() {
+    Fixture fixture(OverflowPolicy::Block, 0, 10);
+    BoundedQueue<DataMessage>& queue = *fixture.queue;
+
+    CHECK(queue.try_push(message(0, 6)));
+    CHECK(!queue.try_push(message(1, 6)));
+    CHECK(queue.try_push(message(2, 4)));
+    CHECK(queue.get_bytes() == 10);
+
+    DataMessage data;
+    CHECK(queue.try_pop(data) && queue.get_bytes() == 4);
+    CHECK(queue.try_pop(data) && queue.get_bytes() == 0);
+
+    // A message larger than max_bytes passes in an empty queue only
+    CHECK(queue.try_push(message(3, 20)));
+    CHECK(!queue.try_push(message(4, 1)));
+}
+
+}
+
+int main() {
+    test_block_try_push();
+    test_block_push_waits();
+    test_block_stop();
+    test_drop_oldest();
+    test_drop_newest();
+    test_reject();
+    test_max_bytes();
+    return 0;
+}
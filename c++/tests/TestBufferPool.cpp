@@ -0,0 +1,183 @@
+// Copyright (C) 2024 INAF
+// This software is distributed under the terms of the BSD-3-Clause license
+//
+// Authors:
+//
+//    Andrea Bulgarelli <andrea.bulgarelli@inaf.it>
+//
+
+#include <rtadp/BufferPool.h>
+#include <rtadp/DataMessage.h>
+#include <condition_variable>
+#include <cstring>
+#include <deque>
+#include <mutex>
+#include <thread>
+#include <utility>
+#include <vector>
+#include "TestCheck.h"
+
+namespace {
+
+nlohmann::json small_pool() {
+    return {{"min_block_bytes", 64}, {"max_block_bytes", 4096}, {"thread_cache_blocks", 8}, {"slab_bytes", 65536}};
+}
+
+bool filled(const void* block, size_t size, uint8_t value) {
+    const uint8_t* bytes = static_cast<const uint8_t*>(block);
+    for (size_t i = 0; i < size; i++) {
+        if (bytes[i] != value) {
+            return false;
+        }
+    }
+    return true;
+}
+
+void test_sizes_and_alignment() {
+    BufferPool pool(small_pool());
+    CHECK(pool.getMaxBlockSize() == 4096);
+
+    std::vector<std::pair<void*, size_t>> blocks;
+    for (size_t size : {1, 63, 64, 65, 500, 1024, 4095, 4096}) {
+        void* block = pool.allocate(size);
+        CHECK(reinterpret_cast<uintptr_t>(block) % 64 == 0);
+        std::memset(block, static_cast<int>(size & 0xff), size);
+        blocks.emplace_back(block, size);
+    }
+    for (auto& [block, size] : blocks) {
+        CHECK(filled(block, size, static_cast<uint8_t>(size & 0xff)));   // No overlap between the blocks
+        pool.deallocate(block, size);
+    }
+    CHECK(pool.getOversizeCount() == 0);
+
+    void* large = pool.allocate(10000);
+    CHECK(pool.getOversizeCount() == 1);
+    pool.deallocate(large, 10000);
+}
+
+// A freed block is served again to the same thread without carving new memory
+void test_recycling() {
+    BufferPool pool(small_pool());
+    void* block = pool.allocate(200);
+    uint64_t misses = pool.getMissCount();
+    pool.deallocate(block, 200);
+
+    for (int i = 0; i < 1000; i++) {
+        void* again = pool.allocate(200);
+        pool.deallocate(again, 200);
+    }
+    CHECK(pool.getMissCount() == misses);
+    CHECK(pool.getHitRate() > 0.99);
+}
+
+// One thread allocates, another frees: the blocks return through the shared free lists, so in steady
+// state the producer is served by recycled blocks and the reserved memory stops growing
+void test_cross_thread_free() {
+    BufferPool pool(small_pool());
+    std::mutex mtx;
+    std::condition_variable changed;
+    std::deque<std::pair<void*, size_t>> handoff;
+    bool done = false;
+    bool corrupted = false;
+
+    std::thread consumer([&] {
+        while (true) {
+            std::pair<void*, size_t> block;
+            {
+                std::unique_lock<std::mutex> lock(mtx);
+                changed.wait(lock, [&] { return done || !handoff.empty(); });
+                if (handoff.empty()) {
+                    return;
+                }
+                block = handoff.front();
+                handoff.pop_front();
+            }
+            changed.notify_all();
+            if (!filled(block.first, block.second, static_cast<uint8_t>(block.second))) {
+                corrupted = true;
+            }
+            pool.deallocate(block.first, block.second);
+        }
+    });
+
+    size_t reserved_after_warmup = 0;
+    for (int i = 0; i < 100000; i++) {
+        if (i == 20000) {
+            reserved_after_warmup = pool.getReservedBytes();
+        }
+        size_t size = 1 + (i * 7919) % 4096;
+        void* block = pool.allocate(size);
+        std::memset(block, static_cast<int>(static_cast<uint8_t>(size)), size);
+
+        std::unique_lock<std::mutex> lock(mtx);
+        changed.wait(lock, [&] { return handoff.size() < 256; });
+        handoff.emplace_back(block, size);
+        changed.notify_all();
+    }
+    {
+        std::lock_guard<std::mutex> lock(mtx);
+        done = true;
+    }
+    changed.notify_all();
+    consumer.join();
+
+    CHECK(!corrupted);
+    CHECK(pool.getReservedBytes() == reserved_after_warmup);
+    CHECK(pool.getHitRate() > 0.9);
+}
+
+// The cache of an exiting thread goes back to the shared free lists
+void test_thread_exit() {
+    BufferPool pool(small_pool());
+    std::thread worker([&] {
+        std::vector<void*> blocks;
+        for (int i = 0; i < 6; i++) {
+            blocks.push_back(pool.allocate(1024));
+        }
+        for (void* block : blocks) {
+            pool.deallocate(block, 1024);
+        }
+    });
+    worker.join();
+    CHECK(pool.getFreeBytes() >= 6 * 1024);
+}
+
+// The payloads of the messages are allocated and released by different threads
+void test_data_messages() {
+    auto pool = std::make_shared<BufferPool>(small_pool());
+    std::vector<DataMessage> messages;
+    for (int i = 0; i < 1000; i++) {
+        messages.push_back(DataMessage::from_vector(std::vector<uint8_t>(100, static_cast<uint8_t>(i)), pool));
+    }
+    std::thread releaser([&] { messages.clear(); });
+    releaser.join();
+
+    uint64_t misses = pool->getMissCount();
+    for (int i = 0; i < 100; i++) {
+        DataMessage message = DataMessage::from_vector(std::vector<uint8_t>(100, 1), pool);
+        CHECK(message.size() == 100);
+    }
+    CHECK(pool->getMissCount() == misses);
+}
+
+// The allocator keeps the pool alive after its owner released it
+void test_allocator_lifetime() {
+    auto pool = std::make_shared<BufferPool>(small_pool());
+    auto values = std::allocate_shared<std::vector<int>>(PoolAllocator<std::vector<int>>(pool), 10, 7);
+    pool.reset();
+    CHECK(values->size() == 10 && (*values)[9] == 7);
+    std::thread releaser([&] { values.reset(); });
+    releaser.join();
+}
+
+}
+
+int main() {
+    test_sizes_and_alignment();
+    test_recycling();
+    test_cross_thread_free();
+    test_thread_exit();
+    test_data_messages();
+    test_allocator_lifetime();
+    return 0;
+}
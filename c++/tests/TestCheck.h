@@ -0,0 +1,17 @@
+#ifndef TESTCHECK_H
+#define TESTCHECK_H
+
+#include <cstdlib>
+#include <iostream>
+
+// Minimal check for the unit tests (each test is an executable run by ctest): unlike assert, it is
+// not compiled out in release builds, and a failure exits with the location and the condition
+#define CHECK(condition)                                                                          \
+    do {                                                                                          \
+        if (!(condition)) {                                                                       \
+            std::cerr << __FILE__ << ":" << __LINE__ << ": CHECK failed: " #condition << std::endl; \
+            std::exit(1);                                                                         \
+        }                                                                                         \
+    } while (0)
+
+#endif // TESTCHECK_H
@@ -0,0 +1,162 @@
+// Copyright (C) 2024 INAF
+// This software is distributed under the terms of the BSD-3-Clause license
+//
+// Authors:
+//
+//    Andrea Bulgarelli <andrea.bulgarelli@inaf.it>
+//
+
+#include <rtadp/LockFreeRingBuffer.h>
+#include <algorithm>
+#include <atomic>
+#include <thread>
+#include <vector>
+#include "TestCheck.h"
+
+namespace {
+
+void test_capacity() {
+    LockFreeRingBuffer<long> ring(5);
+    CHECK(ring.get_capacity() == 8);    // Rounded up to a power of two
+    CHECK(ring.empty());
+}
+
+void test_full_and_empty() {
+    LockFreeRingBuffer<long> ring(4);
+    for (long i = 0; i < 4; i++) {
+        CHECK(ring.try_push(i));
+    }
+    CHECK(!ring.try_push(4));
+    CHECK(ring.size() == 4);
+
+    long value;
+    for (long i = 0; i < 4; i++) {
+        CHECK(ring.try_pop(value));
+        CHECK(value == i);
+    }
+    CHECK(!ring.try_pop(value));
+    CHECK(ring.empty());
+}
+
+// The positions run many times around the cells, the order is kept across the wraparound
+void test_wraparound() {
+    LockFreeRingBuffer<long> ring(4);
+    long next_push = 0;
+    long next_pop = 0;
+    long value;
+
+    for (int round = 0; round < 1000; round++) {
+        int pushes = 1 + round % 4;
+        for (int i = 0; i < pushes && ring.try_push(next_push); i++) {
+            next_push++;
+        }
+        int pops = 1 + (round * 7) % 4;
+        for (int i = 0; i < pops && ring.try_pop(value); i++) {
+            CHECK(value == next_pop);
+            next_pop++;
+        }
+    }
+    while (ring.try_pop(value)) {
+        CHECK(value == next_pop);
+        next_pop++;
+    }
+    CHECK(next_pop == next_push);
+    CHECK(next_push > 1000);
+}
+
+void test_try_push_batch() {
+    LockFreeRingBuffer<long> ring(4);
+    CHECK(ring.try_push(100));
+    CHECK(ring.try_push_batch({0, 1, 2, 3, 4}) == 3);   // Stops when full
+
+    long value;
+    CHECK(ring.try_pop(value) && value == 100);
+    for (long i = 0; i < 3; i++) {
+        CHECK(ring.try_pop(value) && value == i);
+    }
+}
+
+// Several producers and consumers with the blocking push/get on a small ring: every value is
+// received exactly once and the values of each producer arrive in order to each consumer
+void test_mpmc_stress() {
+    const int producers = 4;
+    const int consumers = 4;
+    const long per_producer = 200000;
+    LockFreeRingBuffer<long> ring(64);
+
+    std::vector<std::vector<long>> received(consumers);
+    std::atomic<long> remaining{producers * per_producer};
+
+    std::vector<std::thread> threads;
+    for (int p = 0; p < producers; p++) {
+        threads.emplace_back([&ring, p, per_producer] {
+            for (long i = 0; i < per_producer; i++) {
+                ring.push(p * per_producer + i);
+            }
+        });
+    }
+    for (int c = 0; c < consumers; c++) {
+        threads.emplace_back([&ring, &received, &remaining, c] {
+            long value;
+            while (remaining > 0) {
+                if (ring.try_pop(value)) {
+                    received[c].push_back(value);
+                    remaining--;
+                }
+                else {
+                    std::this_thread::yield();
+                }
+            }
+        });
+    }
+    for (auto& thread : threads) {
+        thread.join();
+    }
+
+    std::vector<long> all;
+    for (const auto& values : received) {
+        std::vector<long> last(producers, -1);
+        for (long value : values) {
+            int producer = static_cast<int>(value / per_producer);
+            CHECK(value > last[producer]);
+            last[producer] = value;
+        }
+        all.insert(all.end(), values.begin(), values.end());
+    }
+    std::sort(all.begin(), all.end());
+    CHECK(static_cast<long>(all.size()) == producers * per_producer);
+    for (long i = 0; i < static_cast<long>(all.size()); i++) {
+        CHECK(all[i] == i);
+    }
+    CHECK(ring.empty());
+}
+
+// A consumer parked in get() is woken by notify_all()
+void test_stop_wakes_consumer() {
+    LockFreeRingBuffer<long> ring(4);
+    std::atomic<bool> stopped{false};
+    std::thread consumer([&] {
+        try {
+            ring.get();
+        }
+        catch (const std::runtime_error&) {
+            stopped = true;
+        }
+    });
+    std::this_thread::sleep_for(std::chrono::milliseconds(50));
+    ring.notify_all();
+    consumer.join();
+    CHECK(stopped);
+}
+
+}
+
+int main() {
+    test_capacity();
+    test_full_and_empty();
+    test_wraparound();
+    test_try_push_batch();
+    test_mpmc_stress();
+    test_stop_wakes_consumer();
+    return 0;
+}
@@ -0,0 +1,210 @@
+// Copyright (C) 2024 INAF
+// This software is distributed under the terms of the BSD-3-Clause license
+//
+// Authors:
+//
+//    Andrea Bulgarelli <andrea.bulgarelli@inaf.it>
+//
+
+#include <rtadp/PacketView.h>
+#include <rtadp/OutputBuffer.h>
+#include <rtadp/DataMessage.h>
+#include <cstring>
+#include <stdexcept>
+#include <type_traits>
+#include <utility>
+#include <vector>
+#include "TestCheck.h"
+
+namespace {
+
+struct Waveform {
+    int32_t run;
+    double time;
+    uint16_t nsamples;
+};
+
+struct Housekeeping {
+    int32_t run;
+    int32_t status;
+};
+
+// The wire format of serializePacket<T>: int32 size prefix, then the struct
+template <typename T>
+std::vector<uint8_t> serialize(const T& packet) {
+    std::vector<uint8_t> bytes(PacketView<T>::WIRE_SIZE);
+    int32_t size = sizeof(T);
+    std::memcpy(bytes.data(), &size, PacketView<T>::PREFIX_SIZE);
+    std::memcpy(bytes.data() + PacketView<T>::PREFIX_SIZE, &packet, sizeof(T));
+    return bytes;
+}
+
+// The bytes copied at offset in an 8-aligned buffer, so that the struct has a known alignment
+struct Placed {
+    alignas(alignof(std::max_align_t)) uint8_t storage[128];
+    const uint8_t* data;
+
+    Placed(const std::vector<uint8_t>& bytes, size_t offset) : data(storage + offset) {
+        std::memcpy(storage + offset, bytes.data(), bytes.size());
+    }
+};
+
+template <typename Function>
+bool throws_out_of_range(Function&& function) {
+    try {
+        function();
+    } catch (const std::out_of_range&) {
+        return true;
+    }
+    return false;
+}
+
+void test_matches() {
+    auto bytes = serialize(Waveform{7, 2.5, 1024});
+
+    CHECK(bytes.size() == 4 + sizeof(Waveform));
+    CHECK(PacketView<Waveform>::matches(bytes.data(), bytes.size()));
+    CHECK(!PacketView<Waveform>::matches(bytes.data(), bytes.size() - 1));
+    CHECK(!PacketView<Waveform>::matches(bytes.data(), 0));
+    CHECK(!PacketView<Housekeeping>::matches(bytes.data(), bytes.size()));
+
+    // Longer payloads match, the prefix tells the type
+    bytes.resize(bytes.size() + 16);
+    CHECK(PacketView<Waveform>::matches(bytes.data(), bytes.size()));
+}
+
+void test_bounds() {
+    auto bytes = serialize(Waveform{7, 2.5, 1024});
+    auto housekeeping = serialize(Housekeeping{7, 1});
+
+    auto short_payload = [&] { PacketView<Waveform>::from(bytes.data(), bytes.size() - 1); };
+    auto wrong_prefix = [&] { PacketView<Waveform>::from(housekeeping.data(), housekeeping.size()); };
+    auto view = PacketView<Waveform>::from(bytes.data(), bytes.size());
+    auto past_end = [&] { view.read<uint64_t>(sizeof(Waveform) - 4); };
+    auto offset_past_end = [&] { view.read<uint8_t>(sizeof(Waveform)); };
+
+    // Checked in debug builds and with RTADP_PACKET_BOUNDS_CHECK, trusted otherwise
+    if (packet_detail::bounds_check) {
+        CHECK(throws_out_of_range(short_payload));
+        CHECK(throws_out_of_range(wrong_prefix));
+        CHECK(throws_out_of_range(past_end));
+        CHECK(throws_out_of_range(offset_past_end));
+    }
+
+    // The last byte of the struct is in range
+    CHECK(!throws_out_of_range([&] { view.read<uint8_t>(sizeof(Waveform) - 1); }));
+}
+
+void test_fields() {
+    auto bytes = serialize(Waveform{7, 2.5, 1024});
+    // The view does not own the payload, the message outlives it
+    DataMessage message = DataMessage::from_vector(std::move(bytes), nullptr);
+    auto view = PacketView<Waveform>::from(message);
+
+    static_assert(std::is_same<decltype(RTADP_PACKET_FIELD(view, nsamples)), uint16_t>::value, "field type");
+    CHECK(RTADP_PACKET_FIELD(view, run) == 7);
+    CHECK(RTADP_PACKET_FIELD(view, time) == 2.5);
+    CHECK(RTADP_PACKET_FIELD(view, nsamples) == 1024);
+}
+
+void test_aligned() {
+    // The prefix is 4 bytes: the struct is aligned at offset 4 of an aligned buffer
+    Placed placed(serialize(Waveform{7, 2.5, 1024}), alignof(Waveform) - PacketView<Waveform>::PREFIX_SIZE);
+    auto view = PacketView<Waveform>::from(placed.data, PacketView<Waveform>::WIRE_SIZE);
+
+    CHECK(view.is_aligned());
+    CHECK(view.in_place() != nullptr);
+    CHECK(reinterpret_cast<const uint8_t*>(view.in_place()) == view.bytes());
+    CHECK(view.in_place()->time == 2.5);
+    CHECK(view.visit([&](const Waveform& packet) { return &packet == view.in_place(); }));
+}
+
+void test_misaligned() {
+    Waveform packet{-3, 1e-9, 65535};
+    for (size_t offset = 1; offset < alignof(Waveform); offset++) {
+        Placed placed(serialize(packet), offset);
+        auto view = PacketView<Waveform>::from(placed.data, PacketView<Waveform>::WIRE_SIZE);
+        bool aligned = (offset + PacketView<Waveform>::PREFIX_SIZE) % alignof(Waveform) == 0;
+
+        CHECK(view.is_aligned() == aligned);
+        CHECK((view.in_place() != nullptr) == aligned);
+
+        CHECK(RTADP_PACKET_FIELD(view, run) == -3);
+        CHECK(RTADP_PACKET_FIELD(view, time) == 1e-9);
+        CHECK(RTADP_PACKET_FIELD(view, nsamples) == 65535);
+
+        Waveform loaded = view.load();
+        CHECK(loaded.run == -3 && loaded.time == 1e-9 && loaded.nsamples == 65535);
+
+        // A copy on the stack when the buffer is misaligned
+        auto nsamples = view.visit([&](const Waveform& visited) {
+            CHECK((reinterpret_cast<const uint8_t*>(&visited) == view.bytes()) == aligned);
+            CHECK(reinterpret_cast<uintptr_t>(&visited) % alignof(Waveform) == 0);
+            return visited.nsamples;
+        });
+        CHECK(nsamples == 65535);
+    }
+}
+
+void test_dispatch() {
+    auto waveform = serialize(Waveform{7, 2.5, 1024});
+    auto housekeeping = serialize(Housekeeping{8, 1});
+
+    int waveforms = 0;
+    int housekeepings = 0;
+    auto handler = [&](auto view) {
+        using Packet = typename decltype(view)::packet_type;
+        if constexpr (std::is_same<Packet, Waveform>::value) {
+            CHECK(RTADP_PACKET_FIELD(view, nsamples) == 1024);
+            waveforms++;
+        } else {
+            CHECK(RTADP_PACKET_FIELD(view, status) == 1);
+            housekeepings++;
+        }
+    };
+
+    CHECK((dispatch_packet<Waveform, Housekeeping>(waveform.data(), waveform.size(), handler)));
+    CHECK((dispatch_packet<Waveform, Housekeeping>(housekeeping.data(), housekeeping.size(), handler)));
+    CHECK((dispatch_packet<Housekeeping, Waveform>(DataMessage::from_vector(std::vector<uint8_t>(waveform), nullptr), handler)));
+    CHECK(waveforms == 2 && housekeepings == 1);
+
+    // No candidate: a truncated packet, an unknown prefix, an empty payload
+    CHECK(!(dispatch_packet<Waveform, Housekeeping>(waveform.data(), waveform.size() - 1, handler)));
+    auto unknown = waveform;
+    unknown[0] = 1;
+    CHECK(!(dispatch_packet<Waveform, Housekeeping>(unknown.data(), unknown.size(), handler)));
+    CHECK(!(dispatch_packet<Waveform, Housekeeping>(waveform.data(), 0, handler)));
+    CHECK(waveforms == 2 && housekeepings == 1);
+}
+
+void test_write_packet() {
+    OutputBuffer output;
+    write_packet(output, Waveform{7, 2.5, 1024});
+    CHECK(output.size() == PacketView<Waveform>::WIRE_SIZE);
+
+    DataMessage result = output.take();
+    CHECK(result.size() == PacketView<Waveform>::WIRE_SIZE);
+    CHECK(output.empty());
+
+    // Same wire format as serializePacket, read back by a view
+    int32_t prefix;
+    std::memcpy(&prefix, result.data(), sizeof(prefix));
+    CHECK(prefix == static_cast<int32_t>(sizeof(Waveform)));
+    auto view = PacketView<Waveform>::from(result);
+    CHECK(RTADP_PACKET_FIELD(view, run) == 7);
+    CHECK(RTADP_PACKET_FIELD(view, time) == 2.5);
+    CHECK(RTADP_PACKET_FIELD(view, nsamples) == 1024);
+}
+
+}
+
+int main() {
+    test_matches();
+    test_bounds();
+    test_fields();
+    test_aligned();
+    test_misaligned();
+    test_dispatch();
+    test_write_packet();
+    return 0;
+}
@@ -0,0 +1,183 @@
+// Copyright (C) 2024 INAF
+// This software is distributed under the terms of the BSD-3-Clause license
+//
+// Authors:
+//
+//    Andrea Bulgarelli <andrea.bulgarelli@inaf.it>
+//
+
+#include <rtadp/ReorderBuffer.h>
+#include <rtadp/BoundedQueue.h>
+#include <rtadp/ThreadSafeQueue.h>
+#include <thread>
+#include <vector>
+#include "TestCheck.h"
+
+namespace {
+
+DataMessage result(uint64_t sequence) {
+    DataMessage message = DataMessage::from_vector(std::vector<uint8_t>{static_cast<uint8_t>(sequence)});
+    message.set_sequence(sequence);
+    return message;
+}
+
+// Sequences of the messages in the queue, in order
+std::vector<uint64_t> take_all(MessageQueue<DataMessage>& queue) {
+    std::vector<uint64_t> sequences;
+    DataMessage message;
+    while (queue.try_pop(message)) {
+        sequences.push_back(message.sequence());
+    }
+    return sequences;
+}
+
+void test_in_order() {
+    auto output = std::make_shared<ThreadSafeQueue<DataMessage>>();
+    ReorderBuffer reorder(output);
+    for (uint64_t sequence = 0; sequence < 5; sequence++) {
+        reorder.insert(sequence, result(sequence));
+    }
+    CHECK((take_all(*output) == std::vector<uint64_t>{0, 1, 2, 3, 4}));
+    CHECK(reorder.size() == 0);
+}
+
+void test_out_of_order_and_skip() {
+    auto output = std::make_shared<ThreadSafeQueue<DataMessage>>();
+    ReorderBuffer reorder(output);
+
+    reorder.insert(2, result(2));
+    reorder.insert(3, result(3));
+    CHECK(output->empty());
+    CHECK(reorder.size() == 2);
+
+    reorder.skip(1);            // Completed without a result
+    CHECK(output->empty());
+    reorder.insert(0, result(0));
+    CHECK((take_all(*output) == std::vector<uint64_t>{0, 2, 3}));
+    CHECK(reorder.get_lost_count() == 0);
+}
+
+// More than max_window sequences waiting: the missing one is declared lost
+void test_window() {
+    auto output = std::make_shared<ThreadSafeQueue<DataMessage>>();
+    ReorderBuffer reorder(output, 4, std::chrono::milliseconds(60000));
+
+    for (uint64_t sequence = 1; sequence <= 4; sequence++) {
+        reorder.insert(sequence, result(sequence));
+    }
+    CHECK(output->empty());
+    reorder.insert(5, result(5));
+    CHECK((take_all(*output) == std::vector<uint64_t>{1, 2, 3, 4, 5}));
+    CHECK(reorder.get_lost_count() == 1);
+}
+
+void test_timeout() {
+    auto output = std::make_shared<ThreadSafeQueue<DataMessage>>();
+    ReorderBuffer reorder(output, 4096, std::chrono::milliseconds(20));
+
+    reorder.insert(2, result(2));
+    reorder.flush_expired();
+    CHECK(output->empty());     // Not yet expired
+
+    std::this_thread::sleep_for(std::chrono::milliseconds(40));
+    reorder.flush_expired();
+    CHECK((take_all(*output) == std::vector<uint64_t>{2}));
+    CHECK(reorder.get_lost_count() == 2);   // 0 and 1
+}
+
+// A result arriving after its sequence was skipped is dropped, the order is never broken
+void test_late_result() {
+    auto output = std::make_shared<ThreadSafeQueue<DataMessage>>();
+    ReorderBuffer reorder(output, 4096, std::chrono::milliseconds(0));
+
+    reorder.insert(1, result(1));
+    reorder.flush_expired();
+    CHECK((take_all(*output) == std::vector<uint64_t>{1}));
+
+    reorder.insert(0, result(0));
+    reorder.skip(0);
+    CHECK(output->empty());
+    CHECK(reorder.get_late_count() == 1);  // Only the late results are counted
+
+    reorder.insert(2, result(2));
+    CHECK((take_all(*output) == std::vector<uint64_t>{2}));
+}
+
+void test_reset() {
+    auto output = std::make_shared<ThreadSafeQueue<DataMessage>>();
+    ReorderBuffer reorder(output);
+
+    reorder.insert(3, result(3));
+    reorder.reset(10);
+    CHECK(reorder.size() == 0);
+    reorder.insert(10, result(10));
+    CHECK((take_all(*output) == std::vector<uint64_t>{10}));
+}
+
+// flush_expired never waits on a full output queue: the results are kept and pushed by a later call
+void test_flush_full_output() {
+    auto output = std::make_shared<BoundedQueue<DataMessage>>(std::make_shared<ThreadSafeQueue<DataMessage>>(),
+                                                              1, 0, OverflowPolicy::Block);
+    ReorderBuffer reorder(output, 4096, std::chrono::milliseconds(0));
+
+    reorder.insert(1, result(1));
+    reorder.insert(2, result(2));
+    reorder.flush_expired();
+    CHECK(output->size() == 1);
+    CHECK(reorder.size() == 1);     // 2 is ready, waiting for room
+
+    DataMessage message;
+    CHECK(output->try_pop(message) && message.sequence() == 1);
+    reorder.flush_expired();
+    CHECK(output->try_pop(message) && message.sequence() == 2);
+    CHECK(reorder.size() == 0);
+}
+
+// Concurrent workers completing the sequences in any order: the output is the full sequence, in order
+void test_concurrent_inserts() {
+    const int workers = 4;
+    const uint64_t count = 20000;
+    auto output = std::make_shared<ThreadSafeQueue<DataMessage>>();
+    ReorderBuffer reorder(output, count, std::chrono::milliseconds(60000));
+
+    std::vector<std::thread> threads;
+    for (int w = 0; w < workers; w++) {
+        threads.emplace_back([&reorder, w, workers, count] {
+            for (uint64_t sequence = w; sequence < count; sequence += workers) {
+                if (sequence % 3 == 0) {
+                    reorder.skip(sequence);
+                }
+                else {
+                    reorder.insert(sequence, result(sequence));
+                }
+            }
+        });
+    }
+    for (auto& thread : threads) {
+        thread.join();
+    }
+
+    std::vector<uint64_t> sequences = take_all(*output);
+    std::vector<uint64_t> expected;
+    for (uint64_t sequence = 0; sequence < count; sequence++) {
+        if (sequence % 3 != 0) {
+            expected.push_back(sequence);
+        }
+    }
+    CHECK(sequences == expected);
+    CHECK(reorder.get_lost_count() == 0);
+}
+
+}
+
+int main() {
+    test_in_order();
+    test_out_of_order_and_skip();
+    test_window();
+    test_timeout();
+    test_late_result();
+    test_reset();
+    test_flush_full_output();
+    test_concurrent_inserts();
+    return 0;
+}
@@ -0,0 +1,246 @@
+// Copyright (C) 2024 INAF
+// This software is distributed under the terms of the BSD-3-Clause license
+//
+// Authors:
+//
+//    Andrea Bulgarelli <andrea.bulgarelli@inaf.it>
+//
+
+#include <rtadp/SpillQueue.h>
+#include <rtadp/BoundedQueue.h>
+#include <rtadp/ThreadSafeQueue.h>
+#include <atomic>
+#include <cstdlib>
+#include <string>
+#include <thread>
+#include <vector>
+#include <dirent.h>
+#include <unistd.h>
+#include "TestCheck.h"
+
+namespace {
+
+const size_t PAYLOAD = 100;    // 128 bytes per record, 32 records per segment of 4096 bytes
+
+DataMessage message(uint64_t sequence) {
+    std::vector<uint8_t> payload(PAYLOAD);
+    for (size_t i = 0; i < payload.size(); i++) {
+        payload[i] = static_cast<uint8_t>(sequence + i);
+    }
+    DataMessage data = DataMessage::from_vector(std::move(payload));
+    data.set_sequence(sequence);
+    return data;
+}
+
+bool intact(const DataMessage& data) {
+    if (data.size() != PAYLOAD) {
+        return false;
+    }
+    for (size_t i = 0; i < PAYLOAD; i++) {
+        if (data.data()[i] != static_cast<uint8_t>(data.sequence() + i)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+// Temporary directory of the segment files, removed at the end of the test
+struct SpillDirectory {
+    std::string path;
+
+    SpillDirectory() {
+        char pattern[] = "/tmp/rtadp-spill-test-XXXXXX";
+        CHECK(mkdtemp(pattern) != nullptr);
+        path = pattern;
+    }
+
+    ~SpillDirectory() {
+        rmdir(path.c_str());
+    }
+
+    size_t files() const {
+        size_t count = 0;
+        DIR* dir = opendir(path.c_str());
+        while (struct dirent* entry = readdir(dir)) {
+            count += entry->d_name[0] != '.';
+        }
+        closedir(dir);
+        return count;
+    }
+};
+
+SpillConfig small_config(const std::string& directory) {
+    SpillConfig config;
+    config.directory = directory;
+    config.high_water = 10;
+    config.low_water = 5;
+    config.segment_bytes = 4096;
+    return config;
+}
+
+// The overflow goes to several segments and comes back in order; the segments are deleted once read
+void test_segment_order() {
+    SpillDirectory directory;
+    size_t refilled = 0;
+    auto memory = std::make_shared<ThreadSafeQueue<DataMessage>>();
+    SpillQueue queue(memory, small_config(directory.path), "order", [&](size_t count) { refilled += count; });
+
+    const uint64_t count = 500;
+    for (uint64_t sequence = 0; sequence < count; sequence++) {
+        queue.push(message(sequence));
+    }
+    CHECK(memory->size() == 10);
+    CHECK(queue.size() == count);
+    CHECK(queue.get_spilled_messages() == count - 10);
+    CHECK(queue.get_spilled_total() == count - 10);
+    CHECK(queue.get_segment_count() > 1);
+    CHECK(directory.files() == queue.get_segment_count());
+
+    for (uint64_t sequence = 0; sequence < count; sequence++) {
+        DataMessage data;
+        CHECK(queue.try_pop(data));
+        CHECK(data.sequence() == sequence);
+        CHECK(intact(data));
+        CHECK(memory->size() <= 10);    // Refilled up to high_water only
+    }
+    DataMessage data;
+    CHECK(!queue.try_pop(data));
+    CHECK(queue.empty());
+    CHECK(refilled > 0);
+    CHECK(queue.get_segment_count() == 0);
+    CHECK(queue.get_spilled_bytes() == 0);
+    CHECK(directory.files() == 0);
+    CHECK(queue.get_spill_errors() == 0);
+}
+
+// The refill starts below low_water, and the messages read back outlive their deleted segment
+void test_refill() {
+    SpillDirectory directory;
+    auto memory = std::make_shared<ThreadSafeQueue<DataMessage>>();
+    SpillQueue queue(memory, small_config(directory.path), "refill");
+
+    for (uint64_t sequence = 0; sequence < 40; sequence++) {
+        queue.push(message(sequence));
+    }
+    CHECK(queue.get_spilled_messages() == 30);
+
+    DataMessage data;
+    for (uint64_t sequence = 0; sequence < 4; sequence++) {
+        CHECK(queue.try_pop(data) && data.sequence() == sequence);
+    }
+    CHECK(queue.get_spilled_messages() == 30);  // 6 in memory, above low_water
+
+    CHECK(queue.try_pop(data) && data.sequence() == 4);
+    CHECK(memory->size() == 10);                // Refilled up to high_water
+    CHECK(queue.get_spilled_messages() == 25);
+
+    // New messages are spilled behind the ones on disk, to keep the order
+    queue.push(message(40));
+    CHECK(queue.get_spilled_messages() == 26);
+
+    std::vector<DataMessage> held;
+    for (uint64_t sequence = 5; sequence <= 40; sequence++) {
+        CHECK(queue.try_pop(data) && data.sequence() == sequence);
+        held.push_back(data);
+    }
+    CHECK(queue.get_segment_count() == 0);
+    CHECK(directory.files() == 0);
+    for (const auto& kept : held) {
+        CHECK(intact(kept));
+    }
+}
+
+// Without a usable directory the messages stay in memory (blocking mode) and are counted
+void test_append_failure_in_memory() {
+    auto memory = std::make_shared<ThreadSafeQueue<DataMessage>>();
+    SpillQueue queue(memory, small_config("/nonexistent/rtadp-spill"), "failure");
+
+    for (uint64_t sequence = 0; sequence < 15; sequence++) {
+        CHECK(queue.try_push(message(sequence)));
+    }
+    CHECK(memory->size() == 15);
+    CHECK(queue.get_spill_errors() == 5);
+    CHECK(queue.get_spilled_messages() == 0);
+
+    DataMessage data;
+    for (uint64_t sequence = 0; sequence < 15; sequence++) {
+        CHECK(queue.try_pop(data) && data.sequence() == sequence);
+    }
+}
+
+// try_push mode on a block-bounded queue: a failed spill on a full queue is refused, never waited
+// for under the spill lock; a blocking push waits for the consumers outside of it
+void test_append_failure_try_push() {
+    auto bounded = std::make_shared<BoundedQueue<DataMessage>>(std::make_shared<ThreadSafeQueue<DataMessage>>(),
+                                                               2, 0, OverflowPolicy::Block);
+    SpillConfig config = small_config("/nonexistent/rtadp-spill");
+    config.try_push = true;
+    SpillQueue queue(bounded, config, "failure");
+
+    CHECK(queue.try_push(message(0)));
+    CHECK(queue.try_push(message(1)));
+    CHECK(!queue.try_push(message(2)));
+    CHECK(queue.get_spill_errors() == 1);
+    CHECK(queue.try_push_batch({message(2), message(3)}) == 0);
+    CHECK(queue.get_spill_errors() == 2);
+
+    std::atomic<bool> pushed{false};
+    std::thread producer([&] {
+        queue.push(message(2));
+        pushed = true;
+    });
+    std::this_thread::sleep_for(std::chrono::milliseconds(50));
+    CHECK(!pushed);
+
+    DataMessage data;
+    CHECK(queue.try_pop(data) && data.sequence() == 0);     // Takes the spill lock if it refills
+    producer.join();
+    CHECK(queue.try_pop(data) && data.sequence() == 1);
+    CHECK(queue.try_pop(data) && data.sequence() == 2);
+}
+
+// try_push mode: a block-bounded queue full before high_water (max_bytes) spills instead of blocking,
+// with a producer and a consumer running concurrently
+void test_try_push_concurrent() {
+    SpillDirectory directory;
+    auto bounded = std::make_shared<BoundedQueue<DataMessage>>(std::make_shared<ThreadSafeQueue<DataMessage>>(),
+                                                               0, 4 * PAYLOAD, OverflowPolicy::Block);
+    SpillConfig config = small_config(directory.path);
+    config.try_push = true;
+    SpillQueue queue(bounded, config, "concurrent");
+
+    const uint64_t count = 5000;
+    std::thread producer([&] {
+        for (uint64_t sequence = 0; sequence < count; sequence++) {
+            CHECK(queue.try_push(message(sequence)));
+        }
+    });
+
+    uint64_t next = 0;
+    DataMessage data;
+    while (next < count) {
+        if (queue.try_pop(data)) {
+            CHECK(data.sequence() == next);
+            CHECK(intact(data));
+            next++;
+        }
+        else {
+            std::this_thread::yield();
+        }
+    }
+    producer.join();
+    CHECK(queue.empty());
+    CHECK(queue.get_spill_errors() == 0);
+    CHECK(directory.files() == 0);
+}
+
+}
+
+int main() {
+    test_segment_order();
+    test_refill();
+    test_append_failure_in_memory();
+    test_append_failure_try_push();
+    test_try_push_concurrent();
+    return 0;
+}